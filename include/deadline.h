@@ -0,0 +1 @@
+#include "../src/deadline.h"
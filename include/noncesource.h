@@ -0,0 +1 @@
+#include "../src/noncesource.h"
@@ -0,0 +1 @@
+#include "../src/paramlist.h"
@@ -0,0 +1 @@
+#include "../src/reply.h"
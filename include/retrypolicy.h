@@ -0,0 +1 @@
+#include "../src/retrypolicy.h"
@@ -0,0 +1 @@
+#include "../src/signer.h"
@@ -0,0 +1 @@
+#include "../src/signingpool.h"
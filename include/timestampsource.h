@@ -0,0 +1 @@
+#include "../src/timestampsource.h"
@@ -0,0 +1 @@
+#include "../src/tokencache.h"
@@ -0,0 +1 @@
+#include "../src/transport.h"
@@ -0,0 +1,111 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "base64_p.h"
+#include "cpufeatures_p.h"
+
+#ifdef QOAUTH_X86_SIMD
+#  include <immintrin.h>
+#endif
+
+static const char alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static char *encodeScalar( char *output, const uchar *data, int size )
+{
+    int i = 0;
+    for ( ; i + 3 <= size; i += 3 ) {
+        uint triple = ( uint( data[i] ) << 16 ) | ( uint( data[i + 1] ) << 8 ) | data[i + 2];
+        *output++ = alphabet[( triple >> 18 ) & 0x3f];
+        *output++ = alphabet[( triple >> 12 ) & 0x3f];
+        *output++ = alphabet[( triple >> 6 ) & 0x3f];
+        *output++ = alphabet[triple & 0x3f];
+    }
+
+    if ( i < size ) {
+        uint triple = uint( data[i] ) << 16;
+        if ( i + 1 < size ) {
+            triple |= uint( data[i + 1] ) << 8;
+        }
+        *output++ = alphabet[( triple >> 18 ) & 0x3f];
+        *output++ = alphabet[( triple >> 12 ) & 0x3f];
+        *output++ = ( i + 1 < size ) ? alphabet[( triple >> 6 ) & 0x3f] : '=';
+        *output++ = '=';
+    }
+
+    return output;
+}
+
+#ifdef QOAUTH_X86_SIMD
+
+// 12 bytes in, 16 characters out per step: the bytes are spread so that every
+// 32-bit lane holds one triple, the 6-bit indices are moved into separate bytes
+// with two multiplications, and mapped to characters by adding an offset that
+// depends on the range the index falls into.
+QOAUTH_TARGET("ssse3")
+static char *encodeSsse3( char *output, const uchar *data, int size )
+{
+    const __m128i spread = _mm_setr_epi8( 1, 0, 2, 1, 4, 3, 5, 4, 7, 6, 8, 7, 10, 9, 11, 10 );
+    const __m128i offsets = _mm_setr_epi8( 'a' - 26, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52,
+                                           '0' - 52, '0' - 52, '0' - 52, '0' - 52, '0' - 52, '+' - 62,
+                                           '/' - 63, 'A', 0, 0 );
+
+    int i = 0;
+    // every step reads 16 bytes, though it uses only 12 of them
+    for ( ; i + 16 <= size; i += 12 ) {
+        __m128i in = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) ( data + i ) ), spread );
+
+        __m128i high = _mm_mulhi_epu16( _mm_and_si128( in, _mm_set1_epi32( 0x0fc0fc00 ) ),
+                                        _mm_set1_epi32( 0x04000040 ) );
+        __m128i low = _mm_mullo_epi16( _mm_and_si128( in, _mm_set1_epi32( 0x003f03f0 ) ),
+                                       _mm_set1_epi32( 0x01000010 ) );
+        __m128i indices = _mm_or_si128( high, low );
+
+        // 0 for A-Z, 1 for a-z, 2..11 for digits, 12 for '+', 13 for '/', then shifted for A-Z to 13
+        __m128i ranges = _mm_subs_epu8( indices, _mm_set1_epi8( 51 ) );
+        __m128i upper = _mm_cmpgt_epi8( _mm_set1_epi8( 26 ), indices );
+        ranges = _mm_or_si128( ranges, _mm_and_si128( upper, _mm_set1_epi8( 13 ) ) );
+
+        __m128i chars = _mm_add_epi8( _mm_shuffle_epi8( offsets, ranges ), indices );
+        _mm_storeu_si128( (__m128i *) output, chars );
+        output += 16;
+    }
+
+    return encodeScalar( output, data + i, size - i );
+}
+
+#endif // QOAUTH_X86_SIMD
+
+char *QOAuth::Base64::encode( char *output, const uchar *data, int size )
+{
+#ifdef QOAUTH_X86_SIMD
+    static const bool ssse3 = CpuFeatures::hasFeature( CpuFeatures::SSSE3 );
+    if ( ssse3 ) {
+        return encodeSsse3( output, data, size );
+    }
+#endif
+    return encodeScalar( output, data, size );
+}
+
+QByteArray QOAuth::Base64::encode( const QByteArray &data )
+{
+    QByteArray result( encodedSize( data.size() ), Qt::Uninitialized );
+    encode( result.data(), reinterpret_cast<const uchar *>( data.constData() ), data.size() );
+    return result;
+}
@@ -0,0 +1,54 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file base64_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef BASE64_P_H
+#define BASE64_P_H
+
+#include <QByteArray>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+// Base64 encoding (RFC 4648, with padding) giving the same output as
+// QByteArray::toBase64(). With SSSE3, 12 input bytes are encoded at a time.
+namespace Base64 {
+
+    inline int encodedSize( int size ) { return ( size + 2 ) / 3 * 4; }
+
+    // encodes data into output, which has to have room for encodedSize() bytes,
+    // and returns the pointer past the last byte written
+    QOAUTH_EXPORT char *encode( char *output, const uchar *data, int size );
+
+    // a replacement for data.toBase64()
+    QOAUTH_EXPORT QByteArray encode( const QByteArray &data );
+
+} // namespace Base64
+
+} // namespace QOAuth
+
+#endif // BASE64_P_H
@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "bulkexchange_p.h"
+#include "interface_p.h"
+#include "reply.h"
+
+QOAuth::BulkExchange::BulkExchange( InterfacePrivate *interfacePrivate, const QString &requestUrl,
+                                    HttpMethod httpMethod, SignatureMethod signatureMethod,
+                                    const QList<TokenExchange> &exchanges, int maxConcurrent,
+                                    const Deadline &deadline ) :
+        interfacePrivate( interfacePrivate ),
+        requestUrl( requestUrl ),
+        httpMethod( httpMethod ),
+        signatureMethod( signatureMethod ),
+        exchanges( exchanges ),
+        maxConcurrent( qMax( maxConcurrent, 1 ) ),
+        deadline( deadline ),
+        next( 0 ),
+        finished( 0 )
+{
+    results.reserve( exchanges.size() );
+    for ( int i = 0; i < exchanges.size(); ++i ) {
+        results.append( TokenExchangeResult() );
+    }
+}
+
+QList<QOAuth::TokenExchangeResult> QOAuth::BulkExchange::run()
+{
+    while ( next < exchanges.size() && running.size() < maxConcurrent ) {
+        startNext();
+    }
+
+    if ( finished < exchanges.size() ) {
+        loop.exec();
+    }
+
+    return results;
+}
+
+void QOAuth::BulkExchange::startNext()
+{
+    const TokenExchange &exchange = exchanges.at( next );
+    Reply *reply = interfacePrivate->startRequest( requestUrl, httpMethod, signatureMethod,
+                                            exchange.token, exchange.tokenSecret, exchange.params,
+                                            deadline );
+    running.insert( reply, next );
+    ++next;
+
+    // replies failing before reaching the network finish from the event loop,
+    // so the connection is always made in time
+    connect( reply, SIGNAL(finished()), SLOT(replyFinished()) );
+}
+
+void QOAuth::BulkExchange::replyFinished()
+{
+    Reply *reply = qobject_cast<Reply *>( sender() );
+    if ( !reply || !running.contains( reply ) ) {
+        return;
+    }
+
+    TokenExchangeResult &result = results[running.take( reply )];
+    result.error = reply->error();
+    result.result = reply->result();
+    reply->deleteLater();
+    ++finished;
+
+    if ( next < exchanges.size() ) {
+        startNext();
+    }
+
+    if ( finished == exchanges.size() ) {
+        loop.quit();
+    }
+}
+
+#include "moc_bulkexchange_p.cpp"
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file bulkexchange_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef BULKEXCHANGE_P_H
+#define BULKEXCHANGE_P_H
+
+#include <QObject>
+#include <QHash>
+#include <QEventLoop>
+
+#include "interface.h"
+
+namespace QOAuth {
+
+class InterfacePrivate;
+
+// Runs the Access Token exchanges of Interface::accessTokens(), keeping at most
+// maxConcurrent of them in progress. A finished reply starts the next exchange
+// straight away, so the batch takes about count / maxConcurrent round trips.
+class BulkExchange : public QObject
+{
+    Q_OBJECT
+
+public:
+    BulkExchange( InterfacePrivate *interfacePrivate, const QString &requestUrl, HttpMethod httpMethod,
+                  SignatureMethod signatureMethod, const QList<TokenExchange> &exchanges,
+                  int maxConcurrent, const Deadline &deadline );
+
+    // blocks in a local event loop until every exchange is finished
+    QList<TokenExchangeResult> run();
+
+private Q_SLOTS:
+    void replyFinished();
+
+private:
+    void startNext();
+
+    InterfacePrivate *interfacePrivate;
+    QString requestUrl;
+    HttpMethod httpMethod;
+    SignatureMethod signatureMethod;
+    QList<TokenExchange> exchanges;
+    int maxConcurrent;
+    Deadline deadline;
+
+    int next;
+    int finished;
+    QHash<Reply *, int> running;
+    QList<TokenExchangeResult> results;
+    QEventLoop loop;
+};
+
+} // namespace QOAuth
+
+#endif // BULKEXCHANGE_P_H
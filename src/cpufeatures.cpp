@@ -0,0 +1,77 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "cpufeatures_p.h"
+
+#ifdef QOAUTH_X86_SIMD
+#  include <cpuid.h>
+#endif
+
+static uint detectFeatures()
+{
+    uint features = 0;
+
+#ifdef QOAUTH_X86_SIMD
+    uint eax, ebx, ecx, edx;
+    uint maxLeaf = __get_cpuid_max( 0, 0 );
+
+    if ( maxLeaf < 1 ) {
+        return features;
+    }
+
+    __cpuid( 1, eax, ebx, ecx, edx );
+    if ( ecx & ( 1u << 9 ) ) {
+        features |= QOAuth::CpuFeatures::SSSE3;
+    }
+    if ( ecx & ( 1u << 19 ) ) {
+        features |= QOAuth::CpuFeatures::SSE4_1;
+    }
+    if ( ecx & ( 1u << 20 ) ) {
+        features |= QOAuth::CpuFeatures::SSE4_2;
+    }
+
+    // AVX2 needs the OS to preserve the YMM registers (OSXSAVE + XCR0 bits 1 and 2)
+    bool ymmEnabled = false;
+    if ( ( ecx & ( 1u << 27 ) ) && ( ecx & ( 1u << 28 ) ) ) {
+        uint xcr0Low, xcr0High;
+        __asm__ __volatile__ ( "xgetbv" : "=a"(xcr0Low), "=d"(xcr0High) : "c"(0) );
+        ymmEnabled = ( xcr0Low & 0x6 ) == 0x6;
+    }
+
+    if ( maxLeaf >= 7 ) {
+        __cpuid_count( 7, 0, eax, ebx, ecx, edx );
+        if ( ymmEnabled && ( ebx & ( 1u << 5 ) ) ) {
+            features |= QOAuth::CpuFeatures::AVX2;
+        }
+        if ( ebx & ( 1u << 29 ) ) {
+            features |= QOAuth::CpuFeatures::SHA;
+        }
+    }
+#endif
+
+    return features;
+}
+
+bool QOAuth::CpuFeatures::hasFeature( Feature feature )
+{
+    static const uint features = detectFeatures();
+
+    return ( features & feature ) == (uint) feature;
+}
@@ -0,0 +1,61 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file cpufeatures_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef CPUFEATURES_P_H
+#define CPUFEATURES_P_H
+
+#include <QtCore/qglobal.h>
+
+// Vectorized code paths are compiled with per-function target attributes,
+// so the library itself doesn't require any particular instruction set and
+// picks the implementation at runtime. Other compilers and architectures
+// use the portable code only.
+#if ( defined(__GNUC__) || defined(__clang__) ) && ( defined(__x86_64__) || defined(__i386__) )
+#  define QOAUTH_X86_SIMD
+#  define QOAUTH_TARGET(features) __attribute__((target(features)))
+#endif
+
+namespace QOAuth {
+
+namespace CpuFeatures {
+
+    enum Feature {
+        SSSE3  = 0x01,
+        SSE4_1 = 0x02,
+        SSE4_2 = 0x04,
+        AVX2   = 0x08,
+        SHA    = 0x10
+    };
+
+    // the features are detected once, on first use
+    bool hasFeature( Feature feature );
+
+} // namespace CpuFeatures
+
+} // namespace QOAuth
+
+#endif // CPUFEATURES_P_H
@@ -0,0 +1,162 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "deadline.h"
+
+#include <QElapsedTimer>
+
+/*!
+  \class QOAuth::Deadline deadline.h <QtOAuth>
+  \brief This class represents a point in time by which a request has to complete.
+
+  A deadline is fixed when it's created, so unlike a timeout it keeps counting down
+  while it's passed from one call to another. This lets a caller with a latency budget
+  give the remaining part of it to the requests it makes, e.g.:
+
+  \code
+  QOAuth::Deadline deadline( 2000 );
+  QOAuth::ParamMap reply = interface->requestToken( requestTokenUrl, QOAuth::GET, QOAuth::HMAC_SHA1,
+                                                    QOAuth::ParamMap(), deadline );
+  // the next request gets whatever is left of the two seconds
+  reply = interface->accessToken( accessTokenUrl, QOAuth::GET, token, tokenSecret, QOAuth::HMAC_SHA1,
+                                  QOAuth::ParamMap(), deadline );
+  \endcode
+
+  A request given a deadline is aborted when it expires, whatever stage it is at (looking
+  up the host, connecting, the TLS handshake, transferring the data or waiting before a retry),
+  and fails with QOAuth::Timeout. Only that very request is affected.
+
+  Deadlines are measured with a monotonic clock, so they don't depend on changes of
+  the system time.
+
+  \sa QOAuth::Interface::requestTimeout, QOAuth::RetryPolicy
+*/
+
+/*!
+  \brief Creates a deadline that never expires.
+*/
+
+QOAuth::Deadline::Deadline() :
+        expiry( -1 )
+{
+}
+
+/*!
+  \brief Creates a deadline that expires \a msecs milliseconds from now.
+
+  A deadline with zero or negative \a msecs has expired already.
+*/
+
+QOAuth::Deadline::Deadline( qint64 msecs ) :
+        expiry( currentTime() + qMax( msecs, Q_INT64_C(0) ) )
+{
+}
+
+/*!
+  \brief Returns a deadline that never expires.
+*/
+
+QOAuth::Deadline QOAuth::Deadline::never()
+{
+    return Deadline();
+}
+
+/*!
+  \brief Returns true if the deadline never expires.
+*/
+
+bool QOAuth::Deadline::isForever() const
+{
+    return expiry < 0;
+}
+
+/*!
+  \brief Returns true if the deadline has passed.
+*/
+
+bool QOAuth::Deadline::hasExpired() const
+{
+    return !isForever() && currentTime() >= expiry;
+}
+
+/*!
+  \brief Returns the number of milliseconds left until the deadline.
+
+  The result is \c -1 for a deadline that never expires, and \c 0 for one that has passed.
+*/
+
+qint64 QOAuth::Deadline::remainingTime() const
+{
+    if ( isForever() ) {
+        return -1;
+    }
+    return qMax( expiry - currentTime(), Q_INT64_C(0) );
+}
+
+/*!
+  \brief Returns the earlier of this deadline and the one \a msecs milliseconds from now.
+
+  This is meant for nested calls, which may take at most \a msecs, but no longer than
+  the caller has left.
+*/
+
+QOAuth::Deadline QOAuth::Deadline::earlier( qint64 msecs ) const
+{
+    return earlier( Deadline( msecs ) );
+}
+
+/*!
+  \brief Returns the earlier of this deadline and \a other.
+*/
+
+QOAuth::Deadline QOAuth::Deadline::earlier( const Deadline &other ) const
+{
+    if ( isForever() ) {
+        return other;
+    }
+    if ( other.isForever() || expiry <= other.expiry ) {
+        return *this;
+    }
+    return other;
+}
+
+/*!
+  \brief Returns true if both deadlines expire at the same time.
+*/
+
+bool QOAuth::Deadline::operator==( const Deadline &other ) const
+{
+    return expiry == other.expiry;
+}
+
+/*!
+  \brief Returns the current time of the monotonic clock the deadlines are measured with,
+         in milliseconds.
+*/
+
+qint64 QOAuth::Deadline::currentTime()
+{
+    // a started timer reports the time of the clock itself, which is shared
+    // by all the timers of the process
+    QElapsedTimer timer;
+    timer.start();
+    return timer.msecsSinceReference();
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file deadline.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef DEADLINE_H
+#define DEADLINE_H
+
+#include <QtCore/qglobal.h>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+class QOAUTH_EXPORT Deadline
+{
+public:
+    Deadline();
+    explicit Deadline( qint64 msecs );
+
+    static Deadline never();
+
+    bool isForever() const;
+    bool hasExpired() const;
+    qint64 remainingTime() const;
+
+    Deadline earlier( qint64 msecs ) const;
+    Deadline earlier( const Deadline &other ) const;
+
+    bool operator==( const Deadline &other ) const;
+    inline bool operator!=( const Deadline &other ) const { return !operator==( other ); }
+
+    static qint64 currentTime();
+
+private:
+    // milliseconds of the monotonic clock, or -1 for no deadline
+    qint64 expiry;
+};
+
+} // namespace QOAuth
+
+#endif // DEADLINE_H
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "hmackeycache_p.h"
+
+#include <QVector>
+#include <QPair>
+#include <QtAlgorithms>
+
+QOAuth::HmacKeyCache::HmacKeyCache( int capacity ) :
+        maxSize( qMax( capacity, 0 ) ),
+        table( new Table ),
+        clock( 0 )
+{
+}
+
+QOAuth::HmacKeyCache::~HmacKeyCache()
+{
+    Table *current = ReaderTracker::loadAcquire( table );
+    qDeleteAll( *current );
+    delete current;
+}
+
+QOAuth::HmacSha1Key QOAuth::HmacKeyCache::hmacKey( const QByteArray &key )
+{
+    if ( maxSize > 0 ) {
+        ReadGuard guard( &tracker );
+        Entry *cached = ReaderTracker::loadAcquire( table )->value( key, 0 );
+        if ( cached ) {
+            // the entry is written to only on its first use since the last insertion
+            int now = ReaderTracker::loadRelaxed( clock );
+            if ( ReaderTracker::loadRelaxed( cached->lastUsed ) != now ) {
+                cached->lastUsed.fetchAndStoreRelaxed( now );
+            }
+            hitCount.local()->fetchAndAddRelaxed( 1 );
+            return cached->key;
+        }
+    }
+
+    missCount.local()->fetchAndAddRelaxed( 1 );
+
+    // the key setup is done outside of the lock
+    HmacSha1Key hmacKey( key );
+
+    if ( maxSize > 0 && writeMutex.tryLock() ) {
+        insert( key, hmacKey );
+        writeMutex.unlock();
+    }
+
+    return hmacKey;
+}
+
+void QOAuth::HmacKeyCache::insert( const QByteArray &key, const HmacSha1Key &hmacKey )
+{
+    Table *old = ReaderTracker::loadAcquire( table );
+    if ( old->contains( key ) ) {
+        return;
+    }
+
+    Table *updated = new Table( *old );
+    QList<Entry *> removed;
+
+    // the oldest eighth goes at once, so that the sorting is rare
+    if ( updated->size() >= maxSize ) {
+        uint now = uint( ReaderTracker::loadRelaxed( clock ) );
+        QVector< QPair<uint, QByteArray> > ages;
+        ages.reserve( updated->size() );
+        for ( Table::const_iterator it = updated->constBegin(); it != updated->constEnd(); ++it ) {
+            ages.append( qMakePair( now - uint( ReaderTracker::loadRelaxed( it.value()->lastUsed ) ), it.key() ) );
+        }
+        qSort( ages.begin(), ages.end(), qGreater< QPair<uint, QByteArray> >() );
+
+        int count = updated->size() - maxSize + 1 + maxSize / 8;
+        for ( int i = 0; i < count && i < ages.size(); ++i ) {
+            removed.append( updated->take( ages.at( i ).second ) );
+        }
+    }
+
+    Entry *entry = new Entry;
+    entry->key = hmacKey;
+    // the tick after the entry is the one of the lookups following its insertion
+    entry->lastUsed.fetchAndStoreRelaxed( clock.fetchAndAddRelaxed( 2 ) + 1 );
+    updated->insert( key, entry );
+
+    table.fetchAndStoreOrdered( updated );
+    tracker.synchronize();
+
+    // the entries still in use are shared with the new table
+    delete old;
+    qDeleteAll( removed );
+}
+
+int QOAuth::HmacKeyCache::capacity() const
+{
+    return maxSize;
+}
+
+int QOAuth::HmacKeyCache::size() const
+{
+    ReadGuard guard( &tracker );
+
+    return ReaderTracker::loadAcquire( table )->size();
+}
+
+int QOAuth::HmacKeyCache::hits() const
+{
+    return hitCount.sum();
+}
+
+int QOAuth::HmacKeyCache::misses() const
+{
+    return missCount.sum();
+}
@@ -0,0 +1,98 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file hmackeycache_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef HMACKEYCACHE_P_H
+#define HMACKEYCACHE_P_H
+
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+#include "qoauth_global.h"
+#include "sha1_p.h"
+#include "readertracker_p.h"
+
+namespace QOAuth {
+
+// Keeps HMAC-SHA1 keys that already went through the key setup (i.e. have
+// their inner and outer pads hashed), keyed by the complete signing key, that is
+// the percent-encoded consumer secret and token secret pair. An HmacSha1
+// created from the cached key starts hashing the message right away.
+//
+// Lookups take no locks: the keys live in a hash table that is never modified
+// once published, see ReaderTracker. A miss copies the table with the new key
+// added, unless another thread is adding one already, in which case the key
+// just isn't cached; so signing never waits for another thread. When the
+// cache is full, the least recently used eighth of it is evicted at once.
+//
+// Lookups don't write to anything other threads use either, apart from the
+// last use of the entry found. The clock that dates the uses only moves on
+// insertions, so the uses in between count as simultaneous, and a lookup
+// writes to the entry only if it wasn't used since the last insertion.
+class QOAUTH_EXPORT HmacKeyCache
+{
+public:
+    enum { DefaultCapacity = 1024 };
+
+    explicit HmacKeyCache( int capacity = DefaultCapacity );
+    ~HmacKeyCache();
+
+    HmacSha1Key hmacKey( const QByteArray &key );
+
+    int capacity() const;
+    int size() const;
+    int hits() const;
+    int misses() const;
+
+private:
+    struct Entry
+    {
+        HmacSha1Key key;
+        // the value of the clock at the last use, for LRU eviction
+        QAtomicInt lastUsed;
+    };
+    typedef QHash<QByteArray, Entry *> Table;
+
+    void insert( const QByteArray &key, const HmacSha1Key &hmacKey );
+
+    int maxSize;
+    ReaderTracker tracker;
+    QAtomicPointer<Table> table;
+    // serializes the writers, which never wait for it
+    QMutex writeMutex;
+    // advanced by the insertions only
+    QAtomicInt clock;
+    StripedCounter hitCount;
+    StripedCounter missCount;
+
+    Q_DISABLE_COPY(HmacKeyCache)
+};
+
+} // namespace QOAuth
+
+#endif // HMACKEYCACHE_P_H
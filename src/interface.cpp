@@ -20,6 +20,10 @@
 
 #include "interface.h"
 #include "interface_p.h"
+#include "bulkexchange_p.h"
+#include "reply.h"
+#include "reply_p.h"
+#include "transport_p.h"
 
 #include <QtCrypto>
 
@@ -27,11 +31,9 @@
 #include <QNetworkRequest>
 #include <QNetworkReply>
 #include <QUrl>
-#include <QDateTime>
 #include <QtDebug>
 #include <QEventLoop>
-#include <QTimer>
-#include <QFileInfo>
+#include <string.h>
 
 /*!
   \mainpage
@@ -152,6 +154,10 @@
 
   Once the Access Token is received, the application is authorized.
 
+  Both requests are also available in a non-blocking flavour, \ref requestTokenAsync() and
+  \ref accessTokenAsync(), returning a QOAuth::Reply object that notifies about the request
+  completion with the QOAuth::Reply::finished() signal.
+
   \section sec_acc_res Requesting Protected Resources with QOAuth
 
   In order to access Protected Resources, the application has to send a request containing
@@ -217,36 +223,47 @@ QOAuth::InterfacePrivate::InterfacePrivate() :
         consumerKey( QByteArray() ),
         consumerSecret( QByteArray() ),
         manager(0),
-        loop(0),
         requestTimeout(0),
+        maxReplySize( Interface::DefaultMaxReplySize ),
         error( NoError )
 {
 }
 
 void QOAuth::InterfacePrivate::init()
 {
-    Q_Q(QOAuth::Interface);
-
     ignoreSslErrors = false;
-    loop = new QEventLoop(q);
-    setupNetworkAccessManager();
 
-    q->connect( &eventHandler, SIGNAL(eventReady(int,QCA::Event)), SLOT(_q_setPassphrase(int,QCA::Event)) );
-    eventHandler.start();
+    // without a manager given, the interface uses the one shared by the thread
+    // (see QOAuth::Transport), so signing-only interfaces carry no network state
+    if ( manager ) {
+        setupNetworkAccessManager();
+    }
 }
 
 void QOAuth::InterfacePrivate::setupNetworkAccessManager()
 {
     Q_Q(QOAuth::Interface);
 
-    if (manager == 0)
-        manager = new QNetworkAccessManager;
-
     manager->setParent(q);
-    q->connect( manager, SIGNAL(finished(QNetworkReply*)), loop, SLOT(quit()) );
-    q->connect( manager, SIGNAL(finished(QNetworkReply*)), SLOT(_q_parseReply(QNetworkReply*)) );
-    q->connect( manager, SIGNAL(sslErrors(QNetworkReply*,QList<QSslError>)),
-                SLOT(_q_handleSslErrors(QNetworkReply*,QList<QSslError>)) );
+}
+
+QNetworkAccessManager *QOAuth::InterfacePrivate::networkManager()
+{
+    if ( manager ) {
+        return manager;
+    }
+
+    // looked up every time, as the manager has to belong to the calling thread
+    return Transport::networkAccessManager();
+}
+
+void QOAuth::InterfacePrivate::updateSigner()
+{
+    QSharedPointer<NonceSource> nonceSource = signer.nonceSource();
+    QSharedPointer<TimestampSource> timestampSource = signer.timestampSource();
+    signer = Signer( consumerKey, consumerSecret, privateKey );
+    signer.setNonceSource( nonceSource );
+    signer.setTimestampSource( timestampSource );
 }
 
 QByteArray QOAuth::InterfacePrivate::httpMethodToString( HttpMethod method )
@@ -287,67 +304,53 @@ QByteArray QOAuth::InterfacePrivate::signatureMethodToString( SignatureMethod me
 
 QOAuth::ParamMap QOAuth::InterfacePrivate::replyToMap( const QByteArray &data )
 {
-    // split reply to name=value strings
-    QList<QByteArray> replyParams = data.split( '&' );
-    // we'll store them in a map
     ParamMap parameters;
 
-    QByteArray replyParam;
-    QByteArray key;
-    int separatorIndex;
-
-    // iterate through name=value pairs
-    Q_FOREACH ( replyParam, replyParams ) {
-        // find occurrence of '='
-        separatorIndex = replyParam.indexOf( '=' );
-        // key is on the left
-        key = replyParam.left( separatorIndex );
-        // value is on the right
-        parameters.insert( key , replyParam.right( replyParam.length() - separatorIndex - 1 ) );
-    }
+    // name=value pairs are found in place, in a single pass over the data,
+    // so only the names and values themselves get allocated
+    const char *pair = data.constData();
+    const char *end = pair + data.size();
 
-    return parameters;
-}
+    while ( pair < end ) {
+        const char *pairEnd = static_cast<const char *>( memchr( pair, '&', end - pair ) );
+        if ( !pairEnd ) {
+            pairEnd = end;
+        }
 
-void QOAuth::InterfacePrivate::_q_parseReply( QNetworkReply *reply )
-{
-    int returnCode = reply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+        // empty pairs (as in "a=1&&b=2") are skipped, and a pair with
+        // no '=' is a name with an empty value
+        if ( pairEnd > pair ) {
+            const char *separator = static_cast<const char *>( memchr( pair, '=', pairEnd - pair ) );
+            const char *nameEnd = separator ? separator : pairEnd;
+            const char *value = separator ? separator + 1 : pairEnd;
 
-    switch ( returnCode ) {
-    case NoError:
-        replyParams = replyToMap( reply->readAll() );
-        if ( !replyParams.contains( InterfacePrivate::ParamToken ) ) {
-            qWarning() << __FUNCTION__ << "- oauth_token not present in reply!";
-        }
-        if ( !replyParams.contains( InterfacePrivate::ParamTokenSecret ) ) {
-            qWarning() << __FUNCTION__ << "- oauth_token_secret not present in reply!";
+            parameters.insert( QByteArray( pair, nameEnd - pair ),
+                               QByteArray( value, pairEnd - value ) );
         }
 
-    case BadRequest:
-    case Unauthorized:
-    case Forbidden:
-        error = returnCode;
-        break;
-    default:
-        error = OtherError;
+        pair = pairEnd + 1;
     }
 
-    reply->close();
+    return parameters;
 }
 
-void QOAuth::InterfacePrivate::_q_handleSslErrors(QNetworkReply *reply, const QList<QSslError> &errors)
+QByteArray QOAuth::InterfacePrivate::paramsToString( const ParamMap &parameters, ParsingMode mode )
 {
-    Q_UNUSED(errors);
-
-    if (ignoreSslErrors)
-        reply->ignoreSslErrors();
+    // the list comes out sorted by names and values
+    return paramsToString( ParamList( parameters ), mode );
 }
 
-QByteArray QOAuth::InterfacePrivate::paramsToString( const ParamMap &parameters, ParsingMode mode )
+QByteArray QOAuth::InterfacePrivate::paramsToString( const ParamList &parameters, ParsingMode mode )
 {
-    QByteArray middleString;
-    QByteArray endString;
-    QByteArray prependString;
+    if ( !parameters.isSorted() ) {
+        ParamList sortedParameters = parameters;
+        sortedParameters.sort();
+        return paramsToString( sortedParameters, mode );
+    }
+
+    const char *middleString;
+    const char *endString;
+    const char *prependString = "";
 
     switch ( mode ) {
     case ParseForInlineQuery:
@@ -367,33 +370,84 @@ QByteArray QOAuth::InterfacePrivate::paramsToString( const ParamMap &parameters,
         return QByteArray();
     }
 
-    QByteArray parameter;
-    QByteArray parametersString;
+    int middleSize = qstrlen( middleString );
+    int endSize = qstrlen( endString );
 
-    Q_FOREACH( parameter, parameters.uniqueKeys() ) {
-        QList<QByteArray> values = parameters.values( parameter );
-        if ( values.size() > 1 ) {
-            qSort( values.begin(), values.end() );
-        }
-        QByteArray value;
-        Q_FOREACH ( value, values ) {
-            parametersString.append( parameter );
-            parametersString.append( middleString );
-            parametersString.append( value );
-            parametersString.append( endString );
-        }
+    // compute the size first, so that the string is allocated once
+    int size = qstrlen( prependString );
+    for ( ParamList::const_iterator it = parameters.constBegin(); it != parameters.constEnd(); ++it ) {
+        size += it->first.size() + middleSize + it->second.size() + endSize;
     }
 
-    // remove the trailing end character (comma or ampersand)
-    parametersString.chop(1);
+    QByteArray parametersString;
+    parametersString.reserve( size );
+    parametersString.append( prependString );
+
+    for ( ParamList::const_iterator it = parameters.constBegin(); it != parameters.constEnd(); ++it ) {
+        parametersString.append( it->first );
+        parametersString.append( middleString );
+        parametersString.append( it->second );
+        parametersString.append( endString );
+    }
 
-    // prepend with the suitable string (or none)
-    parametersString.prepend( prependString );
+    // remove the trailing end character (comma or ampersand)
+    if ( !parameters.isEmpty() ) {
+        parametersString.chop(1);
+    }
 
     return parametersString;
 }
 
 
+/*!
+  \struct QOAuth::TokenExchange interface.h <QtOAuth>
+  \brief This struct describes a single exchange for QOAuth::Interface::accessTokens().
+
+  The members have the same meaning as the respective arguments
+  of QOAuth::Interface::accessToken().
+*/
+
+/*!
+  \brief Creates an empty exchange.
+*/
+
+QOAuth::TokenExchange::TokenExchange()
+{
+}
+
+/*!
+  \brief Creates an exchange of the Request \a token and \a tokenSecret,
+         sent with additional \a params.
+*/
+
+QOAuth::TokenExchange::TokenExchange( const QByteArray &token, const QByteArray &tokenSecret,
+                                      const ParamMap &params ) :
+        token( token ),
+        tokenSecret( tokenSecret ),
+        params( params )
+{
+}
+
+/*!
+  \struct QOAuth::TokenExchangeResult interface.h <QtOAuth>
+  \brief This struct holds the outcome of a single exchange done
+         with QOAuth::Interface::accessTokens().
+
+  \a error is the error code of the request, and \a result the data passed
+  in the Service Provider response, just like the ones returned by
+  QOAuth::Reply::error() and QOAuth::Reply::result().
+*/
+
+/*!
+  \brief Creates a result with no data and QOAuth::NoError.
+*/
+
+QOAuth::TokenExchangeResult::TokenExchangeResult() :
+        error( NoError )
+{
+}
+
+
 /*!
   \brief Creates a new QOAuth::Interface class instance with the given \a parent
 */
@@ -440,19 +494,23 @@ QOAuth::Interface::~Interface()
 
 /*!
   \brief Returns the network access manager used by the interface.
+
+  Unless one was given to the interface, it's the manager shared by all such interfaces
+  in the calling thread, see QOAuth::Transport::networkAccessManager(). It doesn't belong
+  to the interface, and its settings (e.g. a proxy or a cookie jar) apply to all of them.
+  To configure an interface on its own, give it a manager with setNetworkAccessManager().
 */
 QNetworkAccessManager* QOAuth::Interface::networkAccessManager() const
 {
-    Q_D(const Interface);
-
-    return d->manager;
+    return d_ptr->networkManager();
 }
 
 /*!
   \brief Sets \a manager to be the network access manager used by the interface.
 
-  The interface class takes ownership of the manager. If there already is a manager,
-  it's being deleted.
+  The interface class takes ownership of the manager. If the interface already owns a manager,
+  it's being deleted. Passing a null pointer makes the interface use the manager shared
+  by the thread (see QOAuth::Transport) again.
 
   /sa networkAccessManager()
 */
@@ -460,11 +518,12 @@ void QOAuth::Interface::setNetworkAccessManager(QNetworkAccessManager* manager)
 {
     Q_D(Interface);
 
-    if (d->manager)
+    if (d->manager && d->manager->parent() == this)
         delete d->manager;
 
     d->manager = manager;
-    d->setupNetworkAccessManager();
+    if (d->manager)
+        d->setupNetworkAccessManager();
 }
 
 /*!
@@ -518,6 +577,7 @@ void QOAuth::Interface::setConsumerKey( const QByteArray &consumerKey )
     Q_D(Interface);
 
     d->consumerKey = consumerKey;
+    d->updateSigner();
 }
 
 /*!
@@ -543,6 +603,7 @@ void QOAuth::Interface::setConsumerSecret( const QByteArray &consumerSecret )
     Q_D(Interface);
 
     d->consumerSecret = consumerSecret;
+    d->updateSigner();
 }
 
 /*!
@@ -553,7 +614,8 @@ void QOAuth::Interface::setConsumerSecret( const QByteArray &consumerSecret )
   requestToken() or accessToken() method. By defining the \a requestTimeout, requests
   can have the time constraint applied, after which they fail, setting \ref error to
   \ref Timeout. The \a requestTimeout value is initially set to \c 0, which in this
-  case means that no timeout is applied to outgoing requests.
+  case means that no timeout is applied to outgoing requests. When the \ref retryPolicy
+  allows retries, the timeout applies to every attempt separately.
 
   Access functions:
   \li <b>uint requestTimeout() const</b>
@@ -574,6 +636,70 @@ void QOAuth::Interface::setRequestTimeout( uint msec )
     d->requestTimeout = msec;
 }
 
+/*!
+  \property QOAuth::Interface::maxReplySize
+  \brief This property holds the largest reply, in bytes, accepted from the Service Provider.
+
+  Requests sent by requestToken() and accessToken() (and their asynchronous counterparts)
+  are aborted as soon as their reply turns out to be longer than \a maxReplySize, either
+  from its \c Content-Length or from the data received so far, and fail with
+  \ref ReplyTooLarge. This way a misbehaving Service Provider can't make the application
+  buffer an unbounded amount of data. The value is initially set to
+  \ref DefaultMaxReplySize (64 KiB), and \c 0 means that replies of any size are accepted.
+
+  Access functions:
+  \li <b>qint64 maxReplySize() const</b>
+  \li <b>void setMaxReplySize( qint64 size )</b>
+*/
+
+qint64 QOAuth::Interface::maxReplySize() const
+{
+    Q_D(const Interface);
+
+    return d->maxReplySize;
+}
+
+void QOAuth::Interface::setMaxReplySize( qint64 size )
+{
+    Q_D(Interface);
+
+    d->maxReplySize = qMax( size, Q_INT64_C(0) );
+}
+
+/*!
+  \brief Returns the policy applied to failed token requests.
+
+  \sa setRetryPolicy()
+*/
+
+QOAuth::RetryPolicy QOAuth::Interface::retryPolicy() const
+{
+    Q_D(const Interface);
+
+    return d->retryPolicy;
+}
+
+/*!
+  \brief Sets the \a policy applied to failed token requests.
+
+  Requests sent by requestToken() and accessToken(), their asynchronous counterparts
+  and accessTokens() are retried and hedged as the \a policy says, each time with
+  a fresh nonce and signature. The error is reported only after the last attempt fails.
+  Requests already in progress keep the policy they were started with, and sign every
+  attempt with the credentials they were started with.
+
+  By default requests are neither retried nor hedged.
+
+  \sa QOAuth::RetryPolicy
+*/
+
+void QOAuth::Interface::setRetryPolicy( const RetryPolicy &policy )
+{
+    Q_D(Interface);
+
+    d->retryPolicy = policy;
+}
+
 
 /*!
   \property QOAuth::Interface::error
@@ -596,24 +722,149 @@ int QOAuth::Interface::error() const
 }
 
 
+/*!
+  \brief Returns the signer used by the interface.
+
+  The signer holds the current \ref consumerKey, \ref consumerSecret and RSA private key.
+  Unlike the interface itself, it can be shared by many threads signing requests
+  concurrently. The returned signer doesn't follow later changes of the interface's
+  credentials.
+
+  \sa QOAuth::Signer
+*/
+
+QOAuth::Signer QOAuth::Interface::signer() const
+{
+    Q_D(const Interface);
+
+    return d->signer;
+}
+
+/*!
+  \brief Returns the source of the <em>oauth_nonce</em> values of the interface's requests.
+
+  \sa setNonceSource(), QOAuth::Signer::nonceSource()
+*/
+
+QSharedPointer<QOAuth::NonceSource> QOAuth::Interface::nonceSource() const
+{
+    Q_D(const Interface);
+
+    return d->signer.nonceSource();
+}
+
+/*!
+  \brief Makes the interface take the <em>oauth_nonce</em> values from \a source.
+
+  The \a source stays in use when the credentials change. Passing a null pointer
+  restores QOAuth::NonceSource::defaultSource().
+
+  \sa QOAuth::Signer::setNonceSource()
+*/
+
+void QOAuth::Interface::setNonceSource( const QSharedPointer<NonceSource> &source )
+{
+    Q_D(Interface);
+
+    d->signer.setNonceSource( source );
+}
+
+/*!
+  \brief Returns the source of the <em>oauth_timestamp</em> values of the interface's requests.
+
+  \sa setTimestampSource(), QOAuth::Signer::timestampSource()
+*/
+
+QSharedPointer<QOAuth::TimestampSource> QOAuth::Interface::timestampSource() const
+{
+    Q_D(const Interface);
+
+    return d->signer.timestampSource();
+}
+
+/*!
+  \brief Makes the interface take the <em>oauth_timestamp</em> values from \a source.
+
+  The \a source stays in use when the credentials change. Passing a null pointer
+  restores QOAuth::TimestampSource::defaultSource().
+
+  \sa QOAuth::Signer::setTimestampSource()
+*/
+
+void QOAuth::Interface::setTimestampSource( const QSharedPointer<TimestampSource> &source )
+{
+    Q_D(Interface);
+
+    d->signer.setTimestampSource( source );
+}
+
+/*!
+  \brief Returns the cache of Access Tokens used by the interface, or a null pointer
+         if tokens aren't cached.
+
+  \sa setTokenCache()
+*/
+
+QSharedPointer<QOAuth::TokenCache> QOAuth::Interface::tokenCache() const
+{
+    Q_D(const Interface);
+
+    return d->tokenCache;
+}
+
+/*!
+  \brief Makes the interface keep the Access Tokens it obtains in \a cache.
+
+  Access Token requests, sent with \ref accessToken(), \ref accessTokenAsync() or
+  \ref accessTokens(), are first looked up in the \a cache by the \ref consumerKey and
+  the Request Token. If a token is found, the request completes with it at once, without
+  contacting the Service Provider. Otherwise the request is sent, and its successful
+  result is stored in the \a cache. Request Tokens are never cached.
+
+  The \a cache can be shared with other interfaces, also in other threads. Passing
+  a null pointer, which is the default, disables caching.
+
+  \note The lookup costs little, but storing a token is a modification of the \a cache:
+  it copies a part of the cache's index and waits for the lookups in progress in other
+  threads, see QOAuth::TokenCache. It's done when the reply arrives, before
+  QOAuth::Reply::finished() is emitted, so it adds to the time of every Access Token
+  request that reaches the Service Provider.
+
+  \sa QOAuth::TokenCache
+*/
+
+void QOAuth::Interface::setTokenCache( const QSharedPointer<TokenCache> &cache )
+{
+    Q_D(Interface);
+
+    d->tokenCache = cache;
+}
+
+
 /*!
   This method is useful when using OAuth with RSA-SHA1 signing algorithm. It reads the RSA
   private key from the string given as \a key, and stores it internally. If the key is
   secured by a passphrase, it should be passed as the second argument.
 
-  The provided string is decoded into a private RSA key, optionally using the \a passphrase.
+  The provided PEM string is decoded into a private RSA key, optionally using the \a passphrase.
   If \a key contains a valid RSA private key, this method returns true. If any problems were
   encountered during decoding (either the key or the passphrase are invalid), false is
   returned and the error code is set to QOAuth::RSADecodingError.
 
-  \sa setRSAPrivateKeyFromFile()
+  The key is decoded right away, in the calling thread; no event loop is needed.
+  The interfaces given the same key and passphrase share a single decoded key.
+
+  \sa setRSAPrivateKeyFromFile(), setRSAPrivateKeyFromDER()
 */
 
 bool QOAuth::Interface::setRSAPrivateKey( const QString &key, const QCA::SecureArray &passphrase )
 {
     Q_D(Interface);
 
-    d->setPrivateKey( key, passphrase, InterfacePrivate::KeyFromString );
+    QCA::ConvertResult result;
+    PrivateKeyCache::Key privateKey = PrivateKeyCache::instance()->fromData( key.toLatin1(), PrivateKeyCache::PEM,
+                                                                             passphrase, &result );
+    d->setPrivateKey( privateKey, result );
 
     return ( d->error == NoError );
 }
@@ -623,91 +874,78 @@ bool QOAuth::Interface::setRSAPrivateKey( const QString &key, const QCA::SecureA
   private key from the given \a file, and stores it internally. If the key is secured by
   a passphrase, it should be passed as the second argument.
 
-  The provided file is read and decoded into a private RSA key, optionally using the \a passphrase.
-  If it contains a valid RSA private key, this method returns true. If any problems were
-  encountered during decoding, false is returned and the appropriate error code is set:
+  The provided file, either PEM or DER encoded, is read and decoded into a private RSA key,
+  optionally using the \a passphrase. If it contains a valid RSA private key, this method
+  returns true. If any problems were encountered during decoding, false is returned and
+  the appropriate error code is set:
   \li <tt>QOAuth::RSAKeyFileError</tt> - when the key file doesn't exist or is unreadable
   \li <tt>QOAuth::RSADecodingError</tt> - if problems occurred during encoding (either the key
                                           and/or password are invalid).
 
-  \sa setRSAPrivateKey()
+  The key is decoded right away, in the calling thread; no event loop is needed.
+  All the interfaces in the process that load the same file with the same passphrase
+  share a single decoded key. The file is decoded again only after it's modified.
+
+  \sa setRSAPrivateKey(), setRSAPrivateKeyFromDER()
 */
 
 bool QOAuth::Interface::setRSAPrivateKeyFromFile( const QString &filename, const QCA::SecureArray &passphrase )
 {
     Q_D(Interface);
 
-    if ( ! QFileInfo( filename ).exists() ) {
-        d->error = RSAKeyFileError;
-        qWarning() << __FUNCTION__ << "- the given file does not exist...";
-    } else {
-        d->setPrivateKey( filename, passphrase, InterfacePrivate::KeyFromFile );
+    QCA::ConvertResult result;
+    PrivateKeyCache::Key privateKey = PrivateKeyCache::instance()->fromFile( filename, passphrase, &result );
+    if ( result == QCA::ErrorFile ) {
+        qWarning() << __FUNCTION__ << "- the given file does not exist or is unreadable...";
     }
+    d->setPrivateKey( privateKey, result );
 
     return ( d->error == NoError );
 }
 
-void QOAuth::InterfacePrivate::setPrivateKey( const QString &source,
-                                              const QCA::SecureArray &passphrase, KeySource from )
+/*!
+  This method is useful when using OAuth with RSA-SHA1 signing algorithm. It decodes
+  the DER encoded RSA private \a key (in the PKCS#8 format), and stores it internally.
+  If the key is secured by a passphrase, it should be passed as the second argument.
+
+  If \a key contains a valid RSA private key, this method returns true. Otherwise false is
+  returned and the error code is set to QOAuth::RSADecodingError.
+
+  \sa setRSAPrivateKey(), setRSAPrivateKeyFromFile()
+*/
+
+bool QOAuth::Interface::setRSAPrivateKeyFromDER( const QByteArray &key, const QCA::SecureArray &passphrase )
 {
+    Q_D(Interface);
+
+    QCA::ConvertResult result;
+    PrivateKeyCache::Key privateKey = PrivateKeyCache::instance()->fromData( key, PrivateKeyCache::DER,
+                                                                             passphrase, &result );
+    d->setPrivateKey( privateKey, result );
 
+    return ( d->error == NoError );
+}
+
+void QOAuth::InterfacePrivate::setPrivateKey( const PrivateKeyCache::Key &key, QCA::ConvertResult result )
+{
     if( !QCA::isSupported( "pkey" ) ||
         !QCA::PKey::supportedIOTypes().contains( QCA::PKey::RSA ) ) {
         qFatal( "RSA is not supported!" );
     }
 
     privateKeySet = false;
-    this->passphrase = passphrase;
-
-    QCA::KeyLoader keyLoader;
-    QEventLoop localLoop;
-    QObject::connect( &keyLoader, SIGNAL(finished()), &localLoop, SLOT(quit()) );
-
-    switch (from) {
-    case KeyFromString:
-        keyLoader.loadPrivateKeyFromPEM( source );
-        break;
-    case KeyFromFile:
-        keyLoader.loadPrivateKeyFromPEMFile( source );
-        break;
-    }
-
-    QTimer::singleShot( 3000, &localLoop, SLOT(quit()) );
-    localLoop.exec();
-
-    readKeyFromLoader( &keyLoader );
-}
 
-void QOAuth::InterfacePrivate::readKeyFromLoader( QCA::KeyLoader *keyLoader )
-{
-    QCA::ConvertResult result = keyLoader->convertResult();
-    if ( result == QCA::ConvertGood ) {
+    if ( result == QCA::ConvertGood && !key.isNull() ) {
         error = NoError;
-        privateKey = keyLoader->privateKey();
+        sharedPrivateKey = key;
+        privateKey = *key;
         privateKeySet = true;
-    } else if ( result == QCA::ErrorDecode ) {
-        error = RSADecodingError;
-        // this one seems to never be set ....
-        //  } else if ( result == QCA::ErrorPassphrase ) {
-        //    error = RSAPassphraseError;
+        updateSigner();
     } else if ( result == QCA::ErrorFile ) {
         error = RSAKeyFileError;
-    }
-}
-
-void QOAuth::InterfacePrivate::_q_setPassphrase( int id, const QCA::Event &event )
-{
-    if ( event.isNull() ) {
-        return;
-    }
-
-    // we're looking only for the passphrase for the RSA key
-    if ( event.type() == QCA::Event::Password &&
-         event.passwordStyle() == QCA::Event::StylePassphrase ) {
-        // set the passphrase to the one provided with QOAuth::Interface::setRSAPrivateKey{,FromFile}()
-        eventHandler.submitPassword( id, passphrase );
     } else {
-        eventHandler.reject( id );
+        // a wrong passphrase is reported as a decoding error too
+        error = RSADecodingError;
     }
 }
 
@@ -749,11 +987,24 @@ void QOAuth::InterfacePrivate::_q_setPassphrase( int id, const QCA::Event &event
 
 QOAuth::ParamMap QOAuth::Interface::requestToken( const QString &requestUrl, HttpMethod httpMethod,
                                                   SignatureMethod signatureMethod, const ParamMap &params )
+{
+    return requestToken( requestUrl, httpMethod, signatureMethod, params, Deadline() );
+}
+
+/*!
+  \overload
+
+  The request is aborted as well when the \a deadline passes, see QOAuth::Deadline.
+*/
+
+QOAuth::ParamMap QOAuth::Interface::requestToken( const QString &requestUrl, HttpMethod httpMethod,
+                                                  SignatureMethod signatureMethod, const ParamMap &params,
+                                                  const Deadline &deadline )
 {
     Q_D(Interface);
 
     return d->sendRequest( requestUrl, httpMethod, signatureMethod,
-                           QByteArray(), QByteArray(), params );
+                           QByteArray(), QByteArray(), params, deadline );
 }
 
 /*!
@@ -784,7 +1035,9 @@ QOAuth::ParamMap QOAuth::Interface::requestToken( const QString &requestUrl, Htt
 
   Once the request is sent, a local event loop is executed and set up to wait for the request
   to complete. If the \ref requestTimeout property is set to a non-zero value, its vaue
-  is applied as a request timeout, after which the request is aborted.
+  is applied as a request timeout, after which the request is aborted. If a token cache
+  is set with \ref setTokenCache(), an Access Token found there is returned without sending
+  any request.
 
   \returns If request succeded, the method returns all the data passed in the Service
   Provider response (including an authorized Access Token and Token Secret), formed in
@@ -799,12 +1052,151 @@ QOAuth::ParamMap QOAuth::Interface::requestToken( const QString &requestUrl, Htt
 QOAuth::ParamMap QOAuth::Interface::accessToken( const QString &requestUrl, HttpMethod httpMethod, const QByteArray &token,
                                                  const QByteArray &tokenSecret, SignatureMethod signatureMethod,
                                                  const ParamMap &params )
+{
+    return accessToken( requestUrl, httpMethod, token, tokenSecret, signatureMethod, params, Deadline() );
+}
+
+/*!
+  \overload
+
+  The request is aborted as well when the \a deadline passes, see QOAuth::Deadline.
+*/
+
+QOAuth::ParamMap QOAuth::Interface::accessToken( const QString &requestUrl, HttpMethod httpMethod, const QByteArray &token,
+                                                 const QByteArray &tokenSecret, SignatureMethod signatureMethod,
+                                                 const ParamMap &params, const Deadline &deadline )
 {
     Q_D(Interface);
 
     return d->sendRequest( requestUrl, httpMethod, signatureMethod,
-                           token, tokenSecret, params );
+                           token, tokenSecret, params, deadline );
+
+}
+
+/*!
+  This method is an asynchronous counterpart of \ref requestToken(). It constructs and
+  sends exactly the same request, but instead of waiting for the Service Provider's reply
+  it returns immediately with a QOAuth::Reply object representing the request.
+
+  The returned reply emits QOAuth::Reply::finished() once the request completes. The data
+  sent by the Service Provider (including a Request Token and Token Secret) is then
+  available with QOAuth::Reply::result(), and the error code with QOAuth::Reply::error().
+  If the request can't be sent at all (e.g. the \ref consumerKey is missing),
+  the reply finishes with an appropriate error as soon as control returns to the event loop.
+  If the \ref requestTimeout property is set to a non-zero value, it is applied
+  to the returned reply. The reply fails with QOAuth::Timeout as well when
+  the \a deadline passes.
+
+  The reply is owned by the interface, but it should be deleted by the caller
+  once it's no longer needed.
+
+  \sa requestToken(), accessTokenAsync(), QOAuth::Reply
+*/
+
+QOAuth::Reply* QOAuth::Interface::requestTokenAsync( const QString &requestUrl, HttpMethod httpMethod,
+                                                     SignatureMethod signatureMethod, const ParamMap &params,
+                                                     const Deadline &deadline )
+{
+    Q_D(Interface);
+
+    return d->startRequest( requestUrl, httpMethod, signatureMethod,
+                            QByteArray(), QByteArray(), params, deadline );
+}
+
+/*!
+  This method is an asynchronous counterpart of \ref accessToken(). It constructs and
+  sends exactly the same request, but instead of waiting for the Service Provider's reply
+  it returns immediately with a QOAuth::Reply object representing the request.
+
+  The returned reply emits QOAuth::Reply::finished() once the request completes. The data
+  sent by the Service Provider (including an Access Token and Token Secret) is then
+  available with QOAuth::Reply::result(), and the error code with QOAuth::Reply::error().
+  The reply fails with QOAuth::Timeout when the \a deadline passes.
+
+  The reply is owned by the interface, but it should be deleted by the caller
+  once it's no longer needed.
+
+  \sa accessToken(), requestTokenAsync(), QOAuth::Reply
+*/
 
+QOAuth::Reply* QOAuth::Interface::accessTokenAsync( const QString &requestUrl, HttpMethod httpMethod,
+                                                    const QByteArray &token, const QByteArray &tokenSecret,
+                                                    SignatureMethod signatureMethod, const ParamMap &params,
+                                                    const Deadline &deadline )
+{
+    Q_D(Interface);
+
+    return d->startRequest( requestUrl, httpMethod, signatureMethod,
+                            token, tokenSecret, params, deadline );
+}
+
+/*!
+  This method exchanges many authorized Request Tokens for Access Tokens at once,
+  e.g. when migrating a whole set of users. Every item of \a exchanges is sent exactly
+  like with \ref accessToken(), to the same \a requestUrl, with the given \a httpMethod
+  and \a signatureMethod, and its own Token, Token Secret and additional parameters.
+
+  Up to \a maxConcurrent requests are in progress at any time, and whenever one of them
+  completes, the next one is sent. The whole batch thus takes about
+  <tt>exchanges.size() / maxConcurrent</tt> round trips to the Service Provider instead of
+  <tt>exchanges.size()</tt>. The default limit matches the number of connections
+  QNetworkAccessManager opens to a single host; higher limits only pay off with HTTP/2
+  (see QOAuth::Transport). If the \ref requestTimeout property is set to a non-zero value,
+  it applies to every request separately. The \a deadline covers the whole batch: once
+  it passes, the requests in progress and the ones not sent yet fail with QOAuth::Timeout.
+
+  Like \ref accessToken(), this method waits in a local event loop until all the requests
+  complete.
+
+  \returns The results in the order of \a exchanges. Each of them carries the data
+  passed in the Service Provider response and the error code of its own request, so
+  a failed exchange doesn't affect the others. The \ref error property is set to
+  QOAuth::NoError if all the exchanges succeeded, or to the error of the first failed one.
+
+  \sa accessToken(), accessTokenAsync(), pendingRequests()
+*/
+
+QList<QOAuth::TokenExchangeResult> QOAuth::Interface::accessTokens( const QString &requestUrl,
+                                                                    HttpMethod httpMethod,
+                                                                    const QList<TokenExchange> &exchanges,
+                                                                    SignatureMethod signatureMethod,
+                                                                    int maxConcurrent, const Deadline &deadline )
+{
+    Q_D(Interface);
+
+    BulkExchange bulk( d, requestUrl, httpMethod, signatureMethod, exchanges, maxConcurrent, deadline );
+    QList<TokenExchangeResult> results = bulk.run();
+
+    d->error = NoError;
+    Q_FOREACH ( const TokenExchangeResult &result, results ) {
+        if ( result.error != NoError ) {
+            d->error = result.error;
+            break;
+        }
+    }
+
+    return results;
+}
+
+/*!
+  \brief Returns the number of token requests of this interface that are still in progress.
+
+  Every request, whether started with requestToken(), accessToken() or their asynchronous
+  counterparts, has its own state and its own QOAuth::Reply, so any number of them can
+  be in progress at the same time, each getting the reply meant for it.
+
+  Replies moved to another parent are not counted.
+*/
+
+int QOAuth::Interface::pendingRequests() const
+{
+    int count = 0;
+    Q_FOREACH ( Reply *reply, findChildren<Reply *>() ) {
+        if ( !reply->isFinished() ) {
+            ++count;
+        }
+    }
+    return count;
 }
 
 /*!
@@ -847,25 +1239,8 @@ QByteArray QOAuth::Interface::createParametersString( const QString &requestUrl,
 {
     Q_D(Interface);
 
-    d->error = NoError;
-
-    // copy parameters to a writeable object
-    ParamMap parameters = params;
-    // calculate the signature
-    QByteArray signature = d->createSignature( requestUrl, httpMethod, signatureMethod,
-                                               token, tokenSecret, &parameters );
-
-    // return an empty bytearray when signature wasn't created
-    if ( d->error != NoError ) {
-        return QByteArray();
-    }
-
-    // append it to parameters
-    parameters.insert( InterfacePrivate::ParamSignature, signature );
-    // convert the map to bytearray, according to requested mode
-    QByteArray parametersString = d->paramsToString( parameters, mode );
-
-    return parametersString;
+    return d->signer.sign( requestUrl, httpMethod, token, tokenSecret,
+                           signatureMethod, params, mode, &d->error );
 }
 
 /*!
@@ -905,181 +1280,120 @@ QByteArray QOAuth::Interface::inlineParameters( const ParamMap &params, ParsingM
     return query;
 }
 
-QOAuth::ParamMap QOAuth::InterfacePrivate::sendRequest( const QString &requestUrl, HttpMethod httpMethod,
-                                                        SignatureMethod signatureMethod, const QByteArray &token,
-                                                        const QByteArray &tokenSecret, const ParamMap &params )
+QOAuth::Reply* QOAuth::InterfacePrivate::startRequest( const QString &requestUrl, HttpMethod httpMethod,
+                                                      SignatureMethod signatureMethod, const QByteArray &token,
+                                                      const QByteArray &tokenSecret, const ParamMap &params,
+                                                      const Deadline &deadline )
 {
+    Q_Q(Interface);
+
+    Reply *reply = new Reply( q );
+    ReplyPrivate *r = reply->d_func();
+
     if ( httpMethod != GET && httpMethod != POST ) {
         qWarning() << __FUNCTION__ << "- requestToken() and accessToken() accept only GET and POST methods";
         error = UnsupportedHttpMethod;
-        return ParamMap();
-    }
-
-    error = NoError;
-
-    ParamMap parameters = params;
-
-    // create signature
-    QByteArray signature = createSignature( requestUrl, httpMethod, signatureMethod,
-                                            token, tokenSecret, &parameters );
-
-    // if signature wasn't created, return an empty map
-    if ( error != NoError ) {
-        return ParamMap();
+        r->finish( error, true );
+        return reply;
     }
 
-    // add signature to parameters
-    parameters.insert( InterfacePrivate::ParamSignature, signature );
-
-    QByteArray authorizationHeader;
-    QNetworkRequest request;
-
-    if ( httpMethod == GET ) {
-        authorizationHeader = paramsToString( parameters, ParseForHeaderArguments );
-        // create the authorization header
-        request.setRawHeader( "Authorization", authorizationHeader );
-    } else if ( httpMethod == POST ) {
-        authorizationHeader = paramsToString( parameters, ParseForRequestContent );
-        // create a network request
-        request.setHeader( QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded" );
+    // Access Tokens already obtained are served from the cache
+    if ( tokenCache && !token.isEmpty() ) {
+        r->result = tokenCache->value( consumerKey, token );
+        if ( !r->result.isEmpty() ) {
+            error = NoError;
+            r->finish( error, true );
+            return reply;
+        }
+        r->tokenCache = tokenCache;
+        r->cacheConsumerKey = consumerKey;
     }
 
-    request.setUrl( QUrl( requestUrl ) );
-
-    // fire up a single shot timer if timeout was specified
-    if ( requestTimeout > 0 ) {
-        QTimer::singleShot( requestTimeout, loop, SLOT(quit()) );
-        // if the request finishes on time, the error value is overriden
-        // if not, it remains equal to QOAuth::Interface::Timeout
+    // the reply keeps everything needed to send the request again
+    r->owner = q;
+    r->requestUrl = requestUrl;
+    r->httpMethod = httpMethod;
+    r->signatureMethod = signatureMethod;
+    r->token = token;
+    r->tokenSecret = tokenSecret;
+    r->params = params;
+    r->signer = signer;
+    r->retryPolicy = retryPolicy;
+    r->requestTimeout = requestTimeout;
+    r->ignoreSslErrors = ignoreSslErrors;
+    r->maxReplySize = maxReplySize;
+    r->deadline = deadline;
+
+    // nothing is sent once the caller's time is up
+    if ( deadline.hasExpired() ) {
         error = Timeout;
+        r->finish( error, true );
+        return reply;
     }
 
-    // clear the reply container and send the request
-    replyParams.clear();
-    QNetworkReply *reply;
-    if ( httpMethod == GET ) {
-        reply = manager->get( request );
-    } else if ( httpMethod == POST ) {
-        reply = manager->post( request, authorizationHeader );
-    }
-
-    // start the event loop and wait for the response
-    loop->exec();
-
-    // if request completed successfully, error is different than QOAuth::Interface::Timeout
-    // if it failed, we have to abort the request
-    if ( error == Timeout ) {
-        reply->abort();
+    r->startDeadlineTimer();
+    r->startAttempt();
+    if ( r->isFinished ) {
+        error = r->error;
     }
 
-    return replyParams;
+    return reply;
 }
 
-QByteArray QOAuth::InterfacePrivate::createSignature( const QString &requestUrl, HttpMethod httpMethod,
-                                                      SignatureMethod signatureMethod, const QByteArray &token,
-                                                      const QByteArray &tokenSecret, ParamMap *params )
+int QOAuth::InterfacePrivate::sendAttempt( ReplyPrivate *reply )
 {
-    if ( ( signatureMethod == HMAC_SHA1 ||
-           signatureMethod == RSA_SHA1 ) &&
-         consumerKey.isEmpty() ) {
-        qWarning() << __FUNCTION__ << "- consumer key is empty, make sure that you set it"
-                                      "with QOAuth::Interface::setConsumerKey()";
-        error = ConsumerKeyEmpty;
-        return QByteArray();
-    }
-    if ( consumerSecret.isEmpty() ) {
-        qWarning() << __FUNCTION__ << "- consumer secret is empty, make sure that you set it"
-                                      "with QOAuth::Interface::setConsumerSecret()";
-        error = ConsumerSecretEmpty;
-        return QByteArray();
+    // for GET requests the parameters go to the Authorization header,
+    // POST requests carry them in the body
+    ParsingMode mode = ( reply->httpMethod == GET ) ? ParseForHeaderArguments : ParseForRequestContent;
+    int signingError;
+    QByteArray authorizationHeader = reply->signer.sign( reply->requestUrl, reply->httpMethod,
+                                                         reply->token, reply->tokenSecret,
+                                                         reply->signatureMethod, reply->params,
+                                                         mode, &signingError );
+
+    if ( signingError != NoError ) {
+        return signingError;
     }
 
-    if ( signatureMethod == RSA_SHA1 &&
-         privateKey.isNull() ) {
-        qWarning() << __FUNCTION__ << "- RSA private key is empty, make sure that you provide it"
-                                      "with QOAuth::Interface::setRSAPrivateKey{,FromFile}()";
-        error = RSAPrivateKeyEmpty;
-        return QByteArray();
-    }
+    QNetworkRequest request;
 
-    // create nonce
-    QCA::InitializationVector iv( 16 );
-    QByteArray nonce = iv.toByteArray().toHex();
-
-    // create timestamp
-    uint time = QDateTime::currentDateTime().toTime_t();
-    QByteArray timestamp = QByteArray::number( time );
-
-    // create signature base string
-    // 1. create the method string
-    QByteArray httpMethodString = httpMethodToString( httpMethod );
-    // 2. prepare percent-encoded request URL
-    QByteArray percentRequestUrl = requestUrl.toLatin1().toPercentEncoding();
-    // 3. prepare percent-encoded parameters string
-    params->insert( InterfacePrivate::ParamConsumerKey, consumerKey );
-    params->insert( InterfacePrivate::ParamNonce, nonce );
-    params->insert( InterfacePrivate::ParamSignatureMethod,
-                    signatureMethodToString( signatureMethod ) );
-    params->insert( InterfacePrivate::ParamTimestamp, timestamp );
-    params->insert( InterfacePrivate::ParamVersion, InterfacePrivate::OAuthVersion );
-    // append token only if it is defined (requestToken() doesn't use a token at all)
-    if ( !token.isEmpty() ) {
-        params->insert( InterfacePrivate::ParamToken, token );
+    if ( reply->httpMethod == GET ) {
+        request.setRawHeader( "Authorization", authorizationHeader );
+    } else {
+        request.setHeader( QNetworkRequest::ContentTypeHeader, "application/x-www-form-urlencoded" );
     }
 
-    QByteArray parametersString = paramsToString( *params, ParseForSignatureBaseString );
-    QByteArray percentParametersString = parametersString.toPercentEncoding();
-
-    QByteArray digest;
+    request.setUrl( QUrl( reply->requestUrl ) );
+    TransportPrivate::prepareRequest( &request );
 
-    // PLAINTEXT doesn't use the Signature Base String
-    if ( signatureMethod == PLAINTEXT ) {
-        digest = createPlaintextSignature( tokenSecret );
+    if ( reply->httpMethod == GET ) {
+        reply->addNetworkReply( networkManager()->get( request ) );
     } else {
-        // 4. create signature base string
-        QByteArray signatureBaseString;
-        signatureBaseString.append( httpMethodString + "&" );
-        signatureBaseString.append( percentRequestUrl + "&" );
-        signatureBaseString.append( percentParametersString );
-
-
-        if ( signatureMethod == HMAC_SHA1 ) {
-            if( !QCA::isSupported( "hmac(sha1)" ) ) {
-                qFatal( "HMAC(SHA1) is not supported!" );
-            }
-            // create key for HMAC-SHA1 hashing
-            QByteArray key( consumerSecret.toPercentEncoding() + "&" + tokenSecret.toPercentEncoding() );
-
-            // create HMAC-SHA1 digest in Base64
-            QCA::MessageAuthenticationCode hmac( "hmac(sha1)", QCA::SymmetricKey( key ) );
-            QCA::SecureArray array( signatureBaseString );
-            hmac.update( array );
-            QCA::SecureArray resultArray = hmac.final();
-            digest = resultArray.toByteArray().toBase64();
-
-        } else if ( signatureMethod == RSA_SHA1 ) {
-            // sign the Signature Base String with the RSA key
-            digest = privateKey.signMessage( QCA::MemoryRegion( signatureBaseString ),
-                                             QCA::EMSA3_SHA1 ).toBase64();
-        }
+        reply->addNetworkReply( networkManager()->post( request, authorizationHeader ) );
     }
 
-    // percent-encode the digest
-    QByteArray signature = digest.toPercentEncoding();
-    return signature;
+    return NoError;
 }
 
-QByteArray QOAuth::InterfacePrivate::createPlaintextSignature( const QByteArray &tokenSecret )
+QOAuth::ParamMap QOAuth::InterfacePrivate::sendRequest( const QString &requestUrl, HttpMethod httpMethod,
+                                                        SignatureMethod signatureMethod, const QByteArray &token,
+                                                        const QByteArray &tokenSecret, const ParamMap &params,
+                                                        const Deadline &deadline )
 {
-    if ( consumerSecret.isEmpty() ) {
-        qWarning() << __FUNCTION__ << "- consumer secret is empty, make sure that you set it"
-                                      "with QOAuth::Interface::setConsumerSecret()";
-        error = ConsumerSecretEmpty;
-        return QByteArray();
+    Reply *reply = startRequest( requestUrl, httpMethod, signatureMethod, token, tokenSecret, params, deadline );
+
+    // wait for this request only, in a loop of its own
+    if ( !reply->isFinished() ) {
+        QEventLoop loop;
+        QObject::connect( reply, SIGNAL(finished()), &loop, SLOT(quit()) );
+        loop.exec();
     }
 
-    // get percent encoded consumer secret and token secret, join and return
-    return consumerSecret.toPercentEncoding() + "&" + tokenSecret.toPercentEncoding();
+    error = reply->error();
+    ParamMap replyParams = reply->result();
+    delete reply;
+
+    return replyParams;
 }
 
 #include "moc_interface.cpp"
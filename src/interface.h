@@ -34,13 +34,36 @@
 
 #include "qoauth_global.h"
 #include "qoauth_namespace.h"
+#include "signer.h"
+#include "retrypolicy.h"
+#include "deadline.h"
 
 class QNetworkAccessManager;
-class QNetworkReply;
 
 namespace QOAuth {
 
 class InterfacePrivate;
+class Reply;
+class TokenCache;
+
+struct QOAUTH_EXPORT TokenExchange
+{
+    TokenExchange();
+    TokenExchange( const QByteArray &token, const QByteArray &tokenSecret,
+                   const ParamMap &params = ParamMap() );
+
+    QByteArray token;
+    QByteArray tokenSecret;
+    ParamMap params;
+};
+
+struct QOAUTH_EXPORT TokenExchangeResult
+{
+    TokenExchangeResult();
+
+    int error;
+    ParamMap result;
+};
 
 class QOAUTH_EXPORT Interface : public QObject
 {
@@ -49,10 +72,18 @@ class QOAUTH_EXPORT Interface : public QObject
     Q_PROPERTY( QByteArray consumerKey READ consumerKey WRITE setConsumerKey )
     Q_PROPERTY( QByteArray consumerSecret READ consumerSecret WRITE setConsumerSecret )
     Q_PROPERTY( uint requestTimeout READ requestTimeout WRITE setRequestTimeout )
+    Q_PROPERTY( qint64 maxReplySize READ maxReplySize WRITE setMaxReplySize )
     Q_PROPERTY( bool ignoreSslErrors READ ignoreSslErrors WRITE setIgnoreSslErrors )
     Q_PROPERTY( int error READ error )
 
 public:
+    enum {
+        // the number of connections QNetworkAccessManager opens to a single host
+        DefaultConcurrency = 6,
+        // token replies are a few hundred bytes long
+        DefaultMaxReplySize = 64 * 1024
+    };
+
     Interface( QObject *parent = 0 );
     Interface( QNetworkAccessManager *manager, QObject *parent = 0 );
     virtual ~Interface();
@@ -72,20 +103,61 @@ public:
     uint requestTimeout() const;
     void setRequestTimeout( uint msec );
 
+    qint64 maxReplySize() const;
+    void setMaxReplySize( qint64 size );
+
+    RetryPolicy retryPolicy() const;
+    void setRetryPolicy( const RetryPolicy &policy );
+
     int error() const;
 
+    Signer signer() const;
+
+    QSharedPointer<NonceSource> nonceSource() const;
+    void setNonceSource( const QSharedPointer<NonceSource> &source );
+
+    QSharedPointer<TimestampSource> timestampSource() const;
+    void setTimestampSource( const QSharedPointer<TimestampSource> &source );
+
+    QSharedPointer<TokenCache> tokenCache() const;
+    void setTokenCache( const QSharedPointer<TokenCache> &cache );
+
     bool setRSAPrivateKey( const QString &key,
                            const QCA::SecureArray &passphrase = QCA::SecureArray() );
     bool setRSAPrivateKeyFromFile( const QString &filename,
                                    const QCA::SecureArray &passphrase = QCA::SecureArray() );
+    bool setRSAPrivateKeyFromDER( const QByteArray &key,
+                                  const QCA::SecureArray &passphrase = QCA::SecureArray() );
 
 
     ParamMap requestToken( const QString &requestUrl, HttpMethod httpMethod,
                            SignatureMethod signatureMethod = HMAC_SHA1, const ParamMap &params = ParamMap() );
+    ParamMap requestToken( const QString &requestUrl, HttpMethod httpMethod,
+                           SignatureMethod signatureMethod, const ParamMap &params,
+                           const Deadline &deadline );
 
     ParamMap accessToken( const QString &requestUrl, HttpMethod httpMethod, const QByteArray &token,
                           const QByteArray &tokenSecret, SignatureMethod signatureMethod = HMAC_SHA1,
                           const ParamMap &params = ParamMap() );
+    ParamMap accessToken( const QString &requestUrl, HttpMethod httpMethod, const QByteArray &token,
+                          const QByteArray &tokenSecret, SignatureMethod signatureMethod,
+                          const ParamMap &params, const Deadline &deadline );
+
+    Reply* requestTokenAsync( const QString &requestUrl, HttpMethod httpMethod,
+                              SignatureMethod signatureMethod = HMAC_SHA1, const ParamMap &params = ParamMap(),
+                              const Deadline &deadline = Deadline() );
+
+    Reply* accessTokenAsync( const QString &requestUrl, HttpMethod httpMethod, const QByteArray &token,
+                             const QByteArray &tokenSecret, SignatureMethod signatureMethod = HMAC_SHA1,
+                             const ParamMap &params = ParamMap(), const Deadline &deadline = Deadline() );
+
+    QList<TokenExchangeResult> accessTokens( const QString &requestUrl, HttpMethod httpMethod,
+                                             const QList<TokenExchange> &exchanges,
+                                             SignatureMethod signatureMethod = HMAC_SHA1,
+                                             int maxConcurrent = DefaultConcurrency,
+                                             const Deadline &deadline = Deadline() );
+
+    int pendingRequests() const;
 
     QByteArray createParametersString( const QString &requestUrl, HttpMethod httpMethod,
                                        const QByteArray &token, const QByteArray &tokenSecret,
@@ -100,10 +172,8 @@ protected:
 private:
     Q_DISABLE_COPY(Interface)
     Q_DECLARE_PRIVATE(Interface)
-    Q_PRIVATE_SLOT(d_func(), void _q_parseReply(QNetworkReply *reply))
-    Q_PRIVATE_SLOT(d_func(), void _q_setPassphrase(int id, const QCA::Event &event))
-    Q_PRIVATE_SLOT(d_func(), void _q_handleSslErrors( QNetworkReply *reply,
-                                                      const QList<QSslError> &errors ))
+
+    friend class ReplyPrivate;
 
 #ifdef UNIT_TEST
     friend class Ut_Interface;
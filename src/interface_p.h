@@ -29,15 +29,20 @@
 #define QOAUTH_P_H
 
 #include "interface.h"
+#include "signer.h"
+#include "paramlist.h"
+#include "privatekeycache_p.h"
+#include "qcaruntime_p.h"
+#include "retrypolicy_p.h"
+#include "tokencache.h"
 #include <QPointer>
 #include <QNetworkAccessManager>
 
-class QNetworkReply;
-class QEventLoop;
-
 namespace QOAuth {
 
 class Interface;
+class Reply;
+class ReplyPrivate;
 
 
 class QOAUTH_EXPORT InterfacePrivate
@@ -52,11 +57,6 @@ public:
         AccessToken
     };
 
-    enum KeySource {
-        KeyFromString,
-        KeyFromFile
-    };
-
     static const QByteArray OAuthVersion;
     static const QByteArray ParamToken;
     static const QByteArray ParamTokenSecret;
@@ -72,53 +72,56 @@ public:
     InterfacePrivate();
     void init();
     void setupNetworkAccessManager();
-
-    QByteArray httpMethodToString( HttpMethod method );
-    QByteArray signatureMethodToString( SignatureMethod method );
-    ParamMap replyToMap( const QByteArray &data );
-    QByteArray paramsToString( const ParamMap &parameters, ParsingMode mode );
-
-    QByteArray createSignature( const QString &requestUrl, HttpMethod httpMethod,
-                                SignatureMethod signatureMethod, const QByteArray &token,
-                                const QByteArray &tokenSecret, ParamMap *params );
-
-    // for PLAINTEXT only
-    QByteArray createPlaintextSignature( const QByteArray &tokenSecret );
-
+    // creates the manager on first use
+    QNetworkAccessManager *networkManager();
+
+    static QByteArray httpMethodToString( HttpMethod method );
+    static QByteArray signatureMethodToString( SignatureMethod method );
+    // parses application/x-www-form-urlencoded data, leaving the names
+    // and values in the percent-encoded form they are sent in
+    static ParamMap replyToMap( const QByteArray &data );
+    static QByteArray paramsToString( const ParamMap &parameters, ParsingMode mode );
+    static QByteArray paramsToString( const ParamList &parameters, ParsingMode mode );
+
+    void updateSigner();
+
+    Reply* startRequest( const QString &requestUrl, HttpMethod httpMethod, SignatureMethod signatureMethod,
+                         const QByteArray &token, const QByteArray &tokenSecret, const ParamMap &params,
+                         const Deadline &deadline );
     ParamMap sendRequest( const QString &requestUrl, HttpMethod httpMethod, SignatureMethod signatureMethod,
-                          const QByteArray &token, const QByteArray &tokenSecret, const ParamMap &params );
+                          const QByteArray &token, const QByteArray &tokenSecret, const ParamMap &params,
+                          const Deadline &deadline );
+    // signs the request of the reply with a fresh nonce and sends it
+    int sendAttempt( ReplyPrivate *reply );
 
     // RSA-SHA1 stuff
-    void setPrivateKey( const QString &source, const QCA::SecureArray &passphrase, KeySource from );
-    void readKeyFromLoader( QCA::KeyLoader *keyLoader );
+    void setPrivateKey( const PrivateKeyCache::Key &key, QCA::ConvertResult result );
 
     bool privateKeySet;
 
-    QCA::Initializer initializer;
+    QcaRuntime qcaRuntime;
     QCA::PrivateKey privateKey;
-    QCA::SecureArray passphrase;
-    QCA::EventHandler eventHandler;
+    // keeps the key in PrivateKeyCache for the other interfaces
+    PrivateKeyCache::Key sharedPrivateKey;
     // end of RSA-SHA1 stuff
 
     bool ignoreSslErrors;
     QByteArray consumerKey;
     QByteArray consumerSecret;
-
-    ParamMap replyParams;
+    Signer signer;
 
     QPointer<QNetworkAccessManager> manager;
-    QEventLoop *loop;
 
     uint requestTimeout;
+    qint64 maxReplySize;
+    RetryPolicy retryPolicy;
+    LatencyHistory latencies;
+    // null when tokens aren't cached
+    QSharedPointer<TokenCache> tokenCache;
     int error;
 
 protected:
     Interface *q_ptr;
-
-public:
-    void _q_parseReply( QNetworkReply *reply );
-    void _q_setPassphrase( int id, const QCA::Event &event );
-    void _q_handleSslErrors( QNetworkReply *reply, const QList<QSslError> &errors );
 };
 
 } // namespace QOAuth
@@ -0,0 +1,192 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "noncesource.h"
+#include "noncesource_p.h"
+#include "cpufeatures_p.h"
+#include "qcaruntime_p.h"
+
+#include <QtCrypto>
+#include <QtDebug>
+
+#ifdef Q_OS_UNIX
+#  include <pthread.h>
+#endif
+
+#ifdef QOAUTH_X86_SIMD
+#  include <immintrin.h>
+#endif
+
+static const char digits[] = "0123456789abcdef";
+
+static char *encodeScalar( char *output, const uchar *data, int size )
+{
+    for ( int i = 0; i < size; ++i ) {
+        *output++ = digits[data[i] >> 4];
+        *output++ = digits[data[i] & 0x0f];
+    }
+    return output;
+}
+
+#ifdef QOAUTH_X86_SIMD
+
+// the nibbles are looked up in the digits with a byte shuffle,
+// and the high and low ones are interleaved back into the output order
+QOAUTH_TARGET("ssse3")
+static char *encodeSsse3( char *output, const uchar *data, int size )
+{
+    const __m128i table = _mm_loadu_si128( (const __m128i *) digits );
+    const __m128i nibble = _mm_set1_epi8( 0x0f );
+
+    int i = 0;
+    for ( ; i + 16 <= size; i += 16 ) {
+        __m128i in = _mm_loadu_si128( (const __m128i *) ( data + i ) );
+        __m128i high = _mm_shuffle_epi8( table, _mm_and_si128( _mm_srli_epi16( in, 4 ), nibble ) );
+        __m128i low = _mm_shuffle_epi8( table, _mm_and_si128( in, nibble ) );
+        _mm_storeu_si128( (__m128i *) output, _mm_unpacklo_epi8( high, low ) );
+        _mm_storeu_si128( (__m128i *) ( output + 16 ), _mm_unpackhi_epi8( high, low ) );
+        output += 32;
+    }
+
+    return encodeScalar( output, data + i, size - i );
+}
+
+#endif // QOAUTH_X86_SIMD
+
+char *QOAuth::Hex::encode( char *output, const uchar *data, int size )
+{
+#ifdef QOAUTH_X86_SIMD
+    static const bool ssse3 = CpuFeatures::hasFeature( CpuFeatures::SSSE3 );
+    if ( ssse3 ) {
+        return encodeSsse3( output, data, size );
+    }
+#endif
+    return encodeScalar( output, data, size );
+}
+
+
+#ifdef Q_OS_UNIX
+static void forkChildHandler()
+{
+    QOAuth::RandomNonceSource::processForked();
+}
+#endif
+
+QAtomicInt QOAuth::RandomNonceSource::forkGeneration( 0 );
+
+QOAuth::RandomNonceSource::RandomNonceSource()
+{
+    QcaRuntime::ensureInitialized();
+
+#ifdef Q_OS_UNIX
+    static const bool registered = ( pthread_atfork( 0, 0, forkChildHandler ) == 0 );
+    if ( !registered ) {
+        qWarning() << __FUNCTION__ << "- unable to register the fork handler";
+    }
+#endif
+}
+
+QByteArray QOAuth::RandomNonceSource::nonce()
+{
+    NonceBuffer *buffer = buffers.localData();
+    if ( !buffer ) {
+        buffer = new NonceBuffer;
+        buffers.setLocalData( buffer );
+    }
+
+    int currentGeneration = generation();
+    if ( buffer->position + NonceSize > NonceBuffer::BlockSize
+         || buffer->generation != currentGeneration ) {
+        QCA::SecureArray random = QCA::Random::randomArray( NonceBuffer::BlockSize );
+        memcpy( buffer->bytes, random.constData(), NonceBuffer::BlockSize );
+        buffer->position = 0;
+        buffer->generation = currentGeneration;
+    }
+
+    QByteArray nonce( Hex::encodedSize( NonceSize ), Qt::Uninitialized );
+    Hex::encode( nonce.data(), buffer->bytes + buffer->position, NonceSize );
+    // the bytes are never handed out twice
+    memset( buffer->bytes + buffer->position, 0, NonceSize );
+    buffer->position += NonceSize;
+
+    return nonce;
+}
+
+int QOAuth::RandomNonceSource::generation()
+{
+#if QT_VERSION >= 0x050000
+    return forkGeneration.load();
+#else
+    return forkGeneration;
+#endif
+}
+
+void QOAuth::RandomNonceSource::processForked()
+{
+    forkGeneration.ref();
+}
+
+
+/*!
+  \class QOAuth::NonceSource noncesource.h <QtOAuth/noncesource.h>
+  \brief Provides the <em>oauth_nonce</em> values for the signed requests.
+
+  Every request signed with QOAuth::Signer gets a nonce from the signer's nonce source.
+  The default source, returned by defaultSource(), creates nonces of 16 random bytes
+  encoded as 32 hexadecimal digits. The random bytes are taken from the QCA random
+  provider in blocks of 4 KiB, separately for every thread, so most of the nonces
+  are created without calling the provider at all.
+
+  Subclass NonceSource to supply your own nonces, e.g. predictable ones in tests,
+  and install it with QOAuth::Signer::setNonceSource() or
+  QOAuth::Interface::setNonceSource().
+
+  \sa QOAuth::Signer::nonceSource()
+*/
+
+/*!
+  \brief Destroys the nonce source.
+*/
+
+QOAuth::NonceSource::~NonceSource()
+{
+}
+
+/*!
+  \fn QByteArray QOAuth::NonceSource::nonce()
+  \brief Returns a new nonce.
+
+  The returned nonce is used as is, percent-encoding is applied afterwards by the signer.
+  The function is called from every thread that signs requests, possibly at the same time,
+  so it has to be thread-safe.
+*/
+
+/*!
+  \brief Returns the nonce source used by the signers that didn't get a custom one.
+
+  The source is shared by the whole process.
+*/
+
+QSharedPointer<QOAuth::NonceSource> QOAuth::NonceSource::defaultSource()
+{
+    static QSharedPointer<NonceSource> source( new RandomNonceSource );
+    return source;
+}
@@ -0,0 +1,90 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file noncesource_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef NONCESOURCE_P_H
+#define NONCESOURCE_P_H
+
+#include <QAtomicInt>
+#include <QThreadStorage>
+
+#include "noncesource.h"
+
+namespace QOAuth {
+
+// Lowercase hexadecimal encoding, giving the same output as QByteArray::toHex().
+// With SSSE3, 16 input bytes are encoded at a time.
+namespace Hex {
+
+    inline int encodedSize( int size ) { return size * 2; }
+
+    // encodes data into output, which has to have room for encodedSize() bytes,
+    // and returns the pointer past the last byte written
+    QOAUTH_EXPORT char *encode( char *output, const uchar *data, int size );
+
+} // namespace Hex
+
+// The random bytes of one thread. It's refilled with a single call to the
+// QCA random provider once every BlockSize / NonceSize nonces.
+struct NonceBuffer
+{
+    enum { BlockSize = 4096 };
+
+    NonceBuffer() : position( BlockSize ), generation( -1 ) {}
+
+    uchar bytes[BlockSize];
+    int position;
+    // the process generation the bytes were drawn in
+    int generation;
+};
+
+// The default source: 16 random bytes per nonce, hex-encoded. Each thread
+// takes the bytes from its own buffer, so no locking is needed. The buffers
+// are discarded in the child process after fork(), which would otherwise
+// hand out the very same nonces as its parent.
+class QOAUTH_EXPORT RandomNonceSource : public NonceSource
+{
+public:
+    enum { NonceSize = 16 };
+
+    RandomNonceSource();
+
+    QByteArray nonce();
+
+    // bumped in the child process after every fork()
+    static int generation();
+    static void processForked();
+
+private:
+    QThreadStorage<NonceBuffer *> buffers;
+
+    static QAtomicInt forkGeneration;
+};
+
+} // namespace QOAuth
+
+#endif // NONCESOURCE_P_H
@@ -0,0 +1,173 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "paramlist.h"
+
+#include <QtAlgorithms>
+
+/*!
+  \class QOAuth::ParamList paramlist.h <QtOAuth>
+  \brief A flat list of request parameters.
+
+  ParamList keeps the parameters in a contiguous array of name/value pairs. The first
+  \ref PreallocatedSize of them don't need any memory allocation at all. Unlike
+  QOAuth::ParamMap it isn't kept sorted all the time. Instead it's sorted once,
+  by names and then values, which is the order the parameters take in the
+  Signature Base String.
+
+  ParamList converts implicitly from QOAuth::ParamMap, and can be converted back
+  with \ref toParamMap().
+
+  \sa QOAuth::Signer::sign()
+*/
+
+/*!
+  \brief Creates an empty parameters list.
+*/
+
+QOAuth::ParamList::ParamList() :
+        sorted( true )
+{
+}
+
+/*!
+  \brief Creates a list of the parameters contained in \a map.
+
+  The list is sorted.
+*/
+
+QOAuth::ParamList::ParamList( const ParamMap &map ) :
+        sorted( true )
+{
+    params.reserve( map.size() );
+    ParamMap::const_iterator it = map.constBegin();
+    while ( it != map.constEnd() ) {
+        // the map keeps names sorted, but values of a repeated name in the reverse order of insertion
+        int first = params.size();
+        const QByteArray &name = it.key();
+        for ( ; it != map.constEnd() && it.key() == name; ++it ) {
+            params.append( Param( name, it.value() ) );
+        }
+        if ( params.size() - first > 1 ) {
+            qSort( params.data() + first, params.data() + params.size() );
+        }
+    }
+}
+
+/*!
+  \brief Returns a list of the parameters contained in \a map.
+*/
+
+QOAuth::ParamList QOAuth::ParamList::fromParamMap( const ParamMap &map )
+{
+    return ParamList( map );
+}
+
+/*!
+  \brief Returns a QOAuth::ParamMap containing all the parameters of the list.
+*/
+
+QOAuth::ParamMap QOAuth::ParamList::toParamMap() const
+{
+    ParamMap map;
+    for ( const_iterator it = constBegin(); it != constEnd(); ++it ) {
+        map.insert( it->first, it->second );
+    }
+    return map;
+}
+
+/*!
+  \brief Appends the parameter \a name with the \a value to the end of the list.
+*/
+
+void QOAuth::ParamList::append( const QByteArray &name, const QByteArray &value )
+{
+    if ( sorted && !params.isEmpty() && Param( name, value ) < params.at( params.size() - 1 ) ) {
+        sorted = false;
+    }
+    params.append( Param( name, value ) );
+}
+
+/*!
+  \brief Appends all the parameters of \a other to the end of the list.
+*/
+
+void QOAuth::ParamList::append( const ParamList &other )
+{
+    params.reserve( params.size() + other.size() );
+    for ( const_iterator it = other.constBegin(); it != other.constEnd(); ++it ) {
+        append( it->first, it->second );
+    }
+}
+
+/*!
+  \brief Inserts the parameter \a name with the \a value in its place in the sorted list.
+
+  The list is sorted first, if needed.
+*/
+
+void QOAuth::ParamList::insertSorted( const QByteArray &name, const QByteArray &value )
+{
+    sort();
+
+    Param param( name, value );
+    Param *position = qUpperBound( params.data(), params.data() + params.size(), param );
+    int index = position - params.data();
+
+    params.append( param );
+    for ( int i = params.size() - 1; i > index; --i ) {
+        qSwap( params[i], params[i - 1] );
+    }
+}
+
+/*!
+  \brief Makes room for \a size parameters, so that adding them doesn't reallocate the list.
+*/
+
+void QOAuth::ParamList::reserve( int size )
+{
+    params.reserve( size );
+}
+
+/*!
+  \brief Removes all the parameters.
+*/
+
+void QOAuth::ParamList::clear()
+{
+    params.clear();
+    sorted = true;
+}
+
+/*!
+  \brief Sorts the parameters by their names, and the parameters of the same name by values.
+
+  The list remembers being sorted until a parameter is appended out of order, so sorting
+  a sorted list costs nothing.
+*/
+
+void QOAuth::ParamList::sort()
+{
+    if ( sorted ) {
+        return;
+    }
+    qSort( params.data(), params.data() + params.size() );
+    sorted = true;
+}
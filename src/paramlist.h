@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file paramlist.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef PARAMLIST_H
+#define PARAMLIST_H
+
+#include <QByteArray>
+#include <QPair>
+#include <QVarLengthArray>
+
+#include "qoauth_global.h"
+#include "qoauth_namespace.h"
+
+namespace QOAuth {
+
+class QOAUTH_EXPORT ParamList
+{
+public:
+    typedef QPair<QByteArray,QByteArray> Param;
+    typedef const Param *const_iterator;
+
+    enum { PreallocatedSize = 16 };
+
+    ParamList();
+    ParamList( const ParamMap &map );
+
+    static ParamList fromParamMap( const ParamMap &map );
+    ParamMap toParamMap() const;
+
+    void append( const QByteArray &name, const QByteArray &value );
+    void append( const ParamList &other );
+    void insertSorted( const QByteArray &name, const QByteArray &value );
+    void reserve( int size );
+    void clear();
+
+    inline int size() const { return params.size(); }
+    inline bool isEmpty() const { return params.isEmpty(); }
+    inline const Param &at( int i ) const { return params.at( i ); }
+    inline const_iterator constBegin() const { return params.constData(); }
+    inline const_iterator constEnd() const { return params.constData() + params.size(); }
+
+    void sort();
+    inline bool isSorted() const { return sorted; }
+
+private:
+    QVarLengthArray<Param,PreallocatedSize> params;
+    bool sorted;
+};
+
+} // namespace QOAuth
+
+#endif // PARAMLIST_H
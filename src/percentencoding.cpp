@@ -0,0 +1,289 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "percentencoding_p.h"
+#include "cpufeatures_p.h"
+
+#include <string.h>
+
+#ifdef QOAUTH_X86_SIMD
+#  include <immintrin.h>
+#endif
+
+// 1 for the characters that are left as they are
+static const uchar unreserved[256] = {
+    0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0, 0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0,
+    0,0,0,0,0,0,0,0,0,0,0,0,0,1,1,0, 1,1,1,1,1,1,1,1,1,1,0,0,0,0,0,0,
+    0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,0,0,0,0,1,
+    0,1,1,1,1,1,1,1,1,1,1,1,1,1,1,1, 1,1,1,1,1,1,1,1,1,1,1,0,0,0,1,0
+};
+
+static const char hexDigits[] = "0123456789ABCDEF";
+
+// the same as QString::toLatin1() gives for the character
+static inline uchar toLatin1( ushort c )
+{
+    return c > 0xff ? '?' : uchar( c );
+}
+
+// The scalar versions of the kernels below. They're used on their own where
+// SIMD isn't available, and for the tails shorter than a vector otherwise.
+
+static int unreservedPrefix( const char *data, int size )
+{
+    int i = 0;
+    while ( i < size && unreserved[(uchar) data[i]] ) {
+        ++i;
+    }
+    return i;
+}
+
+static int reservedCount( const char *data, int size )
+{
+    int count = 0;
+    for ( int i = 0; i < size; ++i ) {
+        count += !unreserved[(uchar) data[i]];
+    }
+    return count;
+}
+
+static int unreservedPrefix( const ushort *data, int size )
+{
+    int i = 0;
+    while ( i < size && unreserved[toLatin1( data[i] )] ) {
+        ++i;
+    }
+    return i;
+}
+
+static int reservedCount( const ushort *data, int size )
+{
+    int count = 0;
+    for ( int i = 0; i < size; ++i ) {
+        count += !unreserved[toLatin1( data[i] )];
+    }
+    return count;
+}
+
+#ifdef QOAUTH_X86_SIMD
+
+// Unreserved characters are found with signed comparisons against the ranges
+// A-Z, a-z, 0-9 and equality with the four marks. Bytes (or UTF-16 units) with
+// the top bit set compare as negative, so they fall outside all the ranges.
+
+#define QOAUTH_IN_RANGE8(c, low, high) \
+    _mm256_and_si256( _mm256_cmpgt_epi8( (c), _mm256_set1_epi8( (low) - 1 ) ), \
+                      _mm256_cmpgt_epi8( _mm256_set1_epi8( (high) + 1 ), (c) ) )
+#define QOAUTH_IN_RANGE16(c, low, high) \
+    _mm256_and_si256( _mm256_cmpgt_epi16( (c), _mm256_set1_epi16( (low) - 1 ) ), \
+                      _mm256_cmpgt_epi16( _mm256_set1_epi16( (high) + 1 ), (c) ) )
+
+// a bit for every byte of the 32, set for the unreserved ones
+QOAUTH_TARGET("avx2")
+static inline uint unreservedMask8( const char *data )
+{
+    __m256i c = _mm256_loadu_si256( (const __m256i *) data );
+    __m256i mask = _mm256_or_si256( _mm256_or_si256( QOAUTH_IN_RANGE8( c, 'A', 'Z' ),
+                                                     QOAUTH_IN_RANGE8( c, 'a', 'z' ) ),
+                                    _mm256_or_si256( QOAUTH_IN_RANGE8( c, '0', '9' ),
+                                                     QOAUTH_IN_RANGE8( c, '-', '.' ) ) );
+    mask = _mm256_or_si256( mask, _mm256_or_si256( _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '_' ) ),
+                                                   _mm256_cmpeq_epi8( c, _mm256_set1_epi8( '~' ) ) ) );
+    return _mm256_movemask_epi8( mask );
+}
+
+// two bits for every of the 16 characters, set for the unreserved ones
+QOAUTH_TARGET("avx2")
+static inline uint unreservedMask16( const ushort *data )
+{
+    __m256i c = _mm256_loadu_si256( (const __m256i *) data );
+    __m256i mask = _mm256_or_si256( _mm256_or_si256( QOAUTH_IN_RANGE16( c, 'A', 'Z' ),
+                                                     QOAUTH_IN_RANGE16( c, 'a', 'z' ) ),
+                                    _mm256_or_si256( QOAUTH_IN_RANGE16( c, '0', '9' ),
+                                                     QOAUTH_IN_RANGE16( c, '-', '.' ) ) );
+    mask = _mm256_or_si256( mask, _mm256_or_si256( _mm256_cmpeq_epi16( c, _mm256_set1_epi16( '_' ) ),
+                                                   _mm256_cmpeq_epi16( c, _mm256_set1_epi16( '~' ) ) ) );
+    return _mm256_movemask_epi8( mask );
+}
+
+#undef QOAUTH_IN_RANGE8
+#undef QOAUTH_IN_RANGE16
+
+QOAUTH_TARGET("avx2")
+static int unreservedPrefixAvx2( const char *data, int size )
+{
+    int i = 0;
+    for ( ; i + 32 <= size; i += 32 ) {
+        uint mask = unreservedMask8( data + i );
+        if ( mask != 0xffffffffu ) {
+            return i + __builtin_ctz( ~mask );
+        }
+    }
+    return i + unreservedPrefix( data + i, size - i );
+}
+
+QOAUTH_TARGET("avx2,popcnt")
+static int reservedCountAvx2( const char *data, int size )
+{
+    int count = 0;
+    int i = 0;
+    for ( ; i + 32 <= size; i += 32 ) {
+        count += __builtin_popcount( ~unreservedMask8( data + i ) );
+    }
+    return count + reservedCount( data + i, size - i );
+}
+
+QOAUTH_TARGET("avx2")
+static int unreservedPrefixAvx2( const ushort *data, int size )
+{
+    int i = 0;
+    for ( ; i + 16 <= size; i += 16 ) {
+        uint mask = unreservedMask16( data + i );
+        if ( mask != 0xffffffffu ) {
+            return i + __builtin_ctz( ~mask ) / 2;
+        }
+    }
+    return i + unreservedPrefix( data + i, size - i );
+}
+
+QOAUTH_TARGET("avx2,popcnt")
+static int reservedCountAvx2( const ushort *data, int size )
+{
+    int count = 0;
+    int i = 0;
+    for ( ; i + 16 <= size; i += 16 ) {
+        count += __builtin_popcount( ~unreservedMask16( data + i ) ) / 2;
+    }
+    return count + reservedCount( data + i, size - i );
+}
+
+#endif // QOAUTH_X86_SIMD
+
+static bool useAvx2()
+{
+#ifdef QOAUTH_X86_SIMD
+    static const bool avx2 = QOAuth::CpuFeatures::hasFeature( QOAuth::CpuFeatures::AVX2 );
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+// the length of the run of unreserved characters data starts with
+static inline int findReserved( const char *data, int size )
+{
+#ifdef QOAUTH_X86_SIMD
+    if ( useAvx2() ) {
+        return unreservedPrefixAvx2( data, size );
+    }
+#endif
+    return unreservedPrefix( data, size );
+}
+
+static inline int findReserved( const ushort *data, int size )
+{
+#ifdef QOAUTH_X86_SIMD
+    if ( useAvx2() ) {
+        return unreservedPrefixAvx2( data, size );
+    }
+#endif
+    return unreservedPrefix( data, size );
+}
+
+static inline int countReserved( const char *data, int size )
+{
+#ifdef QOAUTH_X86_SIMD
+    if ( useAvx2() ) {
+        return reservedCountAvx2( data, size );
+    }
+#endif
+    return reservedCount( data, size );
+}
+
+static inline int countReserved( const ushort *data, int size )
+{
+#ifdef QOAUTH_X86_SIMD
+    if ( useAvx2() ) {
+        return reservedCountAvx2( data, size );
+    }
+#endif
+    return reservedCount( data, size );
+}
+
+
+int QOAuth::PercentEncoding::encodedSize( const char *data, int size )
+{
+    // two more characters for every encoded one
+    return size + 2 * countReserved( data, size );
+}
+
+int QOAuth::PercentEncoding::encodedSize( const QString &latin1 )
+{
+    return latin1.size() + 2 * countReserved( latin1.utf16(), latin1.size() );
+}
+
+char *QOAuth::PercentEncoding::encode( char *output, const char *data, int size )
+{
+    int i = 0;
+    forever {
+        // runs of unreserved characters are copied as they are
+        int run = findReserved( data + i, size - i );
+        memcpy( output, data + i, run );
+        output += run;
+        i += run;
+        if ( i == size ) {
+            return output;
+        }
+
+        uchar c = data[i++];
+        *output++ = '%';
+        *output++ = hexDigits[c >> 4];
+        *output++ = hexDigits[c & 0xf];
+    }
+}
+
+char *QOAuth::PercentEncoding::encode( char *output, const ushort *utf16, int size )
+{
+    const ushort *data = utf16;
+    int i = 0;
+    forever {
+        int run = findReserved( data + i, size - i );
+        for ( int j = 0; j < run; ++j ) {
+            output[j] = char( data[i + j] );
+        }
+        output += run;
+        i += run;
+        if ( i == size ) {
+            return output;
+        }
+
+        uchar c = toLatin1( data[i++] );
+        *output++ = '%';
+        *output++ = hexDigits[c >> 4];
+        *output++ = hexDigits[c & 0xf];
+    }
+}
+
+QByteArray QOAuth::PercentEncoding::encode( const QByteArray &data )
+{
+    QByteArray result( encodedSize( data ), Qt::Uninitialized );
+    encode( result.data(), data );
+    return result;
+}
@@ -0,0 +1,66 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file percentencoding_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef PERCENTENCODING_P_H
+#define PERCENTENCODING_P_H
+
+#include <QByteArray>
+#include <QString>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+// Percent-encoding compatible with QByteArray::toPercentEncoding() with no
+// exceptions given: everything but ALPHA, DIGIT, '-', '.', '_' and '~' is
+// encoded, with uppercase hex digits. Working on raw buffers lets the callers
+// size their output once and encode several pieces into it. With AVX2, runs
+// of unreserved characters are found 32 bytes at a time and copied unchanged.
+namespace PercentEncoding {
+
+    // the size of data after encoding
+    QOAUTH_EXPORT int encodedSize( const char *data, int size );
+    QOAUTH_EXPORT int encodedSize( const QString &latin1 );
+
+    // encodes data into output, which has to have room for encodedSize() bytes,
+    // and returns the pointer past the last byte written
+    QOAUTH_EXPORT char *encode( char *output, const char *data, int size );
+    // characters of a string are taken as QString::toLatin1() gives them
+    QOAUTH_EXPORT char *encode( char *output, const ushort *utf16, int size );
+
+    // a replacement for data.toPercentEncoding()
+    QOAUTH_EXPORT QByteArray encode( const QByteArray &data );
+
+    inline int encodedSize( const QByteArray &data ) { return encodedSize( data.constData(), data.size() ); }
+    inline char *encode( char *output, const QByteArray &data ) { return encode( output, data.constData(), data.size() ); }
+    inline char *encode( char *output, const QString &latin1 ) { return encode( output, latin1.utf16(), latin1.size() ); }
+
+} // namespace PercentEncoding
+
+} // namespace QOAuth
+
+#endif // PERCENTENCODING_P_H
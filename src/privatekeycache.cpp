@@ -0,0 +1,228 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "privatekeycache_p.h"
+#include "sha1_p.h"
+#include "qcaruntime_p.h"
+
+#include <QDateTime>
+#include <QFile>
+#include <QFileInfo>
+#include <QMutexLocker>
+
+Q_GLOBAL_STATIC(QOAuth::PrivateKeyCache, globalPrivateKeyCache)
+
+QOAuth::PrivateKeyCache *QOAuth::PrivateKeyCache::instance()
+{
+    return globalPrivateKeyCache();
+}
+
+QOAuth::PrivateKeyCache::PrivateKeyCache() :
+        mutex(),
+        hitCount( 0 ),
+        missCount( 0 )
+{
+    QcaRuntime::ensureInitialized();
+    salt = QCA::Random::randomArray( SaltSize ).toByteArray();
+}
+
+QByteArray QOAuth::PrivateKeyCache::passphraseId( const QCA::SecureArray &passphrase ) const
+{
+    // a plain hash of the passphrase would be an offline-crackable copy of it,
+    // kept in memory for as long as the process lives
+    HmacSha1 hmac( HmacSha1Key( salt ) );
+    hmac.update( passphrase.constData(), passphrase.size() );
+    return hmac.final().toHex();
+}
+
+QOAuth::PrivateKeyCache::Key QOAuth::PrivateKeyCache::fromFile( const QString &fileName,
+                                                               const QCA::SecureArray &passphrase,
+                                                               QCA::ConvertResult *result )
+{
+    QCA::ConvertResult convertResult = QCA::ErrorFile;
+
+    QFileInfo info( fileName );
+    if ( !info.exists() || !info.isReadable() ) {
+        if ( result ) {
+            *result = convertResult;
+        }
+        return Key();
+    }
+
+    // the file isn't read at all when it didn't change since it was decoded
+    QString path = info.canonicalFilePath();
+    QByteArray id = "file:" + path.toUtf8() + ':' +
+                    QByteArray::number( info.lastModified().toMSecsSinceEpoch() ) + ':' +
+                    QByteArray::number( info.size() ) + ':' + passphraseId( passphrase );
+
+    Key key = find( id );
+    if ( key.isNull() ) {
+        QFile file( path );
+        if ( file.open( QIODevice::ReadOnly ) ) {
+            QCA::PrivateKey decoded = decode( file.readAll(), AnyFormat, passphrase, &convertResult );
+            if ( convertResult == QCA::ConvertGood ) {
+                QMutexLocker locker( &mutex );
+                // forget the previous contents of the file
+                QByteArray previousId = fileIds.value( path );
+                if ( !previousId.isEmpty() && previousId != id ) {
+                    keys.remove( previousId );
+                }
+                key = insert( id, decoded );
+                fileIds.insert( path, id );
+            }
+        }
+    } else {
+        convertResult = QCA::ConvertGood;
+    }
+
+    if ( result ) {
+        *result = convertResult;
+    }
+    return key;
+}
+
+QOAuth::PrivateKeyCache::Key QOAuth::PrivateKeyCache::fromData( const QByteArray &data, Format format,
+                                                               const QCA::SecureArray &passphrase,
+                                                               QCA::ConvertResult *result )
+{
+    QCA::ConvertResult convertResult = QCA::ConvertGood;
+
+    QByteArray id = "data:" + QByteArray::number( format ) + ':' +
+                    Sha1::hash( data ).toHex() + ':' + passphraseId( passphrase );
+
+    Key key = find( id );
+    if ( key.isNull() ) {
+        QCA::PrivateKey decoded = decode( data, format, passphrase, &convertResult );
+        if ( convertResult == QCA::ConvertGood ) {
+            QMutexLocker locker( &mutex );
+            key = insert( id, decoded );
+        }
+    }
+
+    if ( result ) {
+        *result = convertResult;
+    }
+    return key;
+}
+
+QCA::PrivateKey QOAuth::PrivateKeyCache::decode( const QByteArray &data, Format format,
+                                                 const QCA::SecureArray &passphrase,
+                                                 QCA::ConvertResult *result )
+{
+    if ( format == AnyFormat ) {
+        format = data.contains( "-----BEGIN" ) ? PEM : DER;
+    }
+
+    QCA::ConvertResult convertResult;
+    QCA::PrivateKey key;
+    if ( format == PEM ) {
+        key = QCA::PrivateKey::fromPEM( QString::fromLatin1( data.constData(), data.size() ),
+                                        passphrase, &convertResult );
+    } else {
+        key = QCA::PrivateKey::fromDER( data, passphrase, &convertResult );
+    }
+
+    if ( convertResult == QCA::ConvertGood && key.isNull() ) {
+        convertResult = QCA::ErrorDecode;
+    }
+    *result = convertResult;
+    return key;
+}
+
+int QOAuth::PrivateKeyCache::size() const
+{
+    QMutexLocker locker( &mutex );
+
+    int count = 0;
+    QHash<QByteArray, QWeakPointer<const QCA::PrivateKey> >::const_iterator i;
+    for ( i = keys.constBegin(); i != keys.constEnd(); ++i ) {
+        if ( !i.value().isNull() ) {
+            ++count;
+        }
+    }
+    return count;
+}
+
+int QOAuth::PrivateKeyCache::hits() const
+{
+#if QT_VERSION >= 0x050000
+    return hitCount.load();
+#else
+    return hitCount;
+#endif
+}
+
+int QOAuth::PrivateKeyCache::misses() const
+{
+#if QT_VERSION >= 0x050000
+    return missCount.load();
+#else
+    return missCount;
+#endif
+}
+
+QOAuth::PrivateKeyCache::Key QOAuth::PrivateKeyCache::find( const QByteArray &id )
+{
+    QMutexLocker locker( &mutex );
+
+    Key key = keys.value( id ).toStrongRef();
+    if ( key.isNull() ) {
+        missCount.ref();
+    } else {
+        hitCount.ref();
+    }
+    return key;
+}
+
+// the mutex has to be locked
+QOAuth::PrivateKeyCache::Key QOAuth::PrivateKeyCache::insert( const QByteArray &id,
+                                                             const QCA::PrivateKey &key )
+{
+    // another thread might have decoded the same key meanwhile
+    Key cached = keys.value( id ).toStrongRef();
+    if ( !cached.isNull() ) {
+        return cached;
+    }
+
+    removeExpired();
+
+    cached = Key( new QCA::PrivateKey( key ) );
+    keys.insert( id, cached );
+    return cached;
+}
+
+// the mutex has to be locked
+void QOAuth::PrivateKeyCache::removeExpired()
+{
+    QMutableHashIterator<QByteArray, QWeakPointer<const QCA::PrivateKey> > i( keys );
+    while ( i.hasNext() ) {
+        if ( i.next().value().isNull() ) {
+            i.remove();
+        }
+    }
+
+    QMutableHashIterator<QString, QByteArray> files( fileIds );
+    while ( files.hasNext() ) {
+        if ( !keys.contains( files.next().value() ) ) {
+            files.remove();
+        }
+    }
+}
@@ -0,0 +1,102 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file privatekeycache_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef PRIVATEKEYCACHE_P_H
+#define PRIVATEKEYCACHE_P_H
+
+#include <QHash>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QSharedPointer>
+#include <QWeakPointer>
+
+#include <QtCrypto>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+// Decoded RSA private keys shared by the whole process. A key is identified by
+// the file's path, modification time and size, or by the SHA-1 of the encoded
+// key for the keys given in memory, together with an HMAC-SHA1 of the passphrase
+// keyed with a random salt of the process, so no plain digest of it is kept.
+// The cache only holds weak references: an entry lives for as long as someone
+// holds the returned pointer. A modified file gets a new entry, and the entry
+// of its previous contents is forgotten.
+class QOAUTH_EXPORT PrivateKeyCache
+{
+public:
+    enum Format {
+        // PEM if the data has a PEM header, DER otherwise
+        AnyFormat,
+        PEM,
+        DER
+    };
+
+    typedef QSharedPointer<const QCA::PrivateKey> Key;
+
+    static PrivateKeyCache *instance();
+
+    PrivateKeyCache();
+
+    // the returned pointer is null on error
+    Key fromFile( const QString &fileName, const QCA::SecureArray &passphrase,
+                  QCA::ConvertResult *result );
+    Key fromData( const QByteArray &data, Format format, const QCA::SecureArray &passphrase,
+                  QCA::ConvertResult *result );
+
+    static QCA::PrivateKey decode( const QByteArray &data, Format format,
+                                   const QCA::SecureArray &passphrase, QCA::ConvertResult *result );
+
+    // the number of keys in use
+    int size() const;
+    int hits() const;
+    int misses() const;
+
+private:
+    enum { SaltSize = 32 };
+
+    QByteArray passphraseId( const QCA::SecureArray &passphrase ) const;
+    Key find( const QByteArray &id );
+    Key insert( const QByteArray &id, const QCA::PrivateKey &key );
+    void removeExpired();
+
+    mutable QMutex mutex;
+    QHash<QByteArray, QWeakPointer<const QCA::PrivateKey> > keys;
+    // the current id of every cached file
+    QHash<QString, QByteArray> fileIds;
+    QByteArray salt;
+    QAtomicInt hitCount;
+    QAtomicInt missCount;
+
+    Q_DISABLE_COPY(PrivateKeyCache)
+};
+
+} // namespace QOAuth
+
+#endif // PRIVATEKEYCACHE_P_H
@@ -0,0 +1,51 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file qcaruntime_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef QCARUNTIME_P_H
+#define QCARUNTIME_P_H
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+// QCA initialization shared by the whole library. The first object needing
+// QCA initializes it, and it stays initialized until the process exits, so
+// short-lived interfaces and signers neither initialize nor deinitialize it.
+// QCA counts the initializations, so applications creating their own
+// QCA::Initializer are not affected.
+class QOAUTH_EXPORT QcaRuntime
+{
+public:
+    inline QcaRuntime() { ensureInitialized(); }
+
+    static void ensureInitialized();
+};
+
+} // namespace QOAuth
+
+#endif // QCARUNTIME_P_H
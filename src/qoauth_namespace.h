@@ -139,7 +139,9 @@ namespace QOAuth {
         RSADecodingError,           /*!< There was a problem decoding the RSA private key
                                      (the key is invalid or the provided passphrase is incorrect)*/
         RSAKeyFileError,            //!< The provided key file either doesn't exist or is unreadable.
-        OtherError                  //!< A network-related error not specified above
+        OtherError,                 //!< A network-related error not specified above
+        ReplyTooLarge               /*!< The Service Provider's reply exceeded
+                                         \ref QOAuth::Interface::maxReplySize */
     };
 
 
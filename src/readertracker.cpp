@@ -0,0 +1,92 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "readertracker_p.h"
+
+#include <QThread>
+
+// spreads the threads over the stripes with a multiplicative hash of their ids,
+// which are usually addresses aligned to a page or more
+static inline int currentStripe()
+{
+    quint64 id = quint64( quintptr( QThread::currentThreadId() ) );
+    id ^= id >> 32;
+    return int( ( quint32( id ) * 2654435761u ) >> ( 32 - QOAuth::StripedCounter::StripeBits ) );
+}
+
+QOAuth::StripedCounter::StripedCounter()
+{
+}
+
+QAtomicInt *QOAuth::StripedCounter::local() const
+{
+    return &stripes[currentStripe()].value;
+}
+
+int QOAuth::StripedCounter::sum() const
+{
+    int sum = 0;
+    for ( int i = 0; i < Stripes; ++i ) {
+        sum += ReaderTracker::loadRelaxed( stripes[i].value );
+    }
+    return sum;
+}
+
+void QOAuth::StripedCounter::waitForZero() const
+{
+    for ( int i = 0; i < Stripes; ++i ) {
+        while ( ReaderTracker::loadAcquire( stripes[i].value ) != 0 ) {
+            QThread::yieldCurrentThread();
+        }
+    }
+}
+
+QOAuth::ReaderTracker::ReaderTracker() :
+        epoch( 0 )
+{
+}
+
+QAtomicInt *QOAuth::ReaderTracker::enter() const
+{
+    // the reader loads the shared pointer only after registering
+    QAtomicInt *counter = readers[loadAcquire( epoch ) & 1].local();
+    counter->fetchAndAddOrdered( 1 );
+    return counter;
+}
+
+void QOAuth::ReaderTracker::leave( QAtomicInt *counter )
+{
+    counter->fetchAndAddOrdered( -1 );
+}
+
+void QOAuth::ReaderTracker::synchronize()
+{
+    // A reader that registered with a counter before the pointer was replaced
+    // may be using the old data. After the epoch flips, new readers register
+    // with the other counter, so the first one drains. Flipping it once more
+    // catches the readers that registered with the other counter in the meantime.
+    // A reader registering with a part of a counter after it was seen at zero
+    // loads the new pointer, so the parts are waited for one by one.
+    for ( int i = 0; i < 2; ++i ) {
+        int parity = epoch.fetchAndAddOrdered( 1 ) & 1;
+        readers[parity].waitForZero();
+    }
+}
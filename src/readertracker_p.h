@@ -0,0 +1,138 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file readertracker_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef READERTRACKER_P_H
+#define READERTRACKER_P_H
+
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+// A counter split into parts on separate cache lines. Every thread updates the
+// part it's hashed to, so threads counting at the same time rarely write to the
+// same line, while reading the counter takes a sum over all the parts.
+class QOAUTH_EXPORT StripedCounter
+{
+public:
+    enum { StripeBits = 4, Stripes = 1 << StripeBits, CacheLineSize = 64 };
+
+    StripedCounter();
+
+    // the part updated by the calling thread
+    QAtomicInt *local() const;
+    // the parts updated meanwhile may or may not be counted
+    int sum() const;
+    // returns once every part has been seen at zero
+    void waitForZero() const;
+
+private:
+    struct Stripe
+    {
+        QAtomicInt value;
+        char padding[CacheLineSize - sizeof( QAtomicInt )];
+    };
+
+    mutable Stripe stripes[Stripes];
+
+    Q_DISABLE_COPY(StripedCounter)
+};
+
+// Lets lock-free readers use data that writers replace through an atomic
+// pointer: a writer publishes the new data, calls synchronize() and only then
+// frees the old data. Every reader registers with one of two counters, chosen
+// by the parity of the epoch. synchronize() flips the epoch twice, each time
+// waiting for the counter of the previous parity to drain, so the readers
+// that could have loaded the old pointer are gone when it returns.
+// The counters are striped, so concurrent readers don't contend for them.
+// Readers never wait; writers have to be serialized by the caller.
+class QOAUTH_EXPORT ReaderTracker
+{
+public:
+    ReaderTracker();
+
+    // registers a reader; the result is passed to leave() once it's done
+    QAtomicInt *enter() const;
+    static void leave( QAtomicInt *counter );
+
+    void synchronize();
+
+    // the load-acquire of Qt 5, with a fallback for Qt 4
+    static inline int loadAcquire( const QAtomicInt &value )
+    {
+#if QT_VERSION >= 0x050000
+        return value.loadAcquire();
+#else
+        return const_cast<QAtomicInt &>( value ).fetchAndAddOrdered( 0 );
+#endif
+    }
+
+    static inline int loadRelaxed( const QAtomicInt &value )
+    {
+#if QT_VERSION >= 0x050000
+        return value.load();
+#else
+        return value;
+#endif
+    }
+
+    template <typename T>
+    static inline T *loadAcquire( const QAtomicPointer<T> &pointer )
+    {
+#if QT_VERSION >= 0x050000
+        return pointer.loadAcquire();
+#else
+        return const_cast<QAtomicPointer<T> &>( pointer ).fetchAndAddOrdered( 0 );
+#endif
+    }
+
+private:
+    mutable QAtomicInt epoch;
+    StripedCounter readers[2];
+
+    Q_DISABLE_COPY(ReaderTracker)
+};
+
+// registers a reader for the duration of a scope
+class ReadGuard
+{
+public:
+    explicit ReadGuard( const ReaderTracker *tracker ) : counter( tracker->enter() ) {}
+    ~ReadGuard() { ReaderTracker::leave( counter ); }
+
+private:
+    QAtomicInt *counter;
+
+    Q_DISABLE_COPY(ReadGuard)
+};
+
+} // namespace QOAuth
+
+#endif // READERTRACKER_P_H
@@ -0,0 +1,524 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "reply.h"
+#include "reply_p.h"
+#include "interface_p.h"
+#include "transport_p.h"
+
+#include <QNetworkRequest>
+#include <QNetworkReply>
+#include <QSslError>
+#include <QTimer>
+#include <QtDebug>
+
+#include <limits.h>
+
+/*!
+  \class QOAuth::Reply reply.h <QtOAuth>
+  \brief This class represents a single token request issued by QOAuth::Interface.
+
+  Reply objects are returned by \ref QOAuth::Interface::requestTokenAsync() and
+  \ref QOAuth::Interface::accessTokenAsync(). Every reply carries its own result
+  and error code, so any number of them can be in progress at the same time and
+  none of them blocks the calling thread.
+
+  The \ref finished() signal is emitted when the request completes, either successfully
+  or not. In the latter case it is preceded by \ref error(int). Once the reply is
+  finished, the data sent by the Service Provider is available with \ref result().
+
+  With a QOAuth::RetryPolicy set on the interface, the reply may send its request
+  several times, retrying or hedging it. It still finishes only once, with the result
+  of the attempt that completed the request.
+
+  The reply is parented to the interface that created it. It is the caller's
+  responsibility to delete it once it's no longer needed, preferably using
+  QObject::deleteLater() from a slot connected to \ref finished().
+
+  \sa QOAuth::Interface::requestTokenAsync(), QOAuth::Interface::accessTokenAsync()
+*/
+
+/*!
+  \fn void QOAuth::Reply::finished()
+
+  This signal is emitted once the request is completed, i.e. when the Service Provider's
+  reply has been received and parsed, or when the request has failed.
+
+  \sa isFinished(), result()
+*/
+
+/*!
+  \fn void QOAuth::Reply::error( int code )
+
+  This signal is emitted when the request fails, just before \ref finished().
+  The \a code is one of the \ref QOAuth::ErrorCode values.
+*/
+
+QOAuth::ReplyPrivate::ReplyPrivate() :
+        httpMethod( GET ),
+        signatureMethod( HMAC_SHA1 ),
+        attempt( 0 ),
+        hedged( false ),
+        hedgeError( NoError ),
+        timer( 0 ),
+        retryTimer( 0 ),
+        hedgeTimer( 0 ),
+        deadlineTimer( 0 ),
+        requestTimeout( 0 ),
+        ignoreSslErrors( false ),
+        maxReplySize( 0 ),
+        isFinished( false ),
+        error( NoError )
+{
+}
+
+void QOAuth::ReplyPrivate::startAttempt()
+{
+    ++attempt;
+    hedged = false;
+    hedgeError = NoError;
+    attemptElapsed.start();
+
+    int errorCode = owner ? owner->d_func()->sendAttempt( this ) : (int) OtherError;
+
+    // if signature wasn't created, the reply fails straight away
+    if ( errorCode != NoError ) {
+        finish( errorCode, true );
+        return;
+    }
+
+    // the timer belongs to this very reply, so it can't affect any other request
+    if ( requestTimeout > 0 ) {
+        startTimer( requestTimeout );
+    }
+    startHedgeTimer();
+}
+
+void QOAuth::ReplyPrivate::addNetworkReply( QNetworkReply *reply )
+{
+    Q_Q(Reply);
+
+    Attempt attempt;
+    attempt.networkReply = reply;
+    attempt.host = Transport::hostKey( reply->url() );
+    attempt.elapsed.start();
+    attempts.append( attempt );
+    TransportPrivate::requestStarted( attempt.host );
+
+    q->connect( reply, SIGNAL(finished()), SLOT(_q_networkReplyFinished()) );
+    q->connect( reply, SIGNAL(sslErrors(QList<QSslError>)),
+                SLOT(_q_handleSslErrors(QList<QSslError>)) );
+    q->connect( reply, SIGNAL(downloadProgress(qint64,qint64)),
+                SLOT(_q_downloadProgress(qint64,qint64)) );
+}
+
+void QOAuth::ReplyPrivate::startTimer( uint msec )
+{
+    Q_Q(Reply);
+
+    if ( !timer ) {
+        timer = new QTimer( q );
+        timer->setSingleShot( true );
+        q->connect( timer, SIGNAL(timeout()), SLOT(_q_timeout()) );
+    }
+    timer->start( msec );
+}
+
+void QOAuth::ReplyPrivate::startDeadlineTimer()
+{
+    Q_Q(Reply);
+
+    if ( deadline.isForever() ) {
+        return;
+    }
+
+    deadlineTimer = new QTimer( q );
+    deadlineTimer->setSingleShot( true );
+#if QT_VERSION >= 0x050000
+    deadlineTimer->setTimerType( Qt::PreciseTimer );
+#endif
+    q->connect( deadlineTimer, SIGNAL(timeout()), SLOT(_q_deadlineExpired()) );
+    deadlineTimer->start( int( qMin( deadline.remainingTime(), qint64( INT_MAX ) ) ) );
+}
+
+void QOAuth::ReplyPrivate::startHedgeTimer()
+{
+    Q_Q(Reply);
+
+    if ( retryPolicy.hedgingPercentile() <= 0 || !owner ) {
+        return;
+    }
+
+    qint64 delay = owner->d_func()->latencies.percentile( retryPolicy.hedgingPercentile() );
+    if ( delay < 0 ) {
+        return;
+    }
+
+    if ( !hedgeTimer ) {
+        hedgeTimer = new QTimer( q );
+        hedgeTimer->setSingleShot( true );
+        q->connect( hedgeTimer, SIGNAL(timeout()), SLOT(_q_hedge()) );
+    }
+    hedgeTimer->start( int( delay ) );
+}
+
+int QOAuth::ReplyPrivate::indexOf( QNetworkReply *reply ) const
+{
+    for ( int i = 0; i < attempts.size(); ++i ) {
+        if ( attempts.at( i ).networkReply == reply ) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void QOAuth::ReplyPrivate::dropAttempt( int index, bool failed )
+{
+    Q_Q(Reply);
+
+    Attempt attempt = attempts.takeAt( index );
+    QNetworkReply *networkReply = attempt.networkReply;
+    if ( !networkReply ) {
+        return;
+    }
+
+    TransportPrivate::requestFinished( attempt.host, failed,
+                                       TransportPrivate::http2WasUsed( networkReply ),
+                                       attempt.elapsed.elapsed() );
+
+    // make sure that a late (or aborted) network reply doesn't reach us
+    networkReply->disconnect( q );
+    if ( networkReply->isRunning() ) {
+        networkReply->abort();
+    }
+    networkReply->deleteLater();
+}
+
+void QOAuth::ReplyPrivate::dropAttempts( bool failed )
+{
+    while ( !attempts.isEmpty() ) {
+        dropAttempt( attempts.size() - 1, failed );
+    }
+}
+
+void QOAuth::ReplyPrivate::attemptFinished( int index, int errorCode, const ParamMap &replyParams )
+{
+    // the latency the caller saw, counted from the start of the attempt also when
+    // its hedge won; counting the hedge from its own start would make the history,
+    // and so the delay before the hedges, shorter with every hedge
+    if ( errorCode == NoError && owner ) {
+        owner->d_func()->latencies.record( attemptElapsed.elapsed() );
+    }
+    dropAttempt( index, errorCode != NoError );
+
+    if ( errorCode != NoError ) {
+        // The other copy of a hedged request may still succeed, whatever the error.
+        // Both copies of an Access Token exchange carry the same Request Token,
+        // and the Service Provider usually refuses the one that comes second.
+        if ( !attempts.isEmpty() ) {
+            if ( !retryPolicy.isRetryable( errorCode ) ) {
+                hedgeError = errorCode;
+            }
+            return;
+        }
+
+        // retrying makes no sense once a copy has been refused
+        if ( hedgeError != NoError ) {
+            errorCode = hedgeError;
+        }
+        if ( retryPolicy.isRetryable( errorCode ) ) {
+            attemptFailed( errorCode );
+            return;
+        }
+    }
+
+    result = replyParams;
+    if ( errorCode == NoError && tokenCache && result.contains( InterfacePrivate::ParamToken ) ) {
+        tokenCache->insert( cacheConsumerKey, token, result );
+    }
+    finish( errorCode );
+}
+
+void QOAuth::ReplyPrivate::attemptFailed( int errorCode )
+{
+    Q_Q(Reply);
+
+    if ( !retryPolicy.isRetryable( errorCode ) || attempt >= retryPolicy.maxAttempts() ) {
+        finish( errorCode );
+        return;
+    }
+
+    // a retry that can't start before the deadline isn't worth waiting for
+    uint delay = retryPolicy.backoff( attempt );
+    if ( !deadline.isForever() && delay >= deadline.remainingTime() ) {
+        finish( errorCode );
+        return;
+    }
+
+    if ( timer ) {
+        timer->stop();
+    }
+    if ( hedgeTimer ) {
+        hedgeTimer->stop();
+    }
+
+    if ( !retryTimer ) {
+        retryTimer = new QTimer( q );
+        retryTimer->setSingleShot( true );
+        q->connect( retryTimer, SIGNAL(timeout()), SLOT(_q_retry()) );
+    }
+    retryTimer->start( delay );
+}
+
+void QOAuth::ReplyPrivate::finish( int errorCode, bool deferSignals )
+{
+    Q_Q(Reply);
+
+    if ( isFinished ) {
+        return;
+    }
+
+    isFinished = true;
+    error = errorCode;
+
+    if ( timer ) {
+        timer->stop();
+    }
+    if ( retryTimer ) {
+        retryTimer->stop();
+    }
+    if ( hedgeTimer ) {
+        hedgeTimer->stop();
+    }
+    if ( deadlineTimer ) {
+        deadlineTimer->stop();
+    }
+
+    dropAttempts( errorCode != NoError );
+
+    if ( deferSignals ) {
+        QMetaObject::invokeMethod( q, "_q_emitFinished", Qt::QueuedConnection );
+    } else {
+        _q_emitFinished();
+    }
+}
+
+void QOAuth::ReplyPrivate::_q_emitFinished()
+{
+    Q_Q(Reply);
+
+    if ( error != NoError ) {
+        emit q->error( error );
+    }
+    emit q->finished();
+}
+
+void QOAuth::ReplyPrivate::_q_networkReplyFinished()
+{
+    Q_Q(Reply);
+
+    QNetworkReply *networkReply = qobject_cast<QNetworkReply *>( q->sender() );
+    int index = indexOf( networkReply );
+    if ( isFinished || index < 0 ) {
+        return;
+    }
+
+    // in case the reply was finished before its progress was reported
+    if ( maxReplySize > 0 && networkReply->bytesAvailable() > maxReplySize ) {
+        attemptFinished( index, ReplyTooLarge, ParamMap() );
+        return;
+    }
+
+    int returnCode = networkReply->attribute( QNetworkRequest::HttpStatusCodeAttribute ).toInt();
+    ParamMap replyParams;
+
+    switch ( returnCode ) {
+    case NoError:
+        replyParams = InterfacePrivate::replyToMap( networkReply->readAll() );
+        if ( !replyParams.contains( InterfacePrivate::ParamToken ) ) {
+            qWarning() << __FUNCTION__ << "- oauth_token not present in reply!";
+        }
+        if ( !replyParams.contains( InterfacePrivate::ParamTokenSecret ) ) {
+            qWarning() << __FUNCTION__ << "- oauth_token_secret not present in reply!";
+        }
+
+    case BadRequest:
+    case Unauthorized:
+    case Forbidden:
+        attemptFinished( index, returnCode, replyParams );
+        break;
+    default:
+        attemptFinished( index, OtherError, ParamMap() );
+    }
+}
+
+void QOAuth::ReplyPrivate::_q_handleSslErrors( const QList<QSslError> &errors )
+{
+    Q_Q(Reply);
+    Q_UNUSED(errors);
+
+    QNetworkReply *networkReply = qobject_cast<QNetworkReply *>( q->sender() );
+    if ( ignoreSslErrors && networkReply ) {
+        networkReply->ignoreSslErrors();
+    }
+}
+
+void QOAuth::ReplyPrivate::_q_timeout()
+{
+    // the timeout covers the request along with its hedge
+    dropAttempts( true );
+    attemptFailed( Timeout );
+}
+
+void QOAuth::ReplyPrivate::_q_deadlineExpired()
+{
+    // unlike the timeout of an attempt, this ends the request for good
+    finish( Timeout );
+}
+
+void QOAuth::ReplyPrivate::_q_downloadProgress( qint64 received, qint64 total )
+{
+    Q_Q(Reply);
+
+    // the total is known up front from Content-Length, if the reply has one,
+    // so oversized replies are usually dropped before their body arrives
+    if ( maxReplySize > 0 && ( received > maxReplySize || total > maxReplySize ) ) {
+        int index = indexOf( qobject_cast<QNetworkReply *>( q->sender() ) );
+        if ( !isFinished && index >= 0 ) {
+            attemptFinished( index, ReplyTooLarge, ParamMap() );
+        }
+    }
+}
+
+void QOAuth::ReplyPrivate::_q_retry()
+{
+    if ( !isFinished ) {
+        startAttempt();
+    }
+}
+
+void QOAuth::ReplyPrivate::_q_hedge()
+{
+    // a single hedge per attempt, sent only while the attempt is still in progress
+    if ( isFinished || hedged || attempts.size() != 1 || !owner ) {
+        return;
+    }
+
+    hedged = true;
+    owner->d_func()->sendAttempt( this );
+}
+
+
+QOAuth::Reply::Reply( QObject *parent ) :
+        QObject( parent ),
+        d_ptr( new ReplyPrivate )
+{
+    Q_D(Reply);
+
+    d->q_ptr = this;
+}
+
+/*!
+  \brief Destroys the reply, aborting the request if it is still in progress.
+*/
+
+QOAuth::Reply::~Reply()
+{
+    Q_D(Reply);
+
+    d->dropAttempts( true );
+
+    delete d_ptr;
+}
+
+/*!
+  \brief Returns true if the request has completed (successfully or not).
+*/
+
+bool QOAuth::Reply::isFinished() const
+{
+    Q_D(const Reply);
+
+    return d->isFinished;
+}
+
+/*!
+  \brief Returns the error code of the request.
+
+  The value is \ref QOAuth::NoError while the request is in progress and
+  after it succeeded.
+
+  \sa QOAuth::ErrorCode
+*/
+
+int QOAuth::Reply::error() const
+{
+    Q_D(const Reply);
+
+    return d->error;
+}
+
+/*!
+  \brief Returns the parameters received from the Service Provider.
+
+  The values are kept in the percent-encoded form they are sent in, so the tokens can
+  be passed back to QOAuth::Interface as they are. The map is empty until the request
+  finishes, and when the request fails.
+*/
+
+QOAuth::ParamMap QOAuth::Reply::result() const
+{
+    Q_D(const Reply);
+
+    return d->result;
+}
+
+/*!
+  \brief Returns the deadline of the request.
+
+  The reply fails with \ref QOAuth::Timeout if it's not finished by then. Passing the
+  deadline on to the requests made in response to this one keeps them within the same
+  time budget.
+
+  \sa QOAuth::Deadline
+*/
+
+QOAuth::Deadline QOAuth::Reply::deadline() const
+{
+    Q_D(const Reply);
+
+    return d->deadline;
+}
+
+/*!
+  \brief Aborts the request.
+
+  If the request is still in progress, it is cancelled and finishes
+  with \ref QOAuth::OtherError. Otherwise this method does nothing.
+*/
+
+void QOAuth::Reply::abort()
+{
+    Q_D(Reply);
+
+    d->finish( OtherError );
+}
+
+#include "moc_reply.cpp"
@@ -0,0 +1,91 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file reply.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef REPLY_H
+#define REPLY_H
+
+#include <QObject>
+
+#include "qoauth_global.h"
+#include "qoauth_namespace.h"
+#include "deadline.h"
+
+class QNetworkReply;
+class QSslError;
+
+namespace QOAuth {
+
+class InterfacePrivate;
+class ReplyPrivate;
+
+class QOAUTH_EXPORT Reply : public QObject
+{
+    Q_OBJECT
+
+public:
+    virtual ~Reply();
+
+    bool isFinished() const;
+    int error() const;
+    ParamMap result() const;
+    Deadline deadline() const;
+
+public Q_SLOTS:
+    void abort();
+
+Q_SIGNALS:
+    void finished();
+    void error( int code );
+
+protected:
+    ReplyPrivate * const d_ptr;
+
+private:
+    explicit Reply( QObject *parent = 0 );
+
+    Q_DISABLE_COPY(Reply)
+    Q_DECLARE_PRIVATE(Reply)
+    Q_PRIVATE_SLOT(d_func(), void _q_networkReplyFinished())
+    Q_PRIVATE_SLOT(d_func(), void _q_handleSslErrors( const QList<QSslError> &errors ))
+    Q_PRIVATE_SLOT(d_func(), void _q_timeout())
+    Q_PRIVATE_SLOT(d_func(), void _q_deadlineExpired())
+    Q_PRIVATE_SLOT(d_func(), void _q_downloadProgress( qint64 received, qint64 total ))
+    Q_PRIVATE_SLOT(d_func(), void _q_retry())
+    Q_PRIVATE_SLOT(d_func(), void _q_hedge())
+    Q_PRIVATE_SLOT(d_func(), void _q_emitFinished())
+
+    friend class InterfacePrivate;
+
+#ifdef UNIT_TEST
+    friend class Ut_Interface;
+    friend class Ft_Interface;
+#endif
+};
+
+} // namespace QOAuth
+
+#endif // REPLY_H
@@ -0,0 +1,136 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file reply_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef REPLY_P_H
+#define REPLY_P_H
+
+#include "reply.h"
+#include "signer.h"
+#include "retrypolicy.h"
+#include "deadline.h"
+#include "tokencache.h"
+#include <QPointer>
+#include <QSharedPointer>
+#include <QNetworkReply>
+#include <QElapsedTimer>
+
+class QTimer;
+
+namespace QOAuth {
+
+class Interface;
+class Reply;
+
+
+class QOAUTH_EXPORT ReplyPrivate
+{
+    Q_DECLARE_PUBLIC(Reply)
+
+public:
+    // a network request in progress: the request itself or its hedge
+    struct Attempt
+    {
+        QPointer<QNetworkReply> networkReply;
+        // for QOAuth::Transport statistics
+        QString host;
+        QElapsedTimer elapsed;
+    };
+
+    ReplyPrivate();
+
+    // sends the request (again), with a fresh nonce and signature
+    void startAttempt();
+    void addNetworkReply( QNetworkReply *reply );
+    void startTimer( uint msec );
+    void startDeadlineTimer();
+    void startHedgeTimer();
+    int indexOf( QNetworkReply *reply ) const;
+    // stops the network request and records it in the statistics
+    void dropAttempt( int index, bool failed );
+    void dropAttempts( bool failed );
+    void attemptFinished( int index, int errorCode, const ParamMap &replyParams );
+    // retries the request if the policy allows, or fails the reply
+    void attemptFailed( int errorCode );
+    // finishes the request; emission is deferred to the event loop when
+    // the reply fails before reaching the network
+    void finish( int errorCode, bool deferSignals = false );
+
+    // the request, kept for sending it again
+    QPointer<Interface> owner;
+    QString requestUrl;
+    HttpMethod httpMethod;
+    SignatureMethod signatureMethod;
+    QByteArray token;
+    QByteArray tokenSecret;
+    ParamMap params;
+    // the credentials the request was started with, for signing every attempt
+    Signer signer;
+
+    // where the Access Token goes once obtained, if anywhere
+    QSharedPointer<TokenCache> tokenCache;
+    QByteArray cacheConsumerKey;
+
+    RetryPolicy retryPolicy;
+    Deadline deadline;
+    int attempt;
+    // since the attempt was sent, whichever copy of it answers
+    QElapsedTimer attemptElapsed;
+    bool hedged;
+    // the error of a copy refused while the other one was in progress
+    int hedgeError;
+    QList<Attempt> attempts;
+
+    QTimer *timer;
+    QTimer *retryTimer;
+    QTimer *hedgeTimer;
+    QTimer *deadlineTimer;
+    uint requestTimeout;
+
+    bool ignoreSslErrors;
+    // 0 for no limit
+    qint64 maxReplySize;
+    bool isFinished;
+    int error;
+    ParamMap result;
+
+protected:
+    Reply *q_ptr;
+
+public:
+    void _q_networkReplyFinished();
+    void _q_handleSslErrors( const QList<QSslError> &errors );
+    void _q_timeout();
+    void _q_deadlineExpired();
+    void _q_downloadProgress( qint64 received, qint64 total );
+    void _q_retry();
+    void _q_hedge();
+    void _q_emitFinished();
+};
+
+} // namespace QOAuth
+
+#endif // REPLY_P_H
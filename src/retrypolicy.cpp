@@ -0,0 +1,369 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "retrypolicy.h"
+#include "retrypolicy_p.h"
+#include "qoauth_namespace.h"
+
+#include <QtAlgorithms>
+#if QT_VERSION >= 0x050A00
+#  include <QRandomGenerator>
+#else
+#  include <QThreadStorage>
+#  include "noncesource.h"
+#endif
+
+#include <math.h>
+
+/*!
+  \class QOAuth::RetryPolicy retrypolicy.h <QtOAuth>
+  \brief This class describes how QOAuth::Interface retries failed token requests.
+
+  A token request that fails with one of the \ref retryableErrors() is sent again,
+  up to \ref maxAttempts() times in total, each time with a fresh nonce and signature.
+  Before every retry the interface waits for \ref backoff(): the delay starts at
+  \ref initialBackoff(), grows \ref backoffMultiplier() times with each retry up to
+  \ref maxBackoff(), and is shortened by a random part of up to \ref jitter() of it,
+  so that many clients failing at the same time don't retry all at once.
+
+  Additionally, with a non-zero \ref hedgingPercentile(), a request which takes longer
+  than the given percentile of the recent successful requests of the interface is sent
+  once more while the first one is still in progress, and the reply that arrives first
+  is used. This cuts the tail latency caused by slow Service Provider nodes, at the cost
+  of a few additional requests.
+
+  The \ref QOAuth::Interface::requestTimeout applies to every attempt separately,
+  and QOAuth::Timeout is one of the retryable errors by default.
+
+  The default policy makes a single attempt, i.e. doesn't retry at all.
+
+  \sa QOAuth::Interface::setRetryPolicy()
+*/
+
+QOAuth::RetryPolicyPrivate::RetryPolicyPrivate() :
+        maxAttempts( 1 ),
+        initialBackoff( 200 ),
+        maxBackoff( 10000 ),
+        backoffMultiplier( 2.0 ),
+        jitter( 0.5 ),
+        hedgingPercentile( 0.0 )
+{
+    retryableErrors << Timeout << OtherError;
+}
+
+/*!
+  \brief Creates a policy with a single attempt and no hedging.
+*/
+
+QOAuth::RetryPolicy::RetryPolicy() :
+        d( new RetryPolicyPrivate )
+{
+}
+
+/*!
+  \brief Creates a policy allowing \a maxAttempts attempts, with the default backoff
+         and retryable errors.
+*/
+
+QOAuth::RetryPolicy::RetryPolicy( int maxAttempts ) :
+        d( new RetryPolicyPrivate )
+{
+    setMaxAttempts( maxAttempts );
+}
+
+/*!
+  \brief Creates a copy of \a other.
+*/
+
+QOAuth::RetryPolicy::RetryPolicy( const RetryPolicy &other ) :
+        d( other.d )
+{
+}
+
+/*!
+  \brief Destroys the policy.
+*/
+
+QOAuth::RetryPolicy::~RetryPolicy()
+{
+}
+
+/*!
+  \brief Assigns \a other to this policy.
+*/
+
+QOAuth::RetryPolicy &QOAuth::RetryPolicy::operator=( const RetryPolicy &other )
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+  \brief Returns the number of attempts made at most for a single request,
+         including the first one.
+*/
+
+int QOAuth::RetryPolicy::maxAttempts() const
+{
+    return d->maxAttempts;
+}
+
+/*!
+  \brief Sets the number of \a attempts made at most for a single request.
+
+  Values lower than \c 1 are treated as \c 1, i.e. no retries.
+*/
+
+void QOAuth::RetryPolicy::setMaxAttempts( int attempts )
+{
+    d->maxAttempts = qMax( attempts, 1 );
+}
+
+/*!
+  \brief Returns the delay in milliseconds before the first retry.
+*/
+
+uint QOAuth::RetryPolicy::initialBackoff() const
+{
+    return d->initialBackoff;
+}
+
+/*!
+  \brief Sets the delay before the first retry to \a msec milliseconds.
+*/
+
+void QOAuth::RetryPolicy::setInitialBackoff( uint msec )
+{
+    d->initialBackoff = msec;
+}
+
+/*!
+  \brief Returns the longest delay in milliseconds between two attempts.
+*/
+
+uint QOAuth::RetryPolicy::maxBackoff() const
+{
+    return d->maxBackoff;
+}
+
+/*!
+  \brief Sets the longest delay between two attempts to \a msec milliseconds.
+*/
+
+void QOAuth::RetryPolicy::setMaxBackoff( uint msec )
+{
+    d->maxBackoff = msec;
+}
+
+/*!
+  \brief Returns the factor by which the delay grows with every retry.
+*/
+
+qreal QOAuth::RetryPolicy::backoffMultiplier() const
+{
+    return d->backoffMultiplier;
+}
+
+/*!
+  \brief Sets the factor by which the delay grows with every retry to \a multiplier.
+
+  Values lower than \c 1 are treated as \c 1, i.e. a constant delay.
+*/
+
+void QOAuth::RetryPolicy::setBackoffMultiplier( qreal multiplier )
+{
+    d->backoffMultiplier = qMax( multiplier, qreal( 1.0 ) );
+}
+
+/*!
+  \brief Returns the largest part of a delay that is randomly cut off.
+*/
+
+qreal QOAuth::RetryPolicy::jitter() const
+{
+    return d->jitter;
+}
+
+/*!
+  \brief Sets the largest part of a delay that is randomly cut off to \a fraction.
+
+  With \c 0 the delays are exact, with \c 1 they are anywhere between \c 0 and
+  the computed value. The \a fraction is bounded to that range.
+*/
+
+void QOAuth::RetryPolicy::setJitter( qreal fraction )
+{
+    d->jitter = qBound( qreal( 0.0 ), fraction, qreal( 1.0 ) );
+}
+
+/*!
+  \brief Returns the error codes for which a request is retried.
+
+  By default these are QOAuth::Timeout and QOAuth::OtherError.
+
+  \sa QOAuth::ErrorCode
+*/
+
+QList<int> QOAuth::RetryPolicy::retryableErrors() const
+{
+    return d->retryableErrors;
+}
+
+/*!
+  \brief Sets the error codes for which a request is retried to \a errors.
+*/
+
+void QOAuth::RetryPolicy::setRetryableErrors( const QList<int> &errors )
+{
+    d->retryableErrors = errors;
+}
+
+/*!
+  \brief Returns true if a request failed with \a error is retried.
+*/
+
+bool QOAuth::RetryPolicy::isRetryable( int error ) const
+{
+    return error != NoError && d->retryableErrors.contains( error );
+}
+
+/*!
+  \brief Returns the latency percentile after which a request is hedged.
+
+  \sa setHedgingPercentile()
+*/
+
+qreal QOAuth::RetryPolicy::hedgingPercentile() const
+{
+    return d->hedgingPercentile;
+}
+
+/*!
+  \brief Sets the latency \a percentile after which a request is hedged.
+
+  The \a percentile is a fraction, e.g. \c 0.95 sends a second request when the first
+  one takes longer than 95% of the recent successful requests. Hedging starts once
+  the interface has seen enough successful requests to tell their latencies.
+  The default value, \c 0, disables hedging.
+*/
+
+void QOAuth::RetryPolicy::setHedgingPercentile( qreal percentile )
+{
+    d->hedgingPercentile = qBound( qreal( 0.0 ), percentile, qreal( 1.0 ) );
+}
+
+#if QT_VERSION < 0x050A00
+// qrand() is never seeded, so every process would get the same jitter and the
+// failing clients would retry in lockstep. Every thread gets a xorshift64*
+// generator of its own instead, seeded from the random nonces.
+Q_GLOBAL_STATIC(QThreadStorage<quint64 *>, randomStates)
+
+static quint64 randomSeed()
+{
+    // FNV-1a over the nonce, which is random whatever its format
+    QByteArray nonce = QOAuth::NonceSource::defaultSource()->nonce();
+    quint64 seed = Q_UINT64_C(14695981039346656037);
+    for ( int i = 0; i < nonce.size(); ++i ) {
+        seed = ( seed ^ uchar( nonce.at( i ) ) ) * Q_UINT64_C(1099511628211);
+    }
+    // the state must not be zero
+    return seed ? seed : Q_UINT64_C(0x9E3779B97F4A7C15);
+}
+#endif
+
+static qreal randomFraction()
+{
+#if QT_VERSION >= 0x050A00
+    return QRandomGenerator::global()->generateDouble();
+#else
+    QThreadStorage<quint64 *> *states = randomStates();
+    if ( !states->hasLocalData() ) {
+        states->setLocalData( new quint64( randomSeed() ) );
+    }
+    quint64 &state = *states->localData();
+    state ^= state >> 12;
+    state ^= state << 25;
+    state ^= state >> 27;
+    // the top 53 bits make a double in [0, 1)
+    return ( ( state * Q_UINT64_C(2685821657736338717) ) >> 11 ) / 9007199254740992.0;
+#endif
+}
+
+/*!
+  \brief Returns the delay in milliseconds before the given \a retry, counting from \c 1.
+
+  The result includes the random \ref jitter(), so it differs between calls.
+*/
+
+uint QOAuth::RetryPolicy::backoff( int retry ) const
+{
+    if ( retry < 1 ) {
+        return 0;
+    }
+
+    qreal delay = d->initialBackoff * pow( d->backoffMultiplier, retry - 1 );
+    delay = qMin( delay, qreal( d->maxBackoff ) );
+    delay *= 1.0 - d->jitter * randomFraction();
+
+    return uint( delay );
+}
+
+
+QOAuth::LatencyHistory::LatencyHistory() :
+        next( 0 )
+{
+}
+
+void QOAuth::LatencyHistory::record( qint64 msecs )
+{
+    // the oldest samples are overwritten once the history is full
+    if ( samples.size() < Capacity ) {
+        samples.append( msecs );
+    } else {
+        samples[next] = msecs;
+    }
+    next = ( next + 1 ) % Capacity;
+}
+
+int QOAuth::LatencyHistory::count() const
+{
+    return samples.size();
+}
+
+void QOAuth::LatencyHistory::clear()
+{
+    samples.clear();
+    next = 0;
+}
+
+qint64 QOAuth::LatencyHistory::percentile( qreal fraction ) const
+{
+    if ( samples.size() < MinimumSamples ) {
+        return -1;
+    }
+
+    // the history is short, and it's consulted once per request
+    QVector<qint64> sorted = samples;
+    qSort( sorted );
+
+    int index = qBound( 0, int( ceil( fraction * sorted.size() ) ) - 1, sorted.size() - 1 );
+    return sorted.at( index );
+}
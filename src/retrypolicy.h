@@ -0,0 +1,81 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file retrypolicy.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef RETRYPOLICY_H
+#define RETRYPOLICY_H
+
+#include <QList>
+#include <QSharedDataPointer>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+class RetryPolicyPrivate;
+
+class QOAUTH_EXPORT RetryPolicy
+{
+public:
+    RetryPolicy();
+    explicit RetryPolicy( int maxAttempts );
+    RetryPolicy( const RetryPolicy &other );
+    ~RetryPolicy();
+
+    RetryPolicy &operator=( const RetryPolicy &other );
+
+    int maxAttempts() const;
+    void setMaxAttempts( int attempts );
+
+    uint initialBackoff() const;
+    void setInitialBackoff( uint msec );
+
+    uint maxBackoff() const;
+    void setMaxBackoff( uint msec );
+
+    qreal backoffMultiplier() const;
+    void setBackoffMultiplier( qreal multiplier );
+
+    qreal jitter() const;
+    void setJitter( qreal fraction );
+
+    QList<int> retryableErrors() const;
+    void setRetryableErrors( const QList<int> &errors );
+    bool isRetryable( int error ) const;
+
+    qreal hedgingPercentile() const;
+    void setHedgingPercentile( qreal percentile );
+
+    uint backoff( int retry ) const;
+
+private:
+    QSharedDataPointer<RetryPolicyPrivate> d;
+};
+
+} // namespace QOAuth
+
+#endif // RETRYPOLICY_H
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file retrypolicy_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef RETRYPOLICY_P_H
+#define RETRYPOLICY_P_H
+
+#include "retrypolicy.h"
+#include <QSharedData>
+#include <QVector>
+
+namespace QOAuth {
+
+class RetryPolicyPrivate : public QSharedData
+{
+public:
+    RetryPolicyPrivate();
+
+    int maxAttempts;
+    uint initialBackoff;
+    uint maxBackoff;
+    qreal backoffMultiplier;
+    qreal jitter;
+    QList<int> retryableErrors;
+    qreal hedgingPercentile;
+};
+
+// Latencies of the recent successful token requests of an interface, from which
+// the hedging delay of RetryPolicy is taken. Like the interface, it's used from
+// a single thread only.
+class LatencyHistory
+{
+public:
+    enum {
+        Capacity = 128,
+        // fewer samples don't tell much about the tail
+        MinimumSamples = 16
+    };
+
+    LatencyHistory();
+
+    void record( qint64 msecs );
+    int count() const;
+    void clear();
+
+    // -1 until there are MinimumSamples latencies recorded
+    qint64 percentile( qreal fraction ) const;
+
+private:
+    QVector<qint64> samples;
+    int next;
+};
+
+} // namespace QOAuth
+
+#endif // RETRYPOLICY_P_H
@@ -0,0 +1,608 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "sha1_p.h"
+#include "cpufeatures_p.h"
+
+#include <string.h>
+
+#ifdef QOAUTH_X86_SIMD
+#  include <immintrin.h>
+#endif
+
+static const quint32 initialState[5] = {
+    0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0
+};
+
+static inline quint32 rol( quint32 value, int bits )
+{
+    return ( value << bits ) | ( value >> ( 32 - bits ) );
+}
+
+static void processBlocksPortable( quint32 *state, const uchar *blocks, int count )
+{
+    quint32 w[80];
+
+    for ( ; count > 0; --count, blocks += QOAuth::Sha1::BlockSize ) {
+        for ( int t = 0; t < 16; ++t ) {
+            w[t] = ( quint32( blocks[4 * t] ) << 24 ) | ( quint32( blocks[4 * t + 1] ) << 16 ) |
+                   ( quint32( blocks[4 * t + 2] ) << 8 ) | quint32( blocks[4 * t + 3] );
+        }
+        for ( int t = 16; t < 80; ++t ) {
+            w[t] = rol( w[t - 3] ^ w[t - 8] ^ w[t - 14] ^ w[t - 16], 1 );
+        }
+
+        quint32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+
+        for ( int t = 0; t < 80; ++t ) {
+            quint32 f, k;
+            if ( t < 20 ) {
+                f = ( b & c ) | ( ~b & d );
+                k = 0x5a827999;
+            } else if ( t < 40 ) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if ( t < 60 ) {
+                f = ( b & c ) | ( b & d ) | ( c & d );
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            quint32 temp = rol( a, 5 ) + f + e + k + w[t];
+            e = d;
+            d = c;
+            c = rol( b, 30 );
+            b = a;
+            a = temp;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+
+#ifdef QOAUTH_X86_SIMD
+
+// computes the message words of the group g (of four rounds) in place of the group g-4
+#define QOAUTH_SHA1_SCHEDULE(g) \
+    msg[(g) & 3] = _mm_sha1msg2_epu32( _mm_xor_si128( _mm_sha1msg1_epu32( msg[(g) & 3], msg[((g) + 1) & 3] ), \
+                                                      msg[((g) + 2) & 3] ), msg[((g) + 3) & 3] )
+
+// four rounds; E for the group is derived from A of the state before the previous group
+#define QOAUTH_SHA1_ROUNDS(g) \
+    e = _mm_sha1nexte_epu32( previous, msg[(g) & 3] ); \
+    previous = abcd; \
+    abcd = _mm_sha1rnds4_epu32( abcd, e, (g) / 5 )
+
+QOAUTH_TARGET("sha,ssse3,sse4.1")
+static void processBlocksShaNi( quint32 *state, const uchar *blocks, int count )
+{
+    const __m128i byteSwap = _mm_set_epi64x( 0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL );
+
+    __m128i abcd = _mm_shuffle_epi32( _mm_loadu_si128( (const __m128i *) state ), 0x1b );
+    __m128i e0 = _mm_set_epi32( state[4], 0, 0, 0 );
+
+    for ( ; count > 0; --count, blocks += QOAuth::Sha1::BlockSize ) {
+        const __m128i abcdSaved = abcd;
+        const __m128i e0Saved = e0;
+        __m128i msg[4];
+        __m128i e;
+        __m128i previous;
+
+        msg[0] = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) ( blocks ) ), byteSwap );
+        msg[1] = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) ( blocks + 16 ) ), byteSwap );
+        msg[2] = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) ( blocks + 32 ) ), byteSwap );
+        msg[3] = _mm_shuffle_epi8( _mm_loadu_si128( (const __m128i *) ( blocks + 48 ) ), byteSwap );
+
+        e = _mm_add_epi32( e0, msg[0] );
+        previous = abcd;
+        abcd = _mm_sha1rnds4_epu32( abcd, e, 0 );
+
+        QOAUTH_SHA1_ROUNDS(1);
+        QOAUTH_SHA1_ROUNDS(2);
+        QOAUTH_SHA1_ROUNDS(3);
+        QOAUTH_SHA1_SCHEDULE(4);  QOAUTH_SHA1_ROUNDS(4);
+        QOAUTH_SHA1_SCHEDULE(5);  QOAUTH_SHA1_ROUNDS(5);
+        QOAUTH_SHA1_SCHEDULE(6);  QOAUTH_SHA1_ROUNDS(6);
+        QOAUTH_SHA1_SCHEDULE(7);  QOAUTH_SHA1_ROUNDS(7);
+        QOAUTH_SHA1_SCHEDULE(8);  QOAUTH_SHA1_ROUNDS(8);
+        QOAUTH_SHA1_SCHEDULE(9);  QOAUTH_SHA1_ROUNDS(9);
+        QOAUTH_SHA1_SCHEDULE(10); QOAUTH_SHA1_ROUNDS(10);
+        QOAUTH_SHA1_SCHEDULE(11); QOAUTH_SHA1_ROUNDS(11);
+        QOAUTH_SHA1_SCHEDULE(12); QOAUTH_SHA1_ROUNDS(12);
+        QOAUTH_SHA1_SCHEDULE(13); QOAUTH_SHA1_ROUNDS(13);
+        QOAUTH_SHA1_SCHEDULE(14); QOAUTH_SHA1_ROUNDS(14);
+        QOAUTH_SHA1_SCHEDULE(15); QOAUTH_SHA1_ROUNDS(15);
+        QOAUTH_SHA1_SCHEDULE(16); QOAUTH_SHA1_ROUNDS(16);
+        QOAUTH_SHA1_SCHEDULE(17); QOAUTH_SHA1_ROUNDS(17);
+        QOAUTH_SHA1_SCHEDULE(18); QOAUTH_SHA1_ROUNDS(18);
+        QOAUTH_SHA1_SCHEDULE(19); QOAUTH_SHA1_ROUNDS(19);
+
+        e0 = _mm_sha1nexte_epu32( previous, e0Saved );
+        abcd = _mm_add_epi32( abcd, abcdSaved );
+    }
+
+    _mm_storeu_si128( (__m128i *) state, _mm_shuffle_epi32( abcd, 0x1b ) );
+    state[4] = _mm_extract_epi32( e0, 3 );
+}
+
+#undef QOAUTH_SHA1_SCHEDULE
+#undef QOAUTH_SHA1_ROUNDS
+
+// Multi-buffer SHA-1: eight independent messages are hashed at once, one per
+// 32-bit lane of the AVX2 registers. Every lane has its own state, but they all
+// go through the same rounds, so the messages are processed block by block in
+// lockstep, and lanes whose messages are shorter keep their state unchanged.
+
+#define QOAUTH_ROL8(x, n) _mm256_or_si256( _mm256_slli_epi32( (x), (n) ), _mm256_srli_epi32( (x), 32 - (n) ) )
+
+#define QOAUTH_SHA1_ROUND8(f, k) \
+    temp = _mm256_add_epi32( _mm256_add_epi32( QOAUTH_ROL8( a, 5 ), (f) ), \
+                             _mm256_add_epi32( _mm256_add_epi32( e, (k) ), wt ) ); \
+    e = d; \
+    d = c; \
+    c = QOAUTH_ROL8( b, 30 ); \
+    b = a; \
+    a = temp
+
+QOAUTH_TARGET("avx2")
+static inline __m256i scheduleWord8( __m256i *w, int t )
+{
+    if ( t < 16 ) {
+        return w[t];
+    }
+    __m256i x = _mm256_xor_si256( _mm256_xor_si256( w[( t - 3 ) & 15], w[( t - 8 ) & 15] ),
+                                  _mm256_xor_si256( w[( t - 14 ) & 15], w[t & 15] ) );
+    w[t & 15] = QOAUTH_ROL8( x, 1 );
+    return w[t & 15];
+}
+
+// compresses one block per lane; w holds the message words, word t of all the lanes in w[t]
+QOAUTH_TARGET("avx2")
+static inline void compress8( __m256i *state, __m256i *w )
+{
+    const __m256i k0 = _mm256_set1_epi32( 0x5a827999 );
+    const __m256i k1 = _mm256_set1_epi32( 0x6ed9eba1 );
+    const __m256i k2 = _mm256_set1_epi32( 0x8f1bbcdc );
+    const __m256i k3 = _mm256_set1_epi32( 0xca62c1d6 );
+
+    __m256i a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    __m256i wt, temp;
+
+    for ( int t = 0; t < 20; ++t ) {
+        wt = scheduleWord8( w, t );
+        QOAUTH_SHA1_ROUND8( _mm256_xor_si256( d, _mm256_and_si256( b, _mm256_xor_si256( c, d ) ) ), k0 );
+    }
+    for ( int t = 20; t < 40; ++t ) {
+        wt = scheduleWord8( w, t );
+        QOAUTH_SHA1_ROUND8( _mm256_xor_si256( _mm256_xor_si256( b, c ), d ), k1 );
+    }
+    for ( int t = 40; t < 60; ++t ) {
+        wt = scheduleWord8( w, t );
+        QOAUTH_SHA1_ROUND8( _mm256_or_si256( _mm256_and_si256( b, c ),
+                                             _mm256_and_si256( d, _mm256_or_si256( b, c ) ) ), k2 );
+    }
+    for ( int t = 60; t < 80; ++t ) {
+        wt = scheduleWord8( w, t );
+        QOAUTH_SHA1_ROUND8( _mm256_xor_si256( _mm256_xor_si256( b, c ), d ), k3 );
+    }
+
+    state[0] = _mm256_add_epi32( state[0], a );
+    state[1] = _mm256_add_epi32( state[1], b );
+    state[2] = _mm256_add_epi32( state[2], c );
+    state[3] = _mm256_add_epi32( state[3], d );
+    state[4] = _mm256_add_epi32( state[4], e );
+}
+
+#undef QOAUTH_SHA1_ROUND8
+#undef QOAUTH_ROL8
+
+// loads 32 bytes of every lane's block (at offset) as big-endian words, transposed
+// so that w[i] holds word i of all the lanes
+QOAUTH_TARGET("avx2")
+static inline void loadWords8( __m256i *w, const uchar *const *blocks, int offset )
+{
+    const __m256i byteSwap = _mm256_set_epi8( 12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3,
+                                              12, 13, 14, 15, 8, 9, 10, 11, 4, 5, 6, 7, 0, 1, 2, 3 );
+    __m256i r[8];
+    for ( int i = 0; i < 8; ++i ) {
+        r[i] = _mm256_loadu_si256( (const __m256i *) ( blocks[i] + offset ) );
+    }
+
+    __m256i t0 = _mm256_unpacklo_epi32( r[0], r[1] );
+    __m256i t1 = _mm256_unpackhi_epi32( r[0], r[1] );
+    __m256i t2 = _mm256_unpacklo_epi32( r[2], r[3] );
+    __m256i t3 = _mm256_unpackhi_epi32( r[2], r[3] );
+    __m256i t4 = _mm256_unpacklo_epi32( r[4], r[5] );
+    __m256i t5 = _mm256_unpackhi_epi32( r[4], r[5] );
+    __m256i t6 = _mm256_unpacklo_epi32( r[6], r[7] );
+    __m256i t7 = _mm256_unpackhi_epi32( r[6], r[7] );
+
+    __m256i u0 = _mm256_unpacklo_epi64( t0, t2 );
+    __m256i u1 = _mm256_unpackhi_epi64( t0, t2 );
+    __m256i u2 = _mm256_unpacklo_epi64( t1, t3 );
+    __m256i u3 = _mm256_unpackhi_epi64( t1, t3 );
+    __m256i u4 = _mm256_unpacklo_epi64( t4, t6 );
+    __m256i u5 = _mm256_unpackhi_epi64( t4, t6 );
+    __m256i u6 = _mm256_unpacklo_epi64( t5, t7 );
+    __m256i u7 = _mm256_unpackhi_epi64( t5, t7 );
+
+    w[0] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u0, u4, 0x20 ), byteSwap );
+    w[1] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u1, u5, 0x20 ), byteSwap );
+    w[2] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u2, u6, 0x20 ), byteSwap );
+    w[3] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u3, u7, 0x20 ), byteSwap );
+    w[4] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u0, u4, 0x31 ), byteSwap );
+    w[5] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u1, u5, 0x31 ), byteSwap );
+    w[6] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u2, u6, 0x31 ), byteSwap );
+    w[7] = _mm256_shuffle_epi8( _mm256_permute2x128_si256( u3, u7, 0x31 ), byteSwap );
+}
+
+// HMAC-SHA1 of eight messages at once; the keys and messages of unused lanes may be null
+QOAUTH_TARGET("avx2")
+static void macEightAvx2( const QOAuth::HmacSha1Key *const *keys, const QByteArray *const *messages,
+                          uchar *const *digests )
+{
+    enum { Lanes = 8, BlockSize = QOAuth::Sha1::BlockSize };
+
+    static const uchar zeroBlock[BlockSize] = { 0 };
+    // the last one or two blocks of every message, with the padding
+    uchar tails[Lanes][2 * BlockSize];
+    const uchar *data[Lanes];
+    int fullBlocks[Lanes];
+    int totalBlocks[Lanes];
+    int maxBlocks = 0;
+
+    quint32 inner[5][Lanes];
+    quint32 outer[5][Lanes];
+
+    for ( int lane = 0; lane < Lanes; ++lane ) {
+        if ( !keys[lane] ) {
+            data[lane] = zeroBlock;
+            fullBlocks[lane] = totalBlocks[lane] = 0;
+            for ( int i = 0; i < 5; ++i ) {
+                inner[i][lane] = outer[i][lane] = 0;
+            }
+            continue;
+        }
+
+        const QByteArray &message = *messages[lane];
+        int size = message.size();
+        int rest = size % BlockSize;
+        int tailBlocks = rest < BlockSize - 8 ? 1 : 2;
+        // the key block has been hashed already
+        quint64 bitLength = ( quint64( size ) + BlockSize ) * 8;
+
+        uchar *tail = tails[lane];
+        memcpy( tail, message.constData() + size - rest, rest );
+        tail[rest] = 0x80;
+        memset( tail + rest + 1, 0, tailBlocks * BlockSize - rest - 1 );
+        for ( int i = 0; i < 8; ++i ) {
+            tail[tailBlocks * BlockSize - 1 - i] = uchar( bitLength >> ( 8 * i ) );
+        }
+
+        data[lane] = reinterpret_cast<const uchar *>( message.constData() );
+        fullBlocks[lane] = size / BlockSize;
+        totalBlocks[lane] = fullBlocks[lane] + tailBlocks;
+        maxBlocks = qMax( maxBlocks, totalBlocks[lane] );
+
+        for ( int i = 0; i < 5; ++i ) {
+            inner[i][lane] = keys[lane]->inner[i];
+            outer[i][lane] = keys[lane]->outer[i];
+        }
+    }
+
+    __m256i state[5];
+    for ( int i = 0; i < 5; ++i ) {
+        state[i] = _mm256_loadu_si256( (const __m256i *) inner[i] );
+    }
+    const __m256i blockCounts = _mm256_loadu_si256( (const __m256i *) totalBlocks );
+
+    // inner hash
+    for ( int block = 0; block < maxBlocks; ++block ) {
+        const uchar *blocks[Lanes];
+        for ( int lane = 0; lane < Lanes; ++lane ) {
+            if ( block < fullBlocks[lane] ) {
+                blocks[lane] = data[lane] + block * BlockSize;
+            } else if ( block < totalBlocks[lane] ) {
+                blocks[lane] = tails[lane] + ( block - fullBlocks[lane] ) * BlockSize;
+            } else {
+                blocks[lane] = zeroBlock;
+            }
+        }
+
+        __m256i w[16];
+        loadWords8( w, blocks, 0 );
+        loadWords8( w + 8, blocks, 32 );
+
+        __m256i updated[5];
+        for ( int i = 0; i < 5; ++i ) {
+            updated[i] = state[i];
+        }
+        compress8( updated, w );
+
+        // lanes whose messages have ended keep their final state
+        const __m256i active = _mm256_cmpgt_epi32( blockCounts, _mm256_set1_epi32( block ) );
+        for ( int i = 0; i < 5; ++i ) {
+            state[i] = _mm256_blendv_epi8( state[i], updated[i], active );
+        }
+    }
+
+    // outer hash: a single block made of the inner digest and the padding
+    __m256i w[16];
+    for ( int i = 0; i < 5; ++i ) {
+        w[i] = state[i];
+        state[i] = _mm256_loadu_si256( (const __m256i *) outer[i] );
+    }
+    w[5] = _mm256_set1_epi32( 0x80000000 );
+    for ( int i = 6; i < 15; ++i ) {
+        w[i] = _mm256_setzero_si256();
+    }
+    w[15] = _mm256_set1_epi32( ( BlockSize + QOAuth::Sha1::DigestSize ) * 8 );
+    compress8( state, w );
+
+    quint32 result[5][Lanes];
+    for ( int i = 0; i < 5; ++i ) {
+        _mm256_storeu_si256( (__m256i *) result[i], state[i] );
+    }
+    for ( int lane = 0; lane < Lanes; ++lane ) {
+        if ( !keys[lane] ) {
+            continue;
+        }
+        uchar *digest = digests[lane];
+        for ( int i = 0; i < 5; ++i ) {
+            digest[4 * i]     = uchar( result[i][lane] >> 24 );
+            digest[4 * i + 1] = uchar( result[i][lane] >> 16 );
+            digest[4 * i + 2] = uchar( result[i][lane] >> 8 );
+            digest[4 * i + 3] = uchar( result[i][lane] );
+        }
+    }
+}
+
+#endif // QOAUTH_X86_SIMD
+
+typedef void (*ProcessBlocksFunction)( quint32 *, const uchar *, int );
+
+static ProcessBlocksFunction selectProcessBlocks()
+{
+#ifdef QOAUTH_X86_SIMD
+    if ( QOAuth::CpuFeatures::hasFeature( QOAuth::CpuFeatures::SHA ) &&
+         QOAuth::CpuFeatures::hasFeature( QOAuth::CpuFeatures::SSE4_1 ) &&
+         QOAuth::CpuFeatures::hasFeature( QOAuth::CpuFeatures::SSSE3 ) ) {
+        return processBlocksShaNi;
+    }
+#endif
+    return processBlocksPortable;
+}
+
+static ProcessBlocksFunction processBlocksFunction()
+{
+    static const ProcessBlocksFunction function = selectProcessBlocks();
+    return function;
+}
+
+
+QOAuth::Sha1::Sha1() :
+        length( 0 ),
+        bufferSize( 0 )
+{
+    memcpy( state, initialState, sizeof( state ) );
+}
+
+QOAuth::Sha1::Sha1( const quint32 *midstate, quint64 processedBytes ) :
+        length( processedBytes ),
+        bufferSize( 0 )
+{
+    memcpy( state, midstate, sizeof( state ) );
+}
+
+void QOAuth::Sha1::processBlocks( quint32 *state, const uchar *blocks, int count )
+{
+    processBlocksFunction()( state, blocks, count );
+}
+
+bool QOAuth::Sha1::usesShaExtensions()
+{
+    return processBlocksFunction() != processBlocksPortable;
+}
+
+void QOAuth::Sha1::update( const char *data, int size )
+{
+    const uchar *input = reinterpret_cast<const uchar *>( data );
+
+    length += size;
+
+    if ( bufferSize > 0 ) {
+        int chunk = qMin( size, int( BlockSize ) - bufferSize );
+        memcpy( buffer + bufferSize, input, chunk );
+        bufferSize += chunk;
+        input += chunk;
+        size -= chunk;
+        if ( bufferSize < BlockSize ) {
+            return;
+        }
+        processBlocks( state, buffer, 1 );
+        bufferSize = 0;
+    }
+
+    int blocks = size / BlockSize;
+    if ( blocks > 0 ) {
+        processBlocks( state, input, blocks );
+        input += blocks * BlockSize;
+        size -= blocks * BlockSize;
+    }
+
+    if ( size > 0 ) {
+        memcpy( buffer, input, size );
+        bufferSize = size;
+    }
+}
+
+void QOAuth::Sha1::final( uchar *digest )
+{
+    quint64 bitLength = length * 8;
+
+    // padding: 0x80, zeros, and the message length in bits (big endian)
+    buffer[bufferSize++] = 0x80;
+    if ( bufferSize > BlockSize - 8 ) {
+        memset( buffer + bufferSize, 0, BlockSize - bufferSize );
+        processBlocks( state, buffer, 1 );
+        bufferSize = 0;
+    }
+    memset( buffer + bufferSize, 0, BlockSize - 8 - bufferSize );
+    for ( int i = 0; i < 8; ++i ) {
+        buffer[BlockSize - 1 - i] = uchar( bitLength >> ( 8 * i ) );
+    }
+    processBlocks( state, buffer, 1 );
+    bufferSize = 0;
+
+    for ( int i = 0; i < 5; ++i ) {
+        digest[4 * i]     = uchar( state[i] >> 24 );
+        digest[4 * i + 1] = uchar( state[i] >> 16 );
+        digest[4 * i + 2] = uchar( state[i] >> 8 );
+        digest[4 * i + 3] = uchar( state[i] );
+    }
+}
+
+QByteArray QOAuth::Sha1::final()
+{
+    QByteArray digest( DigestSize, Qt::Uninitialized );
+    final( reinterpret_cast<uchar *>( digest.data() ) );
+    return digest;
+}
+
+QByteArray QOAuth::Sha1::hash( const QByteArray &data )
+{
+    Sha1 sha1;
+    sha1.update( data );
+    return sha1.final();
+}
+
+
+QOAuth::HmacSha1Key::HmacSha1Key()
+{
+    memcpy( inner, initialState, sizeof( inner ) );
+    memcpy( outer, initialState, sizeof( outer ) );
+}
+
+QOAuth::HmacSha1Key::HmacSha1Key( const QByteArray &key )
+{
+    uchar pad[Sha1::BlockSize];
+    memset( pad, 0, sizeof( pad ) );
+
+    // keys longer than a block are hashed first
+    if ( key.size() > Sha1::BlockSize ) {
+        Sha1 sha1;
+        sha1.update( key );
+        sha1.final( pad );
+    } else {
+        memcpy( pad, key.constData(), key.size() );
+    }
+
+    for ( int i = 0; i < Sha1::BlockSize; ++i ) {
+        pad[i] ^= 0x36;
+    }
+    memcpy( inner, initialState, sizeof( inner ) );
+    Sha1::processBlocks( inner, pad, 1 );
+
+    // 0x36 ^ 0x5c turns the inner pad into the outer one
+    for ( int i = 0; i < Sha1::BlockSize; ++i ) {
+        pad[i] ^= 0x36 ^ 0x5c;
+    }
+    memcpy( outer, initialState, sizeof( outer ) );
+    Sha1::processBlocks( outer, pad, 1 );
+
+    memset( pad, 0, sizeof( pad ) );
+}
+
+
+QOAuth::HmacSha1::HmacSha1( const HmacSha1Key &key ) :
+        inner( key.inner, Sha1::BlockSize ),
+        key( key )
+{
+}
+
+void QOAuth::HmacSha1::final( uchar *digest )
+{
+    uchar innerDigest[Sha1::DigestSize];
+    inner.final( innerDigest );
+
+    Sha1 outer( key.outer, Sha1::BlockSize );
+    outer.update( reinterpret_cast<const char *>( innerDigest ), Sha1::DigestSize );
+    outer.final( digest );
+}
+
+QByteArray QOAuth::HmacSha1::final()
+{
+    QByteArray digest( Sha1::DigestSize, Qt::Uninitialized );
+    final( reinterpret_cast<uchar *>( digest.data() ) );
+    return digest;
+}
+
+QByteArray QOAuth::HmacSha1::mac( const QByteArray &key, const QByteArray &message )
+{
+    HmacSha1 hmac( ( HmacSha1Key( key ) ) );
+    hmac.update( message );
+    return hmac.final();
+}
+
+int QOAuth::HmacSha1::lanes()
+{
+#ifdef QOAUTH_X86_SIMD
+    if ( CpuFeatures::hasFeature( CpuFeatures::AVX2 ) ) {
+        return 8;
+    }
+#endif
+    return 1;
+}
+
+void QOAuth::HmacSha1::macMany( const HmacSha1Key *keys, const QByteArray *messages,
+                                uchar *digests, int count )
+{
+    int done = 0;
+
+#ifdef QOAUTH_X86_SIMD
+    if ( lanes() == 8 ) {
+        // a lone message is better off with the single-stream code
+        while ( count - done > 1 ) {
+            const HmacSha1Key *laneKeys[8];
+            const QByteArray *laneMessages[8];
+            uchar *laneDigests[8];
+            for ( int lane = 0; lane < 8; ++lane ) {
+                bool used = done + lane < count;
+                laneKeys[lane] = used ? keys + done + lane : 0;
+                laneMessages[lane] = used ? messages + done + lane : 0;
+                laneDigests[lane] = used ? digests + ( done + lane ) * Sha1::DigestSize : 0;
+            }
+            macEightAvx2( laneKeys, laneMessages, laneDigests );
+            done = qMin( done + 8, count );
+        }
+    }
+#endif
+
+    for ( ; done < count; ++done ) {
+        HmacSha1 hmac( keys[done] );
+        hmac.update( messages[done] );
+        hmac.final( digests + done * Sha1::DigestSize );
+    }
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file sha1_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef SHA1_P_H
+#define SHA1_P_H
+
+#include <QByteArray>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+// SHA-1 as specified in FIPS 180-4. Blocks are compressed with the x86 SHA
+// extensions when the CPU has them, and with portable code otherwise.
+class QOAUTH_EXPORT Sha1
+{
+public:
+    enum {
+        BlockSize = 64,
+        DigestSize = 20
+    };
+
+    Sha1();
+    // resumes hashing from an intermediate state, obtained after
+    // hashing processedBytes (a multiple of BlockSize) of data
+    Sha1( const quint32 *midstate, quint64 processedBytes );
+
+    void update( const char *data, int length );
+    inline void update( const QByteArray &data ) { update( data.constData(), data.size() ); }
+
+    void final( uchar *digest );
+    QByteArray final();
+
+    static QByteArray hash( const QByteArray &data );
+
+    // compresses count full blocks into state
+    static void processBlocks( quint32 *state, const uchar *blocks, int count );
+    static bool usesShaExtensions();
+
+private:
+    quint32 state[5];
+    quint64 length;
+    uchar buffer[BlockSize];
+    int bufferSize;
+};
+
+// The HMAC-SHA1 key after the key setup: SHA-1 states after hashing
+// the key XOR-ed with the inner and outer pads.
+struct QOAUTH_EXPORT HmacSha1Key
+{
+    HmacSha1Key();
+    explicit HmacSha1Key( const QByteArray &key );
+
+    quint32 inner[5];
+    quint32 outer[5];
+};
+
+class QOAUTH_EXPORT HmacSha1
+{
+public:
+    explicit HmacSha1( const HmacSha1Key &key );
+
+    inline void update( const char *data, int length ) { inner.update( data, length ); }
+    inline void update( const QByteArray &data ) { inner.update( data ); }
+
+    void final( uchar *digest );
+    QByteArray final();
+
+    static QByteArray mac( const QByteArray &key, const QByteArray &message );
+
+    // Computes MACs of count independent messages, each with its own key, and
+    // writes them one after another (DigestSize bytes each) to digests. With AVX2
+    // the messages are hashed up to lanes() at a time, one per SIMD lane.
+    static void macMany( const HmacSha1Key *keys, const QByteArray *messages,
+                         uchar *digests, int count );
+    static int lanes();
+
+private:
+    Sha1 inner;
+    HmacSha1Key key;
+};
+
+} // namespace QOAuth
+
+#endif // SHA1_P_H
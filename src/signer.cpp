@@ -0,0 +1,906 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+#include "signer.h"
+#include "signer_p.h"
+#include "interface_p.h"
+#include "sha1_p.h"
+#include "percentencoding_p.h"
+#include "base64_p.h"
+
+#include <QtCrypto>
+
+#include <QScopedArrayPointer>
+#include <QThread>
+#include <QThreadPool>
+#include <QtDebug>
+
+/*!
+  \class QOAuth::Signer signer.h <QtOAuth>
+  \brief This class creates OAuth signatures for a fixed set of consumer credentials.
+
+  Signer holds the Consumer Key, Consumer Secret and (optionally) the RSA private key,
+  and produces signed parameter strings with \ref sign(). It provides exactly the same
+  output as QOAuth::Interface::createParametersString(), but it involves no network
+  objects and keeps no per-request state: the credentials are fixed at construction,
+  and the error of every call is reported to the caller of that call only.
+
+  Hence a single Signer can be shared by any number of threads, each of them calling
+  \ref sign() concurrently, with no locking involved. Signer is implicitly shared,
+  so copying it is cheap.
+
+  \code
+    QOAuth::Signer signer( consumerKey, consumerSecret );
+
+    // in any thread:
+    int error;
+    QByteArray header = signer.sign( "http://example.com/resource", QOAuth::GET,
+                                     token, tokenSecret, QOAuth::HMAC_SHA1,
+                                     QOAuth::ParamMap(), QOAuth::ParseForHeaderArguments,
+                                     &error );
+  \endcode
+
+  HMAC-SHA1 signing keys that already went through the key setup are kept in a bounded
+  cache, shared by all the copies of a signer, so that signing subsequent requests with
+  the same Token Secret costs only hashing of the message. See \ref setHmacCacheCapacity().
+  HMAC-SHA1 itself is computed by the library, with the SHA extensions on x86 CPUs
+  that support them, and gives the same results as the QCA provider would.
+
+  \note QCA is initialized by the library when the first signer or interface is created,
+  and stays initialized until the application exits.
+
+  \sa QOAuth::Interface::createParametersString()
+*/
+
+/*!
+  \struct QOAuth::SigningRequest signer.h <QtOAuth>
+  \brief This struct describes a single request to be signed with QOAuth::Signer::signBatch().
+
+  The members have the same meaning as the respective arguments
+  of QOAuth::Signer::sign().
+*/
+
+/*!
+  \brief Creates an empty GET request.
+*/
+
+QOAuth::SigningRequest::SigningRequest() :
+        httpMethod( GET )
+{
+}
+
+/*!
+  \brief Creates a request for \a requestUrl with the given \a httpMethod, \a token,
+         \a tokenSecret and additional \a params.
+*/
+
+QOAuth::SigningRequest::SigningRequest( const QString &requestUrl, HttpMethod httpMethod,
+                                        const QByteArray &token, const QByteArray &tokenSecret,
+                                        const ParamMap &params ) :
+        requestUrl( requestUrl ),
+        httpMethod( httpMethod ),
+        token( token ),
+        tokenSecret( tokenSecret ),
+        params( params )
+{
+}
+
+
+QOAuth::SignerPrivate::SignerPrivate() :
+        hmacCache( new HmacKeyCache ),
+        nonceSource( NonceSource::defaultSource() ),
+        timestampSource( TimestampSource::defaultSource() )
+{
+    prepareFragments();
+}
+
+void QOAuth::SignerPrivate::prepareFragments()
+{
+    consumerKeyParam = EncodedParam( InterfacePrivate::ParamConsumerKey, consumerKey );
+    for ( int i = HMAC_SHA1; i <= PLAINTEXT; ++i ) {
+        signatureMethodParams[i] = EncodedParam( InterfacePrivate::ParamSignatureMethod,
+                InterfacePrivate::signatureMethodToString( static_cast<SignatureMethod>( i ) ) );
+    }
+    versionParam = EncodedParam( InterfacePrivate::ParamVersion, InterfacePrivate::OAuthVersion );
+}
+
+
+QOAuth::EncodedParam::EncodedParam()
+{
+}
+
+QOAuth::EncodedParam::EncodedParam( const QByteArray &name, const QByteArray &value ) :
+        name( name ),
+        value( value ),
+        encoded( PercentEncoding::encodedSize( name ) + 3 +
+                 PercentEncoding::encodedSize( value ), Qt::Uninitialized )
+{
+    char *output = PercentEncoding::encode( encoded.data(), name );
+    memcpy( output, "%3D", 3 );
+    PercentEncoding::encode( output + 3, value );
+}
+
+/*!
+  \brief Creates an empty signer.
+
+  An empty signer has no consumer credentials, so \ref sign() always fails
+  with QOAuth::ConsumerKeyEmpty or QOAuth::ConsumerSecretEmpty.
+*/
+
+QOAuth::Signer::Signer() :
+        d( new SignerPrivate )
+{
+}
+
+/*!
+  \brief Creates a signer for the given \a consumerKey and \a consumerSecret.
+
+  The \a privateKey is required only for RSA-SHA1 signatures.
+*/
+
+QOAuth::Signer::Signer( const QByteArray &consumerKey, const QByteArray &consumerSecret,
+                        const QCA::PrivateKey &privateKey ) :
+        d( new SignerPrivate )
+{
+    d->consumerKey = consumerKey;
+    d->consumerSecret = consumerSecret;
+    d->privateKey = privateKey;
+    d->prepareFragments();
+}
+
+/*!
+  \brief Creates a copy of \a other.
+*/
+
+QOAuth::Signer::Signer( const Signer &other ) :
+        d( other.d )
+{
+}
+
+/*!
+  \brief Destroys the signer.
+*/
+
+QOAuth::Signer::~Signer()
+{
+}
+
+/*!
+  \brief Assigns \a other to this signer.
+*/
+
+QOAuth::Signer &QOAuth::Signer::operator=( const Signer &other )
+{
+    d = other.d;
+    return *this;
+}
+
+/*!
+  \brief Returns the Consumer Key used by the signer.
+*/
+
+QByteArray QOAuth::Signer::consumerKey() const
+{
+    return d->consumerKey;
+}
+
+/*!
+  \brief Returns the Consumer Secret used by the signer.
+*/
+
+QByteArray QOAuth::Signer::consumerSecret() const
+{
+    return d->consumerSecret;
+}
+
+/*!
+  \brief Returns the RSA private key used by the signer for RSA-SHA1 signatures.
+*/
+
+QCA::PrivateKey QOAuth::Signer::privateKey() const
+{
+    return d->privateKey;
+}
+
+/*!
+  \brief Returns the maximum number of HMAC-SHA1 keys kept in the signer's cache.
+
+  \sa setHmacCacheCapacity()
+*/
+
+int QOAuth::Signer::hmacCacheCapacity() const
+{
+    return d->hmacCache->capacity();
+}
+
+/*!
+  \brief Sets the maximum number of HMAC-SHA1 keys kept in the signer's cache to \a capacity.
+
+  Every distinct Token Secret used with the signer takes one cache entry. When the cache is
+  full, the least recently used keys are dropped. Setting \a capacity to \c 0 disables caching.
+  The default capacity is 1024 keys.
+
+  Keys are looked up without locking. A key that is set up while another thread is adding
+  one to the cache is not cached, so signing never waits for other threads.
+
+  Resizing starts with an empty cache, which is shared from now on with the copies
+  made of this signer, but not with the copies made before.
+
+  \sa hmacCacheHits(), hmacCacheMisses()
+*/
+
+void QOAuth::Signer::setHmacCacheCapacity( int capacity )
+{
+    d->hmacCache = QSharedPointer<HmacKeyCache>( new HmacKeyCache( capacity ) );
+}
+
+/*!
+  \brief Returns the number of HMAC-SHA1 signatures created with a cached key.
+
+  Use it together with hmacCacheMisses() to adjust the \ref hmacCacheCapacity().
+*/
+
+int QOAuth::Signer::hmacCacheHits() const
+{
+    return d->hmacCache->hits();
+}
+
+/*!
+  \brief Returns the number of HMAC-SHA1 signatures that required the key setup.
+
+  \sa hmacCacheHits()
+*/
+
+int QOAuth::Signer::hmacCacheMisses() const
+{
+    return d->hmacCache->misses();
+}
+
+/*!
+  \brief Returns the source of the <em>oauth_nonce</em> values of the signed requests.
+
+  \sa setNonceSource()
+*/
+
+QSharedPointer<QOAuth::NonceSource> QOAuth::Signer::nonceSource() const
+{
+    return d->nonceSource;
+}
+
+/*!
+  \brief Makes the signer take the <em>oauth_nonce</em> values from \a source.
+
+  The \a source is shared with the copies made of this signer from now on, and it's used
+  from all the threads signing with them. Passing a null pointer restores
+  QOAuth::NonceSource::defaultSource().
+*/
+
+void QOAuth::Signer::setNonceSource( const QSharedPointer<NonceSource> &source )
+{
+    d->nonceSource = source.isNull() ? NonceSource::defaultSource() : source;
+}
+
+/*!
+  \brief Returns the source of the <em>oauth_timestamp</em> values of the signed requests.
+
+  \sa setTimestampSource()
+*/
+
+QSharedPointer<QOAuth::TimestampSource> QOAuth::Signer::timestampSource() const
+{
+    return d->timestampSource;
+}
+
+/*!
+  \brief Makes the signer take the <em>oauth_timestamp</em> values from \a source.
+
+  Use it to correct the difference between the local clock and the Service Provider's one
+  (see QOAuth::ClockTimestampSource::setOffset()), or to sign with fixed timestamps.
+  The \a source is shared with the copies made of this signer from now on. Passing a null
+  pointer restores QOAuth::TimestampSource::defaultSource().
+*/
+
+void QOAuth::Signer::setTimestampSource( const QSharedPointer<TimestampSource> &source )
+{
+    d->timestampSource = source.isNull() ? TimestampSource::defaultSource() : source;
+}
+
+/*!
+  This method generates a parameters string for accessing Protected Resources, signed with
+  the \a signatureMethod. The arguments have the same meaning as in
+  QOAuth::Interface::createParametersString().
+
+  This method is thread-safe. If \a error is not null, it is set to QOAuth::NoError on success,
+  or to the code of the error that prevented the signature from being created. In the latter
+  case an empty byte array is returned.
+
+  \sa QOAuth::Interface::createParametersString()
+*/
+
+QByteArray QOAuth::Signer::sign( const QString &requestUrl, HttpMethod httpMethod,
+                                 const QByteArray &token, const QByteArray &tokenSecret,
+                                 SignatureMethod signatureMethod, const ParamMap &params,
+                                 ParsingMode mode, int *error ) const
+{
+    return sign( requestUrl, httpMethod, token, tokenSecret, signatureMethod,
+                 ParamList( params ), mode, error );
+}
+
+/*!
+  \overload
+
+  This version takes the parameters in a QOAuth::ParamList, which spares the conversion
+  from QOAuth::ParamMap. It's the faster one for requests with many parameters.
+*/
+
+QByteArray QOAuth::Signer::sign( const QString &requestUrl, HttpMethod httpMethod,
+                                 const QByteArray &token, const QByteArray &tokenSecret,
+                                 SignatureMethod signatureMethod, const ParamList &params,
+                                 ParsingMode mode, int *error ) const
+{
+    int signError = NoError;
+    SigningContext context;
+
+    bool prepared = d->prepareContext( signatureMethod, mode, &context, &signError );
+
+    if ( error ) {
+        *error = signError;
+    }
+
+    // return an empty bytearray when signature can't be created
+    if ( !prepared ) {
+        return QByteArray();
+    }
+
+    return d->signRequest( context, requestUrl, httpMethod, token, tokenSecret, params );
+}
+
+/*!
+  This method signs all the \a requests at once, using the \a signatureMethod, and returns
+  the resulting parameters strings (formatted according to \a mode) in the same order
+  as the requests.
+
+  The result is the same as calling \ref sign() for every request in turn, but the work
+  that doesn't depend on a particular request (checking the credentials and the available
+  algorithms, preparing the timestamp and the Consumer Secret part of the signing key)
+  is done only once per batch. Moreover, large batches are split into chunks that are
+  signed in parallel on the global QThreadPool, and in the calling thread. On CPUs
+  supporting AVX2, the HMAC-SHA1 digests of a chunk are computed eight at a time.
+
+  All requests in the batch share the same timestamp, they differ in nonces.
+
+  If \a error is not null, it is set to the error code of the call. When the signature
+  can't be created (e.g. because of missing credentials), an empty vector is returned.
+
+  \sa sign()
+*/
+
+QVector<QByteArray> QOAuth::Signer::signBatch( const QVector<SigningRequest> &requests,
+                                               SignatureMethod signatureMethod, ParsingMode mode,
+                                               int *error ) const
+{
+    int signError = NoError;
+    SigningContext context;
+
+    bool prepared = d->prepareContext( signatureMethod, mode, &context, &signError );
+
+    if ( error ) {
+        *error = signError;
+    }
+
+    if ( !prepared ) {
+        return QVector<QByteArray>();
+    }
+
+    QVector<QByteArray> results( requests.size() );
+    if ( requests.isEmpty() ) {
+        return results;
+    }
+
+    BatchJob job( d.constData(), context, requests.constData(), results.data(), requests.size() );
+
+    // don't bother other threads with small batches
+    int chunks = ( requests.size() + BatchJob::ChunkSize - 1 ) / BatchJob::ChunkSize;
+    int helpers = qMin( chunks, QThread::idealThreadCount() ) - 1;
+    int started = 0;
+
+    // tryStart() never queues, so the helpers that got started will run shortly,
+    // and if the pool is busy the calling thread simply does all the work itself
+    for ( int i = 0; i < helpers; ++i ) {
+        if ( !QThreadPool::globalInstance()->tryStart( new BatchRunnable( &job ) ) ) {
+            break;
+        }
+        ++started;
+    }
+
+    job.process();
+    job.done.acquire( started );
+
+    return results;
+}
+
+
+QOAuth::BatchJob::BatchJob( const SignerPrivate *signer, const SigningContext &context,
+                            const SigningRequest *requests, QByteArray *results, int count ) :
+        signer( signer ),
+        context( context ),
+        requests( requests ),
+        results( results ),
+        count( count ),
+        next( 0 )
+{
+}
+
+void QOAuth::BatchJob::process()
+{
+    forever {
+        int begin = next.fetchAndAddRelaxed( ChunkSize );
+        if ( begin >= count ) {
+            return;
+        }
+        int end = qMin( begin + ChunkSize, count );
+
+        signer->signRequests( context, requests + begin, results + begin, end - begin );
+    }
+}
+
+QOAuth::BatchRunnable::BatchRunnable( BatchJob *job ) :
+        job( job )
+{
+}
+
+void QOAuth::BatchRunnable::run()
+{
+    job->process();
+    job->done.release();
+}
+
+
+bool QOAuth::SignerPrivate::prepareContext( SignatureMethod signatureMethod, ParsingMode mode,
+                                            SigningContext *context, int *error ) const
+{
+    if ( signatureMethod < HMAC_SHA1 || signatureMethod > PLAINTEXT ) {
+        qWarning() << __FUNCTION__ << "- unknown signature method" << int( signatureMethod );
+        *error = OtherError;
+        return false;
+    }
+
+    if ( ( signatureMethod == HMAC_SHA1 ||
+           signatureMethod == RSA_SHA1 ) &&
+         consumerKey.isEmpty() ) {
+        qWarning() << __FUNCTION__ << "- consumer key is empty, make sure that you set it"
+                                      "with QOAuth::Interface::setConsumerKey()";
+        *error = ConsumerKeyEmpty;
+        return false;
+    }
+    if ( consumerSecret.isEmpty() ) {
+        qWarning() << __FUNCTION__ << "- consumer secret is empty, make sure that you set it"
+                                      "with QOAuth::Interface::setConsumerSecret()";
+        *error = ConsumerSecretEmpty;
+        return false;
+    }
+
+    if ( signatureMethod == RSA_SHA1 &&
+         privateKey.isNull() ) {
+        qWarning() << __FUNCTION__ << "- RSA private key is empty, make sure that you provide it"
+                                      "with QOAuth::Interface::setRSAPrivateKey{,FromFile}()";
+        *error = RSAPrivateKeyEmpty;
+        return false;
+    }
+
+    context->signatureMethod = signatureMethod;
+    context->mode = mode;
+    context->signatureMethodParam = &signatureMethodParams[signatureMethod];
+
+    context->timestampParam = EncodedParam( InterfacePrivate::ParamTimestamp, timestampSource->timestamp() );
+
+    // the Consumer Secret part of the HMAC-SHA1 key and PLAINTEXT signature
+    context->percentConsumerSecret = PercentEncoding::encode( consumerSecret ) + "&";
+
+    *error = NoError;
+    return true;
+}
+
+QByteArray QOAuth::SignerPrivate::signRequest( const SigningContext &context, const QString &requestUrl,
+                                               HttpMethod httpMethod, const QByteArray &token,
+                                               const QByteArray &tokenSecret, const ParamList &params ) const
+{
+    // the user parameters are the only ones that may need sorting
+    if ( !params.isSorted() ) {
+        ParamList sortedParams = params;
+        sortedParams.sort();
+        return signRequest( context, requestUrl, httpMethod, token, tokenSecret, sortedParams );
+    }
+
+    OAuthParams oauthParams;
+    prepareOAuthParams( context, token, &oauthParams );
+
+    // calculate the signature
+    QByteArray signature = createSignature( context, requestUrl, httpMethod, tokenSecret,
+                                            params, oauthParams );
+
+    // convert the parameters to bytearray, according to requested mode
+    return createParametersString( context, params, oauthParams, signature );
+}
+
+void QOAuth::SignerPrivate::signRequests( const SigningContext &context, const SigningRequest *requests,
+                                          QByteArray *results, int count ) const
+{
+    if ( context.signatureMethod != HMAC_SHA1 || count < 2 || HmacSha1::lanes() < 2 ) {
+        for ( int i = 0; i < count; ++i ) {
+            const SigningRequest &request = requests[i];
+            results[i] = signRequest( context, request.requestUrl, request.httpMethod,
+                                      request.token, request.tokenSecret, request.params );
+        }
+        return;
+    }
+
+    QVector<ParamList> parameters( count );
+    QScopedArrayPointer<OAuthParams> oauthParams( new OAuthParams[count] );
+    QVector<QByteArray> baseStrings( count );
+    QVector<HmacSha1Key> keys( count );
+
+    for ( int i = 0; i < count; ++i ) {
+        const SigningRequest &request = requests[i];
+        parameters[i] = request.params;
+        prepareOAuthParams( context, request.token, &oauthParams[i] );
+        baseStrings[i] = buildSignatureBaseString( InterfacePrivate::httpMethodToString( request.httpMethod ),
+                                                   request.requestUrl, parameters.at( i ), &oauthParams[i] );
+        keys[i] = hmacCache->hmacKey( hmacKey( context, request.tokenSecret ) );
+    }
+
+    QByteArray digests( count * Sha1::DigestSize, Qt::Uninitialized );
+    HmacSha1::macMany( keys.constData(), baseStrings.constData(),
+                       reinterpret_cast<uchar *>( digests.data() ), count );
+
+    for ( int i = 0; i < count; ++i ) {
+        QByteArray digest( Base64::encodedSize( Sha1::DigestSize ), Qt::Uninitialized );
+        Base64::encode( digest.data(), reinterpret_cast<const uchar *>( digests.constData() ) + i * Sha1::DigestSize,
+                        Sha1::DigestSize );
+        results[i] = createParametersString( context, parameters.at( i ), oauthParams[i],
+                                             PercentEncoding::encode( digest ) );
+    }
+}
+
+QByteArray QOAuth::SignerPrivate::createSignature( const SigningContext &context, const QString &requestUrl,
+                                                   HttpMethod httpMethod, const QByteArray &tokenSecret,
+                                                   const ParamList &params, const OAuthParams &oauthParams ) const
+{
+    QByteArray digest;
+
+    // PLAINTEXT doesn't use the Signature Base String
+    if ( context.signatureMethod == PLAINTEXT ) {
+        digest = createPlaintextSignature( context, tokenSecret );
+    } else if ( context.signatureMethod == HMAC_SHA1 ) {
+        // create HMAC-SHA1 digest in Base64, hashing the Signature Base String
+        // as it's being written, so that it never exists in one piece
+        HmacSha1 hmac( hmacCache->hmacKey( hmacKey( context, tokenSecret ) ) );
+        HmacSha1Sink sink( &hmac );
+        streamSignatureBaseString( InterfacePrivate::httpMethodToString( httpMethod ),
+                                   requestUrl, params, &sink, &oauthParams );
+        digest = Base64::encode( hmac.final() );
+
+    } else if ( context.signatureMethod == RSA_SHA1 ) {
+        // signing is a non-const operation on the key, so work on a private copy
+        // of it - this detaches the provider context and keeps concurrent calls apart
+        QCA::PrivateKey key = privateKey;
+        // sign the Signature Base String with the RSA key
+        key.startSign( QCA::EMSA3_SHA1 );
+        RsaSha1Sink sink( &key );
+        streamSignatureBaseString( InterfacePrivate::httpMethodToString( httpMethod ),
+                                   requestUrl, params, &sink, &oauthParams );
+        digest = Base64::encode( key.signature() );
+    }
+
+    // percent-encode the digest
+    QByteArray signature = PercentEncoding::encode( digest );
+    return signature;
+}
+
+void QOAuth::SignerPrivate::prepareOAuthParams( const SigningContext &context, const QByteArray &token,
+                                                OAuthParams *oauthParams ) const
+{
+    oauthParams->nonce = EncodedParam( InterfacePrivate::ParamNonce, nonceSource->nonce() );
+
+    // the names are sorted already: oauth_consumer_key, oauth_nonce, oauth_signature_method,
+    // oauth_timestamp, oauth_token, oauth_version
+    int count = 0;
+    oauthParams->params[count++] = &consumerKeyParam;
+    oauthParams->params[count++] = &oauthParams->nonce;
+    oauthParams->params[count++] = context.signatureMethodParam;
+    oauthParams->params[count++] = &context.timestampParam;
+    // append token only if it is defined (requestToken() doesn't use a token at all)
+    if ( !token.isEmpty() ) {
+        oauthParams->token = EncodedParam( InterfacePrivate::ParamToken, token );
+        oauthParams->params[count++] = &oauthParams->token;
+    }
+    oauthParams->params[count++] = &versionParam;
+    oauthParams->count = count;
+}
+
+// the order of parameters in the Signature Base String: by names, then by values
+static inline bool paramLessThan( const QOAuth::ParamList::Param &param, const QOAuth::EncodedParam *other )
+{
+    return param.first < other->name ||
+           ( param.first == other->name && param.second < other->value );
+}
+
+QByteArray QOAuth::SignerPrivate::createParametersString( const SigningContext &context, const ParamList &params,
+                                                          const OAuthParams &oauthParams,
+                                                          const QByteArray &signature )
+{
+    EncodedParam signatureParam;
+    signatureParam.name = InterfacePrivate::ParamSignature;
+    signatureParam.value = signature;
+
+    // oauth_signature goes right before oauth_signature_method
+    const EncodedParam *oauth[OAuthParams::MaxCount + 1];
+    int count = 0;
+    for ( int i = 0; i < oauthParams.count; ++i ) {
+        if ( oauthParams.params[i]->name == InterfacePrivate::ParamSignatureMethod ) {
+            oauth[count++] = &signatureParam;
+        }
+        oauth[count++] = oauthParams.params[i];
+    }
+
+    // merge the sorted user parameters with the oauth_* ones
+    ParamList parameters;
+    parameters.reserve( params.size() + count );
+    ParamList::const_iterator it = params.constBegin();
+    int i = 0;
+    while ( it != params.constEnd() || i < count ) {
+        if ( i < count && ( it == params.constEnd() || !paramLessThan( *it, oauth[i] ) ) ) {
+            parameters.append( oauth[i]->name, oauth[i]->value );
+            ++i;
+        } else {
+            parameters.append( it->first, it->second );
+            ++it;
+        }
+    }
+
+    return InterfacePrivate::paramsToString( parameters, context.mode );
+}
+
+// Writes the Signature Base String to the writer, which is either BufferWriter
+// or ChunkWriter below. The params have to be sorted, the oauthParams (if given)
+// are merged into them. The result is the same as of:
+//   httpMethod + "&" + requestUrl.toLatin1().toPercentEncoding() + "&" +
+//   paramsToString( all the params, ParseForSignatureBaseString ).toPercentEncoding()
+template <typename Writer>
+static void writeSignatureBaseString( const QByteArray &httpMethod, const QString &requestUrl,
+                                      const QOAuth::ParamList &params,
+                                      const QOAuth::OAuthParams *oauthParams, Writer *writer )
+{
+    Q_ASSERT( params.isSorted() );
+
+    writer->append( httpMethod.constData(), httpMethod.size() );
+    writer->append( "&", 1 );
+    writer->appendEncoded( requestUrl );
+    writer->append( "&", 1 );
+
+    int oauthCount = oauthParams ? oauthParams->count : 0;
+    int i = 0;
+    QOAuth::ParamList::const_iterator it = params.constBegin();
+    bool first = true;
+
+    while ( it != params.constEnd() || i < oauthCount ) {
+        if ( !first ) {
+            writer->append( "%26", 3 );
+        }
+        first = false;
+
+        if ( i < oauthCount && ( it == params.constEnd() || !paramLessThan( *it, oauthParams->params[i] ) ) ) {
+            // encoded already
+            const QByteArray &encoded = oauthParams->params[i]->encoded;
+            writer->append( encoded.constData(), encoded.size() );
+            ++i;
+        } else {
+            writer->appendEncoded( it->first );
+            writer->append( "%3D", 3 );
+            writer->appendEncoded( it->second );
+            ++it;
+        }
+    }
+}
+
+// writes into a buffer that is big enough for the whole string
+class BufferWriter
+{
+public:
+    explicit BufferWriter( char *buffer ) : output( buffer ) {}
+
+    inline void append( const char *data, int size )
+    {
+        memcpy( output, data, size );
+        output += size;
+    }
+    inline void appendEncoded( const QString &data )
+    {
+        output = QOAuth::PercentEncoding::encode( output, data );
+    }
+    inline void appendEncoded( const QByteArray &data )
+    {
+        output = QOAuth::PercentEncoding::encode( output, data );
+    }
+
+    char *output;
+};
+
+// collects the output in a fixed-size buffer, and passes it to the sink when full
+class ChunkWriter
+{
+public:
+    enum { ChunkSize = QOAuth::SignatureBaseStringSink::ChunkSize };
+
+    explicit ChunkWriter( QOAuth::SignatureBaseStringSink *sink ) : sink( sink ), used( 0 ) {}
+
+    void append( const char *data, int size )
+    {
+        while ( size > 0 ) {
+            int part = qMin( size, int( ChunkSize ) - used );
+            memcpy( buffer + used, data, part );
+            used += part;
+            data += part;
+            size -= part;
+            if ( used == ChunkSize ) {
+                flush();
+            }
+        }
+    }
+    void appendEncoded( const QString &data )
+    {
+        const ushort *input = data.utf16();
+        int size = data.size();
+        while ( size > 0 ) {
+            // every character takes at most 3 bytes
+            if ( ChunkSize - used < 3 ) {
+                flush();
+            }
+            int part = qMin( size, ( int( ChunkSize ) - used ) / 3 );
+            used = QOAuth::PercentEncoding::encode( buffer + used, input, part ) - buffer;
+            input += part;
+            size -= part;
+        }
+    }
+    void appendEncoded( const QByteArray &data )
+    {
+        const char *input = data.constData();
+        int size = data.size();
+        while ( size > 0 ) {
+            // every byte takes at most 3 bytes
+            if ( ChunkSize - used < 3 ) {
+                flush();
+            }
+            int part = qMin( size, ( int( ChunkSize ) - used ) / 3 );
+            used = QOAuth::PercentEncoding::encode( buffer + used, input, part ) - buffer;
+            input += part;
+            size -= part;
+        }
+    }
+    void flush()
+    {
+        if ( used > 0 ) {
+            sink->update( buffer, used );
+            used = 0;
+        }
+    }
+
+private:
+    QOAuth::SignatureBaseStringSink *sink;
+    char buffer[ChunkSize];
+    int used;
+};
+
+QByteArray QOAuth::SignerPrivate::buildSignatureBaseString( const QByteArray &httpMethod,
+                                                            const QString &requestUrl,
+                                                            const ParamList &params,
+                                                            const OAuthParams *oauthParams )
+{
+    if ( !params.isSorted() ) {
+        ParamList sortedParams = params;
+        sortedParams.sort();
+        return buildSignatureBaseString( httpMethod, requestUrl, sortedParams, oauthParams );
+    }
+
+    // 1. compute the size
+    int size = httpMethod.size() + 1 + PercentEncoding::encodedSize( requestUrl ) + 1;
+    int pairs = params.size();
+    for ( ParamList::const_iterator it = params.constBegin(); it != params.constEnd(); ++it ) {
+        // "%3D" between names and values
+        size += PercentEncoding::encodedSize( it->first ) + 3 +
+                PercentEncoding::encodedSize( it->second );
+    }
+    if ( oauthParams ) {
+        for ( int i = 0; i < oauthParams->count; ++i ) {
+            size += oauthParams->params[i]->encoded.size();
+        }
+        pairs += oauthParams->count;
+    }
+    if ( pairs > 0 ) {
+        // "%26" between pairs
+        size += 3 * ( pairs - 1 );
+    }
+
+    // 2. write it
+    QByteArray signatureBaseString( size, Qt::Uninitialized );
+    BufferWriter writer( signatureBaseString.data() );
+    writeSignatureBaseString( httpMethod, requestUrl, params, oauthParams, &writer );
+    Q_ASSERT( writer.output == signatureBaseString.constData() + size );
+
+    return signatureBaseString;
+}
+
+void QOAuth::SignerPrivate::streamSignatureBaseString( const QByteArray &httpMethod,
+                                                       const QString &requestUrl,
+                                                       const ParamList &params,
+                                                       SignatureBaseStringSink *sink,
+                                                       const OAuthParams *oauthParams )
+{
+    if ( !params.isSorted() ) {
+        ParamList sortedParams = params;
+        sortedParams.sort();
+        streamSignatureBaseString( httpMethod, requestUrl, sortedParams, sink, oauthParams );
+        return;
+    }
+
+    ChunkWriter writer( sink );
+    writeSignatureBaseString( httpMethod, requestUrl, params, oauthParams, &writer );
+    writer.flush();
+}
+
+
+QOAuth::SignatureBaseStringSink::~SignatureBaseStringSink()
+{
+}
+
+QOAuth::HmacSha1Sink::HmacSha1Sink( HmacSha1 *hmac ) :
+        hmac( hmac )
+{
+}
+
+void QOAuth::HmacSha1Sink::update( const char *data, int size )
+{
+    hmac->update( data, size );
+}
+
+QOAuth::RsaSha1Sink::RsaSha1Sink( QCA::PrivateKey *key ) :
+        key( key )
+{
+}
+
+void QOAuth::RsaSha1Sink::update( const char *data, int size )
+{
+    // the chunk is only borrowed for the duration of the call
+    key->update( QCA::MemoryRegion( QByteArray::fromRawData( data, size ) ) );
+}
+
+QByteArray QOAuth::SignerPrivate::hmacKey( const SigningContext &context,
+                                           const QByteArray &tokenSecret ) const
+{
+    // create key for HMAC-SHA1 hashing
+    return context.percentConsumerSecret + PercentEncoding::encode( tokenSecret );
+}
+
+QByteArray QOAuth::SignerPrivate::createPlaintextSignature( const SigningContext &context,
+                                                            const QByteArray &tokenSecret ) const
+{
+    // join percent encoded consumer secret and token secret
+    return context.percentConsumerSecret + PercentEncoding::encode( tokenSecret );
+}
@@ -0,0 +1,109 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file signer.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef SIGNER_H
+#define SIGNER_H
+
+#include <QSharedDataPointer>
+#include <QVector>
+
+#include <QtCrypto>
+
+#include "qoauth_global.h"
+#include "qoauth_namespace.h"
+#include "paramlist.h"
+#include "noncesource.h"
+#include "timestampsource.h"
+
+namespace QOAuth {
+
+class SignerPrivate;
+
+struct QOAUTH_EXPORT SigningRequest
+{
+    SigningRequest();
+    SigningRequest( const QString &requestUrl, HttpMethod httpMethod,
+                    const QByteArray &token, const QByteArray &tokenSecret,
+                    const ParamMap &params = ParamMap() );
+
+    QString requestUrl;
+    HttpMethod httpMethod;
+    QByteArray token;
+    QByteArray tokenSecret;
+    ParamMap params;
+};
+
+class QOAUTH_EXPORT Signer
+{
+public:
+    Signer();
+    Signer( const QByteArray &consumerKey, const QByteArray &consumerSecret,
+            const QCA::PrivateKey &privateKey = QCA::PrivateKey() );
+    Signer( const Signer &other );
+    ~Signer();
+
+    Signer &operator=( const Signer &other );
+
+    QByteArray consumerKey() const;
+    QByteArray consumerSecret() const;
+    QCA::PrivateKey privateKey() const;
+
+    int hmacCacheCapacity() const;
+    void setHmacCacheCapacity( int capacity );
+    int hmacCacheHits() const;
+    int hmacCacheMisses() const;
+
+    QSharedPointer<NonceSource> nonceSource() const;
+    void setNonceSource( const QSharedPointer<NonceSource> &source );
+
+    QSharedPointer<TimestampSource> timestampSource() const;
+    void setTimestampSource( const QSharedPointer<TimestampSource> &source );
+
+    QByteArray sign( const QString &requestUrl, HttpMethod httpMethod,
+                     const QByteArray &token, const QByteArray &tokenSecret,
+                     SignatureMethod signatureMethod, const ParamMap &params,
+                     ParsingMode mode, int *error = 0 ) const;
+    QByteArray sign( const QString &requestUrl, HttpMethod httpMethod,
+                     const QByteArray &token, const QByteArray &tokenSecret,
+                     SignatureMethod signatureMethod, const ParamList &params,
+                     ParsingMode mode, int *error = 0 ) const;
+
+    QVector<QByteArray> signBatch( const QVector<SigningRequest> &requests,
+                                   SignatureMethod signatureMethod, ParsingMode mode,
+                                   int *error = 0 ) const;
+
+private:
+    QSharedDataPointer<SignerPrivate> d;
+
+#ifdef UNIT_TEST
+    friend class Ut_Interface;
+#endif
+};
+
+} // namespace QOAuth
+
+#endif // SIGNER_H
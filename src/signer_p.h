@@ -0,0 +1,227 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+/*!
+  \file signer_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef SIGNER_P_H
+#define SIGNER_P_H
+
+#include "signer.h"
+#include "hmackeycache_p.h"
+#include "sha1_p.h"
+#include "qcaruntime_p.h"
+#include <QSharedData>
+#include <QSharedPointer>
+#include <QAtomicInt>
+#include <QSemaphore>
+#include <QRunnable>
+
+namespace QOAuth {
+
+// A parameter along with its form in the Signature Base String: the name
+// and the value (passed in already encoded, as for all the parameters)
+// encoded once more, joined with an encoded '='.
+struct EncodedParam
+{
+    EncodedParam();
+    EncodedParam( const QByteArray &name, const QByteArray &value );
+
+    QByteArray name;
+    QByteArray value;
+    QByteArray encoded;
+};
+
+// Everything that doesn't depend on the request being signed. It's prepared
+// once per Signer::sign() call, or once for the whole Signer::signBatch().
+struct SigningContext
+{
+    SignatureMethod signatureMethod;
+    ParsingMode mode;
+    // owned by the signer
+    const EncodedParam *signatureMethodParam;
+    EncodedParam timestampParam;
+    // percent-encoded Consumer Secret followed by '&'
+    QByteArray percentConsumerSecret;
+};
+
+// The oauth_* parameters of a single request, in the order of names. Most of
+// them point to the fragments prepared by the signer, only the nonce and the
+// token are created per request.
+struct OAuthParams
+{
+    enum { MaxCount = 6 };
+
+    OAuthParams() : count( 0 ) {}
+
+    const EncodedParam *params[MaxCount];
+    int count;
+
+    EncodedParam nonce;
+    EncodedParam token;
+
+private:
+    // params point to the members
+    Q_DISABLE_COPY(OAuthParams)
+};
+
+// Receives the Signature Base String piece by piece, at most ChunkSize bytes
+// at a time, when it's streamed rather than built in memory.
+class QOAUTH_EXPORT SignatureBaseStringSink
+{
+public:
+    enum { ChunkSize = 4096 };
+
+    virtual ~SignatureBaseStringSink();
+    virtual void update( const char *data, int size ) = 0;
+};
+
+class HmacSha1Sink : public SignatureBaseStringSink
+{
+public:
+    explicit HmacSha1Sink( HmacSha1 *hmac );
+    void update( const char *data, int size );
+
+private:
+    HmacSha1 *hmac;
+};
+
+// the key has to be in the signing state (after startSign())
+class RsaSha1Sink : public SignatureBaseStringSink
+{
+public:
+    explicit RsaSha1Sink( QCA::PrivateKey *key );
+    void update( const char *data, int size );
+
+private:
+    QCA::PrivateKey *key;
+};
+
+// All the methods are const and touch no shared mutable state,
+// which is what makes Signer safe to use from many threads at once.
+class QOAUTH_EXPORT SignerPrivate : public QSharedData
+{
+public:
+    SignerPrivate();
+
+    bool prepareContext( SignatureMethod signatureMethod, ParsingMode mode,
+                         SigningContext *context, int *error ) const;
+
+    QByteArray signRequest( const SigningContext &context, const QString &requestUrl,
+                            HttpMethod httpMethod, const QByteArray &token,
+                            const QByteArray &tokenSecret, const ParamList &params ) const;
+
+    // signs count requests; for HMAC-SHA1 the digests are computed together,
+    // several messages at a time when the CPU allows that
+    void signRequests( const SigningContext &context, const SigningRequest *requests,
+                       QByteArray *results, int count ) const;
+
+    // params have to be sorted
+    QByteArray createSignature( const SigningContext &context, const QString &requestUrl,
+                                HttpMethod httpMethod, const QByteArray &tokenSecret,
+                                const ParamList &params, const OAuthParams &oauthParams ) const;
+
+    // creates the nonce and collects the oauth_* parameters of a request
+    void prepareOAuthParams( const SigningContext &context, const QByteArray &token,
+                             OAuthParams *oauthParams ) const;
+
+    // the parameters string in the context's mode: params, oauthParams and the signature, sorted
+    static QByteArray createParametersString( const SigningContext &context, const ParamList &params,
+                                              const OAuthParams &oauthParams, const QByteArray &signature );
+
+    QByteArray hmacKey( const SigningContext &context, const QByteArray &tokenSecret ) const;
+
+    // joins the method, the encoded URL and the encoded parameters, merged with
+    // the encoded oauthParams (if any); the size of the result is computed first,
+    // so that it's written in one go into a single buffer
+    static QByteArray buildSignatureBaseString( const QByteArray &httpMethod, const QString &requestUrl,
+                                                const ParamList &params,
+                                                const OAuthParams *oauthParams = 0 );
+
+    // passes the same string to the sink in pieces, encoding the parameters into a fixed-size
+    // buffer, so that memory use doesn't depend on the size of the parameters
+    static void streamSignatureBaseString( const QByteArray &httpMethod, const QString &requestUrl,
+                                           const ParamList &params, SignatureBaseStringSink *sink,
+                                           const OAuthParams *oauthParams = 0 );
+
+    // for PLAINTEXT only
+    QByteArray createPlaintextSignature( const SigningContext &context,
+                                         const QByteArray &tokenSecret ) const;
+
+    // encodes the parameters that are the same for all the requests;
+    // done whenever the credentials are set
+    void prepareFragments();
+
+    QcaRuntime qcaRuntime;
+
+    QByteArray consumerKey;
+    QByteArray consumerSecret;
+    QCA::PrivateKey privateKey;
+
+    EncodedParam consumerKeyParam;
+    // indexed with SignatureMethod
+    EncodedParam signatureMethodParams[PLAINTEXT + 1];
+    EncodedParam versionParam;
+
+    // shared by all copies of the signer
+    QSharedPointer<HmacKeyCache> hmacCache;
+    QSharedPointer<NonceSource> nonceSource;
+    QSharedPointer<TimestampSource> timestampSource;
+};
+
+// A batch being signed. Requests are handed out in chunks to whichever
+// thread asks first, results go straight to their slots in the output.
+class BatchJob
+{
+public:
+    enum { ChunkSize = 32 };
+
+    BatchJob( const SignerPrivate *signer, const SigningContext &context,
+              const SigningRequest *requests, QByteArray *results, int count );
+
+    void process();
+
+    const SignerPrivate *signer;
+    const SigningContext &context;
+    const SigningRequest *requests;
+    QByteArray *results;
+    int count;
+
+    QAtomicInt next;
+    QSemaphore done;
+};
+
+class BatchRunnable : public QRunnable
+{
+public:
+    explicit BatchRunnable( BatchJob *job );
+    void run();
+
+private:
+    BatchJob *job;
+};
+
+} // namespace QOAuth
+
+#endif // SIGNER_P_H
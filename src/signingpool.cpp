@@ -0,0 +1,289 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "signingpool.h"
+#include "signingpool_p.h"
+
+#include <QElapsedTimer>
+#include <QMutexLocker>
+
+
+QOAuth::SigningWorker::SigningWorker( SigningPoolPrivate *pool ) :
+        pool( pool )
+{
+}
+
+void QOAuth::SigningWorker::run()
+{
+    pool->work();
+}
+
+
+QOAuth::SigningPoolPrivate::SigningPoolPrivate( const Signer &signer, int queueCapacity ) :
+        signer( signer ),
+        queueCapacity( qMax( queueCapacity, 1 ) ),
+        activeCount( 0 ),
+        stopping( false )
+{
+}
+
+bool QOAuth::SigningPoolPrivate::takeTask( SigningTask *task )
+{
+    QMutexLocker locker( &mutex );
+
+    while ( queue.isEmpty() && !stopping ) {
+        notEmpty.wait( &mutex );
+    }
+    // the remaining tasks are signed also when stopping
+    if ( queue.isEmpty() ) {
+        return false;
+    }
+
+    *task = queue.dequeue();
+    ++activeCount;
+    notFull.wakeOne();
+    return true;
+}
+
+void QOAuth::SigningPoolPrivate::taskDone()
+{
+    QMutexLocker locker( &mutex );
+
+    --activeCount;
+    if ( queue.isEmpty() && activeCount == 0 ) {
+        idle.wakeAll();
+    }
+}
+
+void QOAuth::SigningPoolPrivate::work()
+{
+    SigningTask task;
+    while ( takeTask( &task ) ) {
+        // skip the tasks cancelled with QFuture::cancel() while queued
+        if ( !task.result.isCanceled() ) {
+            const SigningRequest &request = task.request;
+            SigningResult result;
+            result.parameters = signer.sign( request.requestUrl, request.httpMethod, request.token,
+                                             request.tokenSecret, task.signatureMethod, request.params,
+                                             task.mode, &result.error );
+            task.result.reportResult( result );
+        }
+        task.result.reportFinished();
+        taskDone();
+    }
+}
+
+
+/*!
+  \struct QOAuth::SigningResult signingpool.h <QtOAuth/signingpool.h>
+  \brief The outcome of signing a request in QOAuth::SigningPool.
+
+  \ref parameters holds the parameters string, as returned by QOAuth::Signer::sign(), and
+  \ref error holds the QOAuth::ErrorCode of the signing. The parameters are empty on error.
+*/
+
+/*!
+  \brief Creates an empty result, with the error set to QOAuth::NoError.
+*/
+
+QOAuth::SigningResult::SigningResult() :
+        error( NoError )
+{
+}
+
+
+/*!
+  \class QOAuth::SigningPool signingpool.h <QtOAuth/signingpool.h>
+  \brief Signs requests on a fixed set of worker threads.
+
+  RSA-SHA1 signatures cost much more than HMAC-SHA1 ones, and signing them on the threads
+  that handle the requests holds those threads up. SigningPool takes the signing off them:
+  submit() puts a request in a queue and returns immediately with a QFuture, which gets the
+  QOAuth::SigningResult once one of the pool's threads has signed the request. Connect
+  a QFutureWatcher to the future to get notified, or call QFuture::result() to wait for it.
+
+  \code
+  QOAuth::SigningPool pool( interface->signer() );
+
+  QOAuth::SigningRequest request( "http://example.com/resource", QOAuth::GET, token, tokenSecret );
+  QFuture<QOAuth::SigningResult> future = pool.submit( request, QOAuth::RSA_SHA1,
+                                                       QOAuth::ParseForHeaderArguments );
+  // ...
+  QOAuth::SigningResult result = future.result();
+  if ( result.error == QOAuth::NoError ) {
+      networkRequest.setRawHeader( "Authorization", result.parameters );
+  }
+  \endcode
+
+  The queue is bounded: when \ref queueCapacity() requests are already waiting, submit()
+  blocks until a thread takes one of them, or fails after the given timeout. This way
+  a producer faster than the pool doesn't pile up an unlimited number of requests.
+
+  All the methods are thread-safe, any number of threads can submit requests to one pool.
+  Destroying the pool waits until all the submitted requests are signed.
+*/
+
+/*!
+  \brief Creates a pool of \a threadCount threads signing with \a signer.
+
+  When \a threadCount is \c 0 or less, one thread per CPU core is started. At most
+  \a queueCapacity requests wait in the queue for a free thread.
+*/
+
+QOAuth::SigningPool::SigningPool( const Signer &signer, int threadCount, int queueCapacity ) :
+        d( new SigningPoolPrivate( signer, queueCapacity ) )
+{
+    if ( threadCount <= 0 ) {
+        threadCount = qMax( QThread::idealThreadCount(), 1 );
+    }
+
+    for ( int i = 0; i < threadCount; ++i ) {
+        SigningWorker *worker = new SigningWorker( d );
+        d->workers.append( worker );
+        worker->start();
+    }
+}
+
+/*!
+  \brief Signs the requests remaining in the queue, stops the threads and destroys the pool.
+*/
+
+QOAuth::SigningPool::~SigningPool()
+{
+    {
+        QMutexLocker locker( &d->mutex );
+        d->stopping = true;
+        d->notEmpty.wakeAll();
+        d->notFull.wakeAll();
+    }
+
+    Q_FOREACH ( SigningWorker *worker, d->workers ) {
+        worker->wait();
+    }
+    qDeleteAll( d->workers );
+
+    delete d;
+}
+
+/*!
+  \brief Returns the signer used by the pool.
+*/
+
+QOAuth::Signer QOAuth::SigningPool::signer() const
+{
+    return d->signer;
+}
+
+/*!
+  \brief Returns the number of the pool's threads.
+*/
+
+int QOAuth::SigningPool::threadCount() const
+{
+    return d->workers.size();
+}
+
+/*!
+  \brief Returns the maximum number of requests waiting in the queue.
+*/
+
+int QOAuth::SigningPool::queueCapacity() const
+{
+    return d->queueCapacity;
+}
+
+/*!
+  \brief Returns the number of requests waiting in the queue, not counting
+  the ones being signed.
+*/
+
+int QOAuth::SigningPool::queuedCount() const
+{
+    QMutexLocker locker( &d->mutex );
+
+    return d->queue.size();
+}
+
+/*!
+  \brief Queues \a request to be signed using the given \a signatureMethod,
+  with the parameters string in the given \a mode.
+
+  If the queue is full, waits at most \a msecs milliseconds for room in it; a negative
+  value (the default) waits for as long as it takes. When there's still no room, the
+  request isn't queued and the returned future is cancelled (QFuture::isCanceled()
+  returns \c true).
+
+  Cancelling the returned future before a thread takes the request skips it.
+
+  \sa waitForDone()
+*/
+
+QFuture<QOAuth::SigningResult> QOAuth::SigningPool::submit( const SigningRequest &request,
+                                                            SignatureMethod signatureMethod,
+                                                            ParsingMode mode, int msecs )
+{
+    SigningTask task;
+    task.request = request;
+    task.signatureMethod = signatureMethod;
+    task.mode = mode;
+    task.result.reportStarted();
+    QFuture<SigningResult> future = task.result.future();
+
+    QMutexLocker locker( &d->mutex );
+
+    QElapsedTimer timer;
+    timer.start();
+    while ( !d->stopping && d->queue.size() >= d->queueCapacity ) {
+        if ( msecs < 0 ) {
+            d->notFull.wait( &d->mutex );
+            continue;
+        }
+        qint64 remaining = msecs - timer.elapsed();
+        if ( remaining <= 0 ) {
+            break;
+        }
+        d->notFull.wait( &d->mutex, (unsigned long) remaining );
+    }
+
+    if ( d->stopping || d->queue.size() >= d->queueCapacity ) {
+        locker.unlock();
+        task.result.reportCanceled();
+        task.result.reportFinished();
+        return future;
+    }
+
+    d->queue.enqueue( task );
+    d->notEmpty.wakeOne();
+    return future;
+}
+
+/*!
+  \brief Waits until all the submitted requests are signed.
+*/
+
+void QOAuth::SigningPool::waitForDone()
+{
+    QMutexLocker locker( &d->mutex );
+
+    while ( !d->queue.isEmpty() || d->activeCount > 0 ) {
+        d->idle.wait( &d->mutex );
+    }
+}
@@ -0,0 +1,76 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file signingpool.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef SIGNINGPOOL_H
+#define SIGNINGPOOL_H
+
+#include <QFuture>
+
+#include "qoauth_global.h"
+#include "qoauth_namespace.h"
+#include "signer.h"
+
+namespace QOAuth {
+
+class SigningPoolPrivate;
+
+struct QOAUTH_EXPORT SigningResult
+{
+    SigningResult();
+
+    QByteArray parameters;
+    int error;
+};
+
+class QOAUTH_EXPORT SigningPool
+{
+public:
+    enum { DefaultQueueCapacity = 256 };
+
+    explicit SigningPool( const Signer &signer, int threadCount = 0,
+                          int queueCapacity = DefaultQueueCapacity );
+    ~SigningPool();
+
+    Signer signer() const;
+    int threadCount() const;
+    int queueCapacity() const;
+    int queuedCount() const;
+
+    QFuture<SigningResult> submit( const SigningRequest &request, SignatureMethod signatureMethod,
+                                   ParsingMode mode, int msecs = -1 );
+
+    void waitForDone();
+
+private:
+    Q_DISABLE_COPY(SigningPool)
+    SigningPoolPrivate * const d;
+};
+
+} // namespace QOAuth
+
+#endif // SIGNINGPOOL_H
@@ -0,0 +1,94 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file signingpool_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef SIGNINGPOOL_P_H
+#define SIGNINGPOOL_P_H
+
+#include <QFutureInterface>
+#include <QList>
+#include <QMutex>
+#include <QQueue>
+#include <QThread>
+#include <QWaitCondition>
+
+#include "signingpool.h"
+
+namespace QOAuth {
+
+struct SigningTask
+{
+    SigningRequest request;
+    SignatureMethod signatureMethod;
+    ParsingMode mode;
+    QFutureInterface<SigningResult> result;
+};
+
+class SigningPoolPrivate;
+
+class SigningWorker : public QThread
+{
+public:
+    explicit SigningWorker( SigningPoolPrivate *pool );
+
+protected:
+    void run();
+
+private:
+    SigningPoolPrivate *pool;
+};
+
+// The queue is guarded by the mutex. Submitters wait on notFull when it's
+// at capacity, workers wait on notEmpty, and waitForDone() waits on idle
+// until the queue is empty and no task is being signed.
+class SigningPoolPrivate
+{
+public:
+    SigningPoolPrivate( const Signer &signer, int queueCapacity );
+
+    // returns false when the pool is being destroyed and the queue is empty
+    bool takeTask( SigningTask *task );
+    void taskDone();
+    void work();
+
+    const Signer signer;
+    const int queueCapacity;
+
+    QList<SigningWorker *> workers;
+
+    mutable QMutex mutex;
+    QWaitCondition notEmpty;
+    QWaitCondition notFull;
+    QWaitCondition idle;
+    QQueue<SigningTask> queue;
+    int activeCount;
+    bool stopping;
+};
+
+} // namespace QOAuth
+
+#endif // SIGNINGPOOL_P_H
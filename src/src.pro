@@ -40,15 +40,62 @@ RCC_DIR += ./$${BUILDDIR}
 PUBLIC_HEADERS += \
     qoauth_global.h \
     qoauth_namespace.h \
-    interface.h
+    deadline.h \
+    interface.h \
+    noncesource.h \
+    paramlist.h \
+    reply.h \
+    retrypolicy.h \
+    signer.h \
+    signingpool.h \
+    timestampsource.h \
+    tokencache.h \
+    transport.h
 
 PRIVATE_HEADERS += \
-    interface_p.h
+    base64_p.h \
+    bulkexchange_p.h \
+    cpufeatures_p.h \
+    hmackeycache_p.h \
+    interface_p.h \
+    noncesource_p.h \
+    percentencoding_p.h \
+    privatekeycache_p.h \
+    qcaruntime_p.h \
+    readertracker_p.h \
+    reply_p.h \
+    retrypolicy_p.h \
+    sha1_p.h \
+    signer_p.h \
+    signingpool_p.h \
+    timestampsource_p.h \
+    tokencache_p.h \
+    transport_p.h
 
 HEADERS = \
     $$PUBLIC_HEADERS \
     $$PRIVATE_HEADERS
-SOURCES += interface.cpp
+SOURCES += \
+    base64.cpp \
+    bulkexchange.cpp \
+    cpufeatures.cpp \
+    deadline.cpp \
+    hmackeycache.cpp \
+    interface.cpp \
+    noncesource.cpp \
+    paramlist.cpp \
+    percentencoding.cpp \
+    privatekeycache.cpp \
+    qcaruntime.cpp \
+    readertracker.cpp \
+    reply.cpp \
+    retrypolicy.cpp \
+    sha1.cpp \
+    signer.cpp \
+    signingpool.cpp \
+    timestampsource.cpp \
+    tokencache.cpp \
+    transport.cpp
 
 DEFINES += QOAUTH
 
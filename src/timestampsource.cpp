@@ -0,0 +1,158 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "timestampsource.h"
+#include "timestampsource_p.h"
+
+#include <time.h>
+
+/*!
+  \class QOAuth::TimestampSource timestampsource.h <QtOAuth/timestampsource.h>
+  \brief Provides the <em>oauth_timestamp</em> values for the signed requests.
+
+  Every call to QOAuth::Signer::sign() or QOAuth::Signer::signBatch() takes the timestamp
+  from the signer's timestamp source. The default source, returned by defaultSource(),
+  is a QOAuth::ClockTimestampSource without an offset.
+
+  Subclass TimestampSource to supply your own timestamps, e.g. fixed ones in tests,
+  and install it with QOAuth::Signer::setTimestampSource() or
+  QOAuth::Interface::setTimestampSource().
+*/
+
+/*!
+  \brief Destroys the timestamp source.
+*/
+
+QOAuth::TimestampSource::~TimestampSource()
+{
+}
+
+/*!
+  \fn QByteArray QOAuth::TimestampSource::timestamp()
+  \brief Returns the current timestamp, as a decimal number of seconds since the epoch.
+
+  The function is called from every thread that signs requests, possibly at the same time,
+  so it has to be thread-safe.
+*/
+
+/*!
+  \brief Returns the timestamp source used by the signers that didn't get a custom one.
+
+  The source is shared by the whole process, don't change its offset.
+  Create a separate QOAuth::ClockTimestampSource instead.
+*/
+
+QSharedPointer<QOAuth::TimestampSource> QOAuth::TimestampSource::defaultSource()
+{
+    static QSharedPointer<TimestampSource> source( new ClockTimestampSource );
+    return source;
+}
+
+
+/*!
+  \class QOAuth::ClockTimestampSource timestampsource.h <QtOAuth/timestampsource.h>
+  \brief Creates timestamps from the system clock, optionally corrected by an offset.
+
+  The clock is read with the cheapest call available (the coarse real-time clock on Linux),
+  as only the full seconds are used. Every thread keeps the last timestamp it formatted and
+  returns it again for as long as the second doesn't change, so most of the calls neither
+  format a number nor allocate memory, and no locks are taken.
+
+  When the clock of the Service Provider differs from the local one, and the Service
+  Provider rejects the requests because of that, set the difference with setOffset().
+*/
+
+/*!
+  \brief Creates a timestamp source adding \a offset seconds to the system clock.
+*/
+
+QOAuth::ClockTimestampSource::ClockTimestampSource( int offset ) :
+        d( new ClockTimestampSourcePrivate( offset ) )
+{
+}
+
+/*!
+  \brief Destroys the timestamp source.
+*/
+
+QOAuth::ClockTimestampSource::~ClockTimestampSource()
+{
+    delete d;
+}
+
+/*!
+  \brief Returns the number of seconds added to the system clock.
+
+  \sa setOffset()
+*/
+
+int QOAuth::ClockTimestampSource::offset() const
+{
+#if QT_VERSION >= 0x050000
+    return d->offset.load();
+#else
+    return d->offset;
+#endif
+}
+
+/*!
+  \brief Makes the source add \a seconds to the system clock.
+
+  A negative value moves the timestamps back. The offset can be changed
+  at any time, also while other threads are signing requests.
+*/
+
+void QOAuth::ClockTimestampSource::setOffset( int seconds )
+{
+    d->offset.fetchAndStoreOrdered( seconds );
+}
+
+QByteArray QOAuth::ClockTimestampSource::timestamp()
+{
+    TimestampCache *cache = d->caches.localData();
+    if ( !cache ) {
+        cache = new TimestampCache;
+        d->caches.setLocalData( cache );
+    }
+
+    qint64 seconds = currentTime() + offset();
+    if ( seconds != cache->seconds ) {
+        cache->seconds = seconds;
+        cache->text = QByteArray::number( seconds );
+    }
+
+    return cache->text;
+}
+
+/*!
+  \brief Returns the number of seconds since the epoch according to the system clock.
+*/
+
+qint64 QOAuth::ClockTimestampSource::currentTime()
+{
+#if defined(Q_OS_LINUX) && defined(CLOCK_REALTIME_COARSE)
+    struct timespec now;
+    if ( clock_gettime( CLOCK_REALTIME_COARSE, &now ) == 0 ) {
+        return now.tv_sec;
+    }
+#endif
+    return time( 0 );
+}
@@ -0,0 +1,71 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file timestampsource.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef TIMESTAMPSOURCE_H
+#define TIMESTAMPSOURCE_H
+
+#include <QByteArray>
+#include <QSharedPointer>
+
+#include "qoauth_global.h"
+
+namespace QOAuth {
+
+class ClockTimestampSourcePrivate;
+
+class QOAUTH_EXPORT TimestampSource
+{
+public:
+    virtual ~TimestampSource();
+
+    virtual QByteArray timestamp() = 0;
+
+    static QSharedPointer<TimestampSource> defaultSource();
+};
+
+class QOAUTH_EXPORT ClockTimestampSource : public TimestampSource
+{
+public:
+    explicit ClockTimestampSource( int offset = 0 );
+    ~ClockTimestampSource();
+
+    int offset() const;
+    void setOffset( int seconds );
+
+    QByteArray timestamp();
+
+    static qint64 currentTime();
+
+private:
+    Q_DISABLE_COPY(ClockTimestampSource)
+    ClockTimestampSourcePrivate * const d;
+};
+
+} // namespace QOAuth
+
+#endif // TIMESTAMPSOURCE_H
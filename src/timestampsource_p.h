@@ -0,0 +1,60 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file timestampsource_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef TIMESTAMPSOURCE_P_H
+#define TIMESTAMPSOURCE_P_H
+
+#include <QAtomicInt>
+#include <QThreadStorage>
+
+#include "timestampsource.h"
+
+namespace QOAuth {
+
+// The last timestamp formatted by a thread; it's reused for
+// as long as the clock (with the offset applied) shows the same second.
+struct TimestampCache
+{
+    TimestampCache() : seconds( -1 ) {}
+
+    qint64 seconds;
+    QByteArray text;
+};
+
+class ClockTimestampSourcePrivate
+{
+public:
+    explicit ClockTimestampSourcePrivate( int offset ) : offset( offset ) {}
+
+    QAtomicInt offset;
+    QThreadStorage<TimestampCache *> caches;
+};
+
+} // namespace QOAuth
+
+#endif // TIMESTAMPSOURCE_P_H
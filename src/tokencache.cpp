@@ -0,0 +1,504 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "tokencache.h"
+#include "tokencache_p.h"
+#include "deadline.h"
+
+#include <QMutexLocker>
+#include <QVector>
+#include <QPair>
+
+#include <algorithm>
+
+/*!
+  \class QOAuth::TokenCache tokencache.h <QtOAuth>
+  \brief This class keeps Access Tokens in memory, so they are not requested again.
+
+  Tokens are stored per Consumer Key, under a key chosen by the application, usually the
+  Request Token they were obtained with or the id of the user. When the cache is set on
+  a QOAuth::Interface with \ref QOAuth::Interface::setTokenCache(), Access Token requests
+  are first looked up in the cache, by the \ref QOAuth::Interface::consumerKey and
+  the Request Token, and the successful ones are stored in it.
+
+  Every token expires after its time to live. When the tokens take more memory than
+  \ref maxMemory(), the least recently used ones are evicted. Tokens can also be removed
+  explicitly, one by one with \ref remove(), or all the tokens of a Consumer Key
+  with \ref removeAll().
+
+  The cache can be shared by any number of interfaces and threads. Lookups with
+  \ref value() and \ref contains() never lock or wait, so checking the cache on every
+  request is cheap.
+
+  Modifications are serialized, and they are considerably slower than lookups: the index
+  of the cache is split into 16 parts by the hash of the keys, and a modification copies
+  the parts it changes, usually one, so it takes time linear in the number of tokens
+  divided by 16. It then waits for the lookups in progress to finish. Expired tokens are
+  only looked for once the earliest expiry has passed, and when the memory limit is
+  exceeded, all the tokens are ranked by their last use. The cache is meant for data read
+  far more often than it's written.
+
+  \sa QOAuth::Interface::setTokenCache()
+*/
+
+/*!
+  \var QOAuth::TokenCache::DefaultTimeToLive
+  \brief The default time to live of the tokens, in milliseconds (one hour).
+*/
+
+const qint64 QOAuth::TokenCache::DefaultTimeToLive = Q_INT64_C(3600000);
+
+// the rough cost of an entry and of a parameter in it, apart from the data
+static const qint64 EntryOverhead = 128;
+static const qint64 ParamOverhead = 64;
+
+
+QOAuth::TokenCachePrivate::Update::Update()
+{
+    for ( int i = 0; i < ShardCount; ++i ) {
+        tables[i] = 0;
+    }
+}
+
+QOAuth::TokenCachePrivate::TokenCachePrivate() :
+        clock( 0 ),
+        maxMemory( 0 ),
+        timeToLive( 0 ),
+        memory( 0 ),
+        nextExpiry( -1 )
+{
+    for ( int i = 0; i < ShardCount; ++i ) {
+        tables[i].fetchAndStoreOrdered( new Table );
+    }
+}
+
+QOAuth::TokenCachePrivate::~TokenCachePrivate()
+{
+    for ( int i = 0; i < ShardCount; ++i ) {
+        Table *current = currentTable( i );
+        qDeleteAll( *current );
+        delete current;
+    }
+}
+
+QByteArray QOAuth::TokenCachePrivate::cacheKey( const QByteArray &consumerKey, const QByteArray &key )
+{
+    // the length keeps the pairs of keys apart
+    return QByteArray::number( consumerKey.size() ) + ':' + consumerKey + key;
+}
+
+qint64 QOAuth::TokenCachePrivate::entrySize( const QByteArray &cacheKey, const ParamMap &token )
+{
+    qint64 size = EntryOverhead + 2 * cacheKey.size();
+    for ( ParamMap::const_iterator it = token.constBegin(); it != token.constEnd(); ++it ) {
+        size += ParamOverhead + it.key().size() + it.value().size();
+    }
+    return size;
+}
+
+int QOAuth::TokenCachePrivate::shardOf( const QByteArray &cacheKey )
+{
+    return int( qHash( cacheKey ) % ShardCount );
+}
+
+QOAuth::TokenCachePrivate::Table *QOAuth::TokenCachePrivate::table( const Update &update, int shard ) const
+{
+    return update.tables[shard] ? update.tables[shard] : currentTable( shard );
+}
+
+QOAuth::TokenCachePrivate::Table *QOAuth::TokenCachePrivate::writableTable( Update *update, int shard )
+{
+    if ( !update->tables[shard] ) {
+        update->tables[shard] = new Table( *currentTable( shard ) );
+    }
+    return update->tables[shard];
+}
+
+void QOAuth::TokenCachePrivate::take( Update *update, int shard, const QByteArray &cacheKey )
+{
+    Entry *entry = writableTable( update, shard )->take( cacheKey );
+    memory -= entry->size;
+    update->removed.append( entry );
+}
+
+void QOAuth::TokenCachePrivate::removeExpired( Update *update )
+{
+    qint64 now = Deadline::currentTime();
+    if ( nextExpiry < 0 || nextExpiry > now ) {
+        return;
+    }
+
+    // the shards are only read until an expired entry is found in them
+    nextExpiry = -1;
+    for ( int shard = 0; shard < ShardCount; ++shard ) {
+        QList<QByteArray> expired;
+        const Table *current = table( *update, shard );
+        for ( Table::const_iterator it = current->constBegin(); it != current->constEnd(); ++it ) {
+            qint64 expiry = it.value()->expiry;
+            if ( expiry >= 0 && expiry <= now ) {
+                expired.append( it.key() );
+            } else if ( expiry >= 0 && ( nextExpiry < 0 || expiry < nextExpiry ) ) {
+                nextExpiry = expiry;
+            }
+        }
+        Q_FOREACH ( const QByteArray &cacheKey, expired ) {
+            take( update, shard, cacheKey );
+        }
+    }
+}
+
+void QOAuth::TokenCachePrivate::evict( Update *update )
+{
+    if ( maxMemory <= 0 || memory <= maxMemory ) {
+        return;
+    }
+
+    // the age is counted back from the current clock, so that the wrapping
+    // of the clock doesn't matter
+    uint now = uint( ReaderTracker::loadRelaxed( clock ) );
+    QVector< QPair<uint, QByteArray> > ages;
+    for ( int shard = 0; shard < ShardCount; ++shard ) {
+        const Table *current = table( *update, shard );
+        for ( Table::const_iterator it = current->constBegin(); it != current->constEnd(); ++it ) {
+            uint lastUsed = uint( ReaderTracker::loadRelaxed( it.value()->lastUsed ) );
+            ages.append( qMakePair( now - lastUsed, it.key() ) );
+        }
+    }
+
+    // usually only a few entries go, so they are popped off a heap with
+    // the oldest on top rather than sorted along with all the others
+    QPair<uint, QByteArray> *begin = ages.data();
+    QPair<uint, QByteArray> *end = begin + ages.size();
+    std::make_heap( begin, end );
+    while ( begin != end && memory > maxMemory ) {
+        std::pop_heap( begin, end );
+        --end;
+        take( update, shardOf( end->second ), end->second );
+    }
+}
+
+void QOAuth::TokenCachePrivate::publish( Update *update )
+{
+    QList<Table *> old;
+    for ( int shard = 0; shard < ShardCount; ++shard ) {
+        if ( update->tables[shard] ) {
+            old.append( tables[shard].fetchAndStoreOrdered( update->tables[shard] ) );
+        }
+    }
+    if ( old.isEmpty() ) {
+        return;
+    }
+
+    tracker.synchronize();
+
+    // the entries still in use are shared with the new tables
+    qDeleteAll( old );
+    qDeleteAll( update->removed );
+}
+
+
+/*!
+  \brief Creates an empty cache that holds up to \a maxMemory bytes of tokens, each
+         for \a timeToLive milliseconds.
+
+  \sa setMaxMemory(), setTimeToLive()
+*/
+
+QOAuth::TokenCache::TokenCache( qint64 maxMemory, qint64 timeToLive ) :
+        d( new TokenCachePrivate )
+{
+    d->maxMemory = qMax( maxMemory, Q_INT64_C(0) );
+    d->timeToLive = qMax( timeToLive, Q_INT64_C(0) );
+}
+
+/*!
+  \brief Destroys the cache.
+
+  The cache must not be used by other threads anymore.
+*/
+
+QOAuth::TokenCache::~TokenCache()
+{
+    delete d;
+}
+
+/*!
+  \brief Returns the largest amount of memory, in bytes, taken by the tokens.
+
+  \sa setMaxMemory()
+*/
+
+qint64 QOAuth::TokenCache::maxMemory() const
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    return d->maxMemory;
+}
+
+/*!
+  \brief Limits the memory taken by the tokens to \a bytes.
+
+  The size of a token is estimated from the size of its parameters and keys. When
+  the limit is exceeded, the least recently used tokens are evicted. \c 0 means no limit.
+*/
+
+void QOAuth::TokenCache::setMaxMemory( qint64 bytes )
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    d->maxMemory = qMax( bytes, Q_INT64_C(0) );
+    if ( d->maxMemory > 0 && d->memory > d->maxMemory ) {
+        TokenCachePrivate::Update update;
+        d->removeExpired( &update );
+        d->evict( &update );
+        d->publish( &update );
+    }
+}
+
+/*!
+  \brief Returns the time to live, in milliseconds, of the tokens inserted into the cache.
+
+  \sa setTimeToLive()
+*/
+
+qint64 QOAuth::TokenCache::timeToLive() const
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    return d->timeToLive;
+}
+
+/*!
+  \brief Sets the time to live of the tokens inserted from now on to \a msecs milliseconds.
+
+  \c 0 means that the tokens don't expire. The tokens already in the cache keep
+  their expiry times.
+*/
+
+void QOAuth::TokenCache::setTimeToLive( qint64 msecs )
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    d->timeToLive = qMax( msecs, Q_INT64_C(0) );
+}
+
+/*!
+  \brief Returns the token stored for \a consumerKey under \a key.
+
+  An empty map is returned if there's no such token or it has expired.
+  This method never locks.
+*/
+
+QOAuth::ParamMap QOAuth::TokenCache::value( const QByteArray &consumerKey, const QByteArray &key ) const
+{
+    QByteArray cacheKey = TokenCachePrivate::cacheKey( consumerKey, key );
+    ReadGuard guard( &d->tracker );
+
+    TokenCachePrivate::Entry *entry = d->currentTable( TokenCachePrivate::shardOf( cacheKey ) )->value( cacheKey, 0 );
+    if ( !entry || ( entry->expiry >= 0 && entry->expiry <= Deadline::currentTime() ) ) {
+        d->missCount.local()->fetchAndAddRelaxed( 1 );
+        return ParamMap();
+    }
+
+    // the entry is written to only on its first use since the last insertion
+    int now = ReaderTracker::loadRelaxed( d->clock );
+    if ( ReaderTracker::loadRelaxed( entry->lastUsed ) != now ) {
+        entry->lastUsed.fetchAndStoreRelaxed( now );
+    }
+    d->hitCount.local()->fetchAndAddRelaxed( 1 );
+    return entry->token;
+}
+
+/*!
+  \brief Returns true if a token that hasn't expired is stored for \a consumerKey under \a key.
+
+  Like value(), this method never locks, but it doesn't count as a use of the token.
+*/
+
+bool QOAuth::TokenCache::contains( const QByteArray &consumerKey, const QByteArray &key ) const
+{
+    QByteArray cacheKey = TokenCachePrivate::cacheKey( consumerKey, key );
+    ReadGuard guard( &d->tracker );
+
+    TokenCachePrivate::Entry *entry = d->currentTable( TokenCachePrivate::shardOf( cacheKey ) )->value( cacheKey, 0 );
+    return entry && ( entry->expiry < 0 || entry->expiry > Deadline::currentTime() );
+}
+
+/*!
+  \brief Stores the \a token for \a consumerKey under \a key, replacing the previous one.
+
+  The token expires after \a timeToLive milliseconds, or after the \ref timeToLive()
+  of the cache if \a timeToLive is negative. \c 0 means that it doesn't expire.
+  Empty tokens are not stored.
+*/
+
+void QOAuth::TokenCache::insert( const QByteArray &consumerKey, const QByteArray &key,
+                                 const ParamMap &token, qint64 timeToLive )
+{
+    if ( token.isEmpty() ) {
+        return;
+    }
+
+    QByteArray cacheKey = TokenCachePrivate::cacheKey( consumerKey, key );
+
+    TokenCachePrivate::Entry *entry = new TokenCachePrivate::Entry;
+    entry->token = token;
+    entry->consumerKey = consumerKey;
+    entry->size = TokenCachePrivate::entrySize( cacheKey, token );
+    // the tick after the entry is the one of the lookups following its insertion
+    entry->lastUsed.fetchAndStoreRelaxed( d->clock.fetchAndAddRelaxed( 2 ) + 1 );
+
+    QMutexLocker locker( &d->writeMutex );
+
+    qint64 lifetime = timeToLive < 0 ? d->timeToLive : timeToLive;
+    entry->expiry = lifetime > 0 ? Deadline::currentTime() + lifetime : -1;
+
+    TokenCachePrivate::Update update;
+    int shard = TokenCachePrivate::shardOf( cacheKey );
+    if ( d->currentTable( shard )->contains( cacheKey ) ) {
+        d->take( &update, shard, cacheKey );
+    }
+    d->writableTable( &update, shard )->insert( cacheKey, entry );
+    d->memory += entry->size;
+    if ( entry->expiry >= 0 && ( d->nextExpiry < 0 || entry->expiry < d->nextExpiry ) ) {
+        d->nextExpiry = entry->expiry;
+    }
+
+    d->removeExpired( &update );
+    d->evict( &update );
+    d->publish( &update );
+}
+
+/*!
+  \brief Removes the token stored for \a consumerKey under \a key.
+
+  Returns true if there was such a token.
+*/
+
+bool QOAuth::TokenCache::remove( const QByteArray &consumerKey, const QByteArray &key )
+{
+    QByteArray cacheKey = TokenCachePrivate::cacheKey( consumerKey, key );
+
+    QMutexLocker locker( &d->writeMutex );
+
+    int shard = TokenCachePrivate::shardOf( cacheKey );
+    if ( !d->currentTable( shard )->contains( cacheKey ) ) {
+        return false;
+    }
+
+    TokenCachePrivate::Update update;
+    d->take( &update, shard, cacheKey );
+    d->publish( &update );
+
+    return true;
+}
+
+/*!
+  \brief Removes all the tokens stored for \a consumerKey, e.g. when its credentials
+         are revoked, and returns their number.
+*/
+
+int QOAuth::TokenCache::removeAll( const QByteArray &consumerKey )
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    // only the shards holding tokens of the consumer key are copied
+    TokenCachePrivate::Update update;
+    for ( int shard = 0; shard < TokenCachePrivate::ShardCount; ++shard ) {
+        QList<QByteArray> found;
+        const TokenCachePrivate::Table *table = d->currentTable( shard );
+        for ( TokenCachePrivate::Table::const_iterator it = table->constBegin(); it != table->constEnd(); ++it ) {
+            if ( it.value()->consumerKey == consumerKey ) {
+                found.append( it.key() );
+            }
+        }
+        Q_FOREACH ( const QByteArray &cacheKey, found ) {
+            d->take( &update, shard, cacheKey );
+        }
+    }
+
+    d->publish( &update );
+    return update.removed.size();
+}
+
+/*!
+  \brief Removes all the tokens.
+*/
+
+void QOAuth::TokenCache::clear()
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    TokenCachePrivate::Update update;
+    for ( int shard = 0; shard < TokenCachePrivate::ShardCount; ++shard ) {
+        update.tables[shard] = new TokenCachePrivate::Table;
+        update.removed += d->currentTable( shard )->values();
+    }
+    d->memory = 0;
+    d->nextExpiry = -1;
+    d->publish( &update );
+}
+
+/*!
+  \brief Returns the number of tokens in the cache.
+
+  Expired tokens are counted until a later insertion removes them.
+*/
+
+int QOAuth::TokenCache::count() const
+{
+    ReadGuard guard( &d->tracker );
+
+    int count = 0;
+    for ( int shard = 0; shard < TokenCachePrivate::ShardCount; ++shard ) {
+        count += d->currentTable( shard )->size();
+    }
+    return count;
+}
+
+/*!
+  \brief Returns the estimated amount of memory, in bytes, taken by the tokens.
+*/
+
+qint64 QOAuth::TokenCache::memoryUsage() const
+{
+    QMutexLocker locker( &d->writeMutex );
+
+    return d->memory;
+}
+
+/*!
+  \brief Returns the number of lookups with value() that found a token.
+*/
+
+int QOAuth::TokenCache::hits() const
+{
+    return d->hitCount.sum();
+}
+
+/*!
+  \brief Returns the number of lookups with value() that found no token.
+*/
+
+int QOAuth::TokenCache::misses() const
+{
+    return d->missCount.sum();
+}
@@ -0,0 +1,80 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file tokencache.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef TOKENCACHE_H
+#define TOKENCACHE_H
+
+#include <QByteArray>
+
+#include "qoauth_global.h"
+#include "qoauth_namespace.h"
+
+namespace QOAuth {
+
+class TokenCachePrivate;
+
+class QOAUTH_EXPORT TokenCache
+{
+public:
+    enum {
+        DefaultMaxMemory = 4 * 1024 * 1024
+    };
+
+    static const qint64 DefaultTimeToLive;
+
+    explicit TokenCache( qint64 maxMemory = DefaultMaxMemory, qint64 timeToLive = DefaultTimeToLive );
+    ~TokenCache();
+
+    qint64 maxMemory() const;
+    void setMaxMemory( qint64 bytes );
+
+    qint64 timeToLive() const;
+    void setTimeToLive( qint64 msecs );
+
+    ParamMap value( const QByteArray &consumerKey, const QByteArray &key ) const;
+    bool contains( const QByteArray &consumerKey, const QByteArray &key ) const;
+
+    void insert( const QByteArray &consumerKey, const QByteArray &key, const ParamMap &token,
+                 qint64 timeToLive = -1 );
+    bool remove( const QByteArray &consumerKey, const QByteArray &key );
+    int removeAll( const QByteArray &consumerKey );
+    void clear();
+
+    int count() const;
+    qint64 memoryUsage() const;
+    int hits() const;
+    int misses() const;
+
+private:
+    Q_DISABLE_COPY(TokenCache)
+    TokenCachePrivate * const d;
+};
+
+} // namespace QOAuth
+
+#endif // TOKENCACHE_H
@@ -0,0 +1,130 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file tokencache_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef TOKENCACHE_P_H
+#define TOKENCACHE_P_H
+
+#include "tokencache.h"
+#include "readertracker_p.h"
+#include <QHash>
+#include <QList>
+#include <QMutex>
+#include <QAtomicInt>
+#include <QAtomicPointer>
+
+namespace QOAuth {
+
+// The cache is split into shards by the hash of the key. Each shard is a hash
+// table that is never modified once published. Writers, serialized with a mutex,
+// copy the tables of the shards they change, change the copies and swap the
+// pointers; the previous tables and the entries they alone refer to are freed
+// once all the readers that could have seen them are gone (see ReaderTracker).
+// Readers thus never wait, and a write pays for a copy of the shards it changes,
+// usually the one of its key.
+//
+// The rest of a write is kept off the common path: expired entries are looked
+// for only once the earliest expiry has passed, and when the memory limit is
+// exceeded, the least recently used entries are picked out of a heap instead
+// of sorting all of them by age.
+//
+// Lookups write to no data other threads use, apart from the last use of the
+// entry found. The clock that dates the uses only moves on insertions, so the
+// uses in between count as simultaneous, and a lookup writes to the entry only
+// if it wasn't used since the last insertion.
+class TokenCachePrivate
+{
+public:
+    enum { ShardCount = 16 };
+
+    // entries are immutable, apart from the time of the last use
+    struct Entry
+    {
+        ParamMap token;
+        QByteArray consumerKey;
+        // the deadline, or -1 for no expiry
+        qint64 expiry;
+        qint64 size;
+        // the value of the clock at the last use, for LRU eviction
+        QAtomicInt lastUsed;
+    };
+
+    typedef QHash<QByteArray, Entry *> Table;
+
+    // the changes of a write: copies of the tables of the shards it changes
+    // (null for the others), and the entries taken out of them
+    struct Update
+    {
+        Update();
+
+        Table *tables[ShardCount];
+        QList<Entry *> removed;
+    };
+
+    TokenCachePrivate();
+    ~TokenCachePrivate();
+
+    static QByteArray cacheKey( const QByteArray &consumerKey, const QByteArray &key );
+    static qint64 entrySize( const QByteArray &cacheKey, const ParamMap &token );
+    static int shardOf( const QByteArray &cacheKey );
+
+    // the current table of a shard; valid while a ReadGuard exists, or with
+    // the write mutex held
+    inline Table *currentTable( int shard ) const { return ReaderTracker::loadAcquire( tables[shard] ); }
+
+    // the following are called with the write mutex held
+
+    // the table of the shard as changed by the update so far
+    Table *table( const Update &update, int shard ) const;
+    // the copy of the table of the shard, made on the first change
+    Table *writableTable( Update *update, int shard );
+    // takes the entry out of the copy of its table, to be freed by publish()
+    void take( Update *update, int shard, const QByteArray &cacheKey );
+    void removeExpired( Update *update );
+    void evict( Update *update );
+    // replaces the changed tables, waits for the readers of the old ones
+    // and frees them along with the removed entries
+    void publish( Update *update );
+
+    ReaderTracker tracker;
+    QAtomicPointer<Table> tables[ShardCount];
+    // advanced by the insertions only
+    QAtomicInt clock;
+    StripedCounter hitCount;
+    StripedCounter missCount;
+
+    QMutex writeMutex;
+    qint64 maxMemory;
+    qint64 timeToLive;
+    qint64 memory;
+    // the earliest expiry in the cache, or -1 if nothing expires
+    qint64 nextExpiry;
+};
+
+} // namespace QOAuth
+
+#endif // TOKENCACHE_P_H
@@ -0,0 +1,242 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+#include "transport.h"
+#include "transport_p.h"
+
+#include <QCoreApplication>
+#include <QMutexLocker>
+#include <QNetworkReply>
+#include <QNetworkRequest>
+#include <QThread>
+#include <QThreadStorage>
+#include <QUrl>
+
+Q_GLOBAL_STATIC(QOAuth::TransportPrivate, transportPrivate)
+Q_GLOBAL_STATIC(QThreadStorage<QOAuth::ThreadTransport *>, threadTransports)
+
+
+QOAuth::ThreadTransport::ThreadTransport() :
+        manager( new QNetworkAccessManager )
+{
+    QCoreApplication *application = QCoreApplication::instance();
+    if ( application && application->thread() == QThread::currentThread() ) {
+        manager->setParent( application );
+    }
+}
+
+QOAuth::ThreadTransport::~ThreadTransport()
+{
+    // null if the application already deleted it
+    delete manager.data();
+}
+
+
+void QOAuth::TransportPrivate::prepareRequest( QNetworkRequest *request )
+{
+#if QT_VERSION >= 0x060000
+    // HTTP/2 is allowed by default
+    Q_UNUSED(request);
+#elif QT_VERSION >= 0x050F00
+    request->setAttribute( QNetworkRequest::Http2AllowedAttribute, true );
+#elif QT_VERSION >= 0x050800
+    request->setAttribute( QNetworkRequest::HTTP2AllowedAttribute, true );
+#else
+    Q_UNUSED(request);
+#endif
+}
+
+bool QOAuth::TransportPrivate::http2WasUsed( QNetworkReply *reply )
+{
+#if QT_VERSION >= 0x050F00
+    return reply->attribute( QNetworkRequest::Http2WasUsedAttribute ).toBool();
+#elif QT_VERSION >= 0x050900
+    return reply->attribute( QNetworkRequest::HTTP2WasUsedAttribute ).toBool();
+#else
+    Q_UNUSED(reply);
+    return false;
+#endif
+}
+
+void QOAuth::TransportPrivate::requestStarted( const QString &host )
+{
+    TransportPrivate *d = transportPrivate();
+    QMutexLocker locker( &d->mutex );
+
+    HostRequestStatistics &statistics = d->statistics[host];
+    ++statistics.requests;
+    ++statistics.activeRequests;
+}
+
+void QOAuth::TransportPrivate::requestFinished( const QString &host, bool failed, bool http2, qint64 msecs )
+{
+    TransportPrivate *d = transportPrivate();
+    QMutexLocker locker( &d->mutex );
+
+    HostRequestStatistics &statistics = d->statistics[host];
+    --statistics.activeRequests;
+    if ( failed ) {
+        ++statistics.failedRequests;
+    }
+    if ( http2 ) {
+        ++statistics.http2Requests;
+    }
+    statistics.totalTime += msecs;
+}
+
+
+/*!
+  \struct QOAuth::HostRequestStatistics transport.h <QtOAuth/transport.h>
+  \brief Statistics of the token requests sent to a single host.
+
+  \li \c requests - the number of requests started
+  \li \c activeRequests - the number of requests in progress
+  \li \c failedRequests - the number of requests that finished with an error
+  \li \c http2Requests - the number of replies received over HTTP/2, i.e. multiplexed
+      on a single connection
+  \li \c totalTime - the time spent by all the finished requests, in milliseconds
+
+  QNetworkAccessManager doesn't expose its connections, so these are counts of requests,
+  not of connections; many requests usually share a connection.
+
+  \sa QOAuth::Transport::requestStatistics()
+*/
+
+/*!
+  \brief Creates empty statistics.
+*/
+
+QOAuth::HostRequestStatistics::HostRequestStatistics() :
+        requests( 0 ),
+        activeRequests( 0 ),
+        failedRequests( 0 ),
+        http2Requests( 0 ),
+        totalTime( 0 )
+{
+}
+
+
+/*!
+  \class QOAuth::Transport transport.h <QtOAuth/transport.h>
+  \brief The network layer shared by the QOAuth::Interface objects.
+
+  An interface that wasn't given its own QNetworkAccessManager sends its requests with
+  the manager returned by networkAccessManager(), which is shared by all such interfaces
+  living in the same thread. Since QNetworkAccessManager keeps the connections open
+  and reuses them for subsequent requests to the same host, token exchanges of many
+  users against a single Service Provider share a few connections instead of setting
+  up new ones for every interface. With Qt 5.8 or newer the requests also allow
+  HTTP/2, so that the requests to a provider supporting it are multiplexed
+  on a single connection.
+
+  \note Settings applied to the shared manager, such as a proxy, a cookie jar or a cache,
+  affect all the interfaces using it. An interface that needs its own settings has to be
+  given a manager of its own with \ref QOAuth::Interface::setNetworkAccessManager().
+
+  Statistics of the requests are collected per host (see hostKey()), for all the
+  interfaces in the process, including the ones using their own managers.
+*/
+
+/*!
+  \brief Returns the network access manager shared by the interfaces of the calling thread.
+
+  The manager is created on the first call in the thread, and it's deleted when
+  the thread finishes (or with the application object, for the application's thread).
+  Any change made to it affects all the interfaces sharing it.
+*/
+
+QNetworkAccessManager *QOAuth::Transport::networkAccessManager()
+{
+    QThreadStorage<ThreadTransport *> *transports = threadTransports();
+
+    ThreadTransport *transport = transports->localData();
+    if ( !transport ) {
+        transport = new ThreadTransport;
+        transports->setLocalData( transport );
+    } else if ( !transport->manager ) {
+        // deleted together with the application; a new one is needed for the next one
+        transport->manager = new QNetworkAccessManager;
+    }
+
+    return transport->manager;
+}
+
+/*!
+  \brief Returns the hosts that the requests were sent to, in the form returned by hostKey().
+*/
+
+QStringList QOAuth::Transport::hosts()
+{
+    TransportPrivate *d = transportPrivate();
+    QMutexLocker locker( &d->mutex );
+
+    return d->statistics.keys();
+}
+
+/*!
+  \brief Returns the statistics of the requests sent to \a host.
+
+  \sa hostKey()
+*/
+
+QOAuth::HostRequestStatistics QOAuth::Transport::requestStatistics( const QString &host )
+{
+    TransportPrivate *d = transportPrivate();
+    QMutexLocker locker( &d->mutex );
+
+    return d->statistics.value( host );
+}
+
+/*!
+  \brief Clears the statistics of all the hosts.
+
+  The requests in progress are still counted as active.
+*/
+
+void QOAuth::Transport::resetRequestStatistics()
+{
+    TransportPrivate *d = transportPrivate();
+    QMutexLocker locker( &d->mutex );
+
+    QHash<QString, HostRequestStatistics>::iterator i = d->statistics.begin();
+    while ( i != d->statistics.end() ) {
+        if ( i.value().activeRequests == 0 ) {
+            i = d->statistics.erase( i );
+        } else {
+            int active = i.value().activeRequests;
+            i.value() = HostRequestStatistics();
+            i.value().activeRequests = active;
+            ++i;
+        }
+    }
+}
+
+/*!
+  \brief Returns the key of the statistics of the requests sent to \a url:
+  the scheme, the host and the port, e.g. <tt>https://api.example.com:443</tt>.
+*/
+
+QString QOAuth::Transport::hostKey( const QUrl &url )
+{
+    int defaultPort = ( url.scheme().compare( QLatin1String( "https" ), Qt::CaseInsensitive ) == 0 ) ? 443 : 80;
+    return url.scheme().toLower() + QLatin1String( "://" ) + url.host().toLower() +
+           QLatin1Char( ':' ) + QString::number( url.port( defaultPort ) );
+}
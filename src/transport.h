@@ -0,0 +1,69 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file transport.h
+
+  This file is a part of libqoauth. You should not include it directly in your
+  application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <QStringList>
+
+#include "qoauth_global.h"
+
+class QNetworkAccessManager;
+class QUrl;
+
+namespace QOAuth {
+
+struct QOAUTH_EXPORT HostRequestStatistics
+{
+    HostRequestStatistics();
+
+    int requests;
+    int activeRequests;
+    int failedRequests;
+    int http2Requests;
+    qint64 totalTime;
+};
+
+class QOAUTH_EXPORT Transport
+{
+public:
+    static QNetworkAccessManager *networkAccessManager();
+
+    static QStringList hosts();
+    static HostRequestStatistics requestStatistics( const QString &host );
+    static void resetRequestStatistics();
+
+    static QString hostKey( const QUrl &url );
+
+private:
+    Transport();
+};
+
+} // namespace QOAuth
+
+#endif // TRANSPORT_H
@@ -0,0 +1,72 @@
+/***************************************************************************
+ *   Copyright (C) 2009 by Dominik Kapusta       <d@ayoy.net>              *
+ *                                                                         *
+ *   This library is free software; you can redistribute it and/or modify  *
+ *   it under the terms of the GNU Lesser General Public License as        *
+ *   published by the Free Software Foundation; either version 2.1 of      *
+ *   the License, or (at your option) any later version.                   *
+ *                                                                         *
+ *   This library is distributed in the hope that it will be useful,       *
+ *   but WITHOUT ANY WARRANTY; without even the implied warranty of        *
+ *   MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU     *
+ *   Lesser General Public License for more details.                       *
+ *                                                                         *
+ *   You should have received a copy of the GNU Lesser General Public      *
+ *   License along with this library; if not, write to                     *
+ *   the Free Software Foundation, Inc.,                                   *
+ *   51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA          *
+ ***************************************************************************/
+
+
+
+/*!
+  \file transport_p.h
+
+  This file is a part of libqoauth and is considered strictly internal. You should not
+  include it in your application. Instead please use <tt>\#include &lt;QtOAuth&gt;</tt>.
+*/
+
+#ifndef TRANSPORT_P_H
+#define TRANSPORT_P_H
+
+#include <QHash>
+#include <QMutex>
+#include <QPointer>
+#include <QNetworkAccessManager>
+
+#include "transport.h"
+
+class QNetworkReply;
+class QNetworkRequest;
+
+namespace QOAuth {
+
+// The network access manager shared by the interfaces of one thread.
+// The one of the application's main thread belongs to the application
+// object, so that it's gone before the application is.
+struct ThreadTransport
+{
+    ThreadTransport();
+    ~ThreadTransport();
+
+    QPointer<QNetworkAccessManager> manager;
+};
+
+class TransportPrivate
+{
+public:
+    // sets the attributes of the token requests: HTTP/2 is allowed
+    // where Qt supports it
+    static void prepareRequest( QNetworkRequest *request );
+    static bool http2WasUsed( QNetworkReply *reply );
+
+    static void requestStarted( const QString &host );
+    static void requestFinished( const QString &host, bool failed, bool http2, qint64 msecs );
+
+    QMutex mutex;
+    QHash<QString, HostRequestStatistics> statistics;
+};
+
+} // namespace QOAuth
+
+#endif // TRANSPORT_P_H
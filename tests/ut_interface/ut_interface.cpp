@@ -22,9 +22,174 @@
 
 #include <QtDebug>
 #include <QTest>
+#include <QSignalSpy>
+#include <QCoreApplication>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSet>
+#include <QDateTime>
+#include <QFile>
+#include <QTemporaryFile>
+#include <QEventLoop>
+#include <QTimer>
+#include <QUrl>
+#include <QTcpSocket>
+#include <QElapsedTimer>
+#include <QSemaphore>
 
 #include <QtOAuth>
 #include <interface_p.h>
+#include <hmackeycache_p.h>
+#include <sha1_p.h>
+#include <signer_p.h>
+#include <percentencoding_p.h>
+#include <base64_p.h>
+#include <noncesource_p.h>
+#include <privatekeycache_p.h>
+
+
+TokenServer::TokenServer( int batchSize, int delay, QObject *parent ) :
+    QTcpServer( parent ),
+    answered( 0 ),
+    maxPending( 0 ),
+    padding( 0 ),
+    stalls( 0 ),
+    failures( 0 ),
+    consumeTokens( false ),
+    batchSize( batchSize ),
+    delay( delay )
+{
+    connect( this, SIGNAL(newConnection()), SLOT(acceptConnections()) );
+}
+
+void TokenServer::acceptConnections()
+{
+    while ( hasPendingConnections() ) {
+        QTcpSocket *socket = nextPendingConnection();
+        connect( socket, SIGNAL(readyRead()), SLOT(readRequest()) );
+        connect( socket, SIGNAL(disconnected()), socket, SLOT(deleteLater()) );
+    }
+}
+
+static QByteArray headerParameter( const QByteArray &header, const QByteArray &name )
+{
+    int start = header.indexOf( name + "=\"" );
+    if ( start < 0 ) {
+        return QByteArray();
+    }
+    start += name.size() + 2;
+    return header.mid( start, header.indexOf( '"', start ) - start );
+}
+
+void TokenServer::readRequest()
+{
+    QTcpSocket *socket = qobject_cast<QTcpSocket *>( sender() );
+    QByteArray &buffer = buffers[socket];
+    buffer.append( socket->readAll() );
+
+    // the requests are GETs, with no body
+    int end = buffer.indexOf( "\r\n\r\n" );
+    if ( end < 0 ) {
+        return;
+    }
+
+    QByteArray token = headerParameter( buffer.left( end ), "oauth_token" );
+    nonces.append( headerParameter( buffer.left( end ), "oauth_nonce" ) );
+    consumerKeys.append( headerParameter( buffer.left( end ), "oauth_consumer_key" ) );
+    buffer.remove( 0, end + 4 );
+
+    if ( nonces.size() <= stalls ) {
+        return;
+    }
+    if ( nonces.size() <= stalls + failures ) {
+        socket->write( "HTTP/1.1 503 Service Unavailable\r\n"
+                       "Content-Length: 0\r\n"
+                       "Connection: keep-alive\r\n"
+                       "\r\n" );
+        ++answered;
+        return;
+    }
+
+    if ( consumeTokens && receivedTokens.contains( token ) ) {
+        answer( socket, "bad" );
+        return;
+    }
+    receivedTokens.insert( token );
+
+    pending.append( qMakePair( socket, token ) );
+    maxPending = qMax( maxPending, pending.size() );
+
+    if ( delay > 0 ) {
+        if ( pending.size() == 1 ) {
+            QTimer::singleShot( delay, this, SLOT(answerPending()) );
+        }
+        return;
+    }
+
+    if ( pending.size() >= batchSize ) {
+        answerPending();
+    }
+}
+
+void TokenServer::answerPending()
+{
+    while ( !pending.isEmpty() ) {
+        QPair<QTcpSocket *, QByteArray> request = pending.takeLast();
+        answer( request.first, request.second );
+    }
+}
+
+void TokenServer::answer( QTcpSocket *socket, const QByteArray &token )
+{
+    // tokens named "bad..." are refused
+    if ( token.startsWith( "bad" ) ) {
+        socket->write( "HTTP/1.1 401 Unauthorized\r\n"
+                       "Content-Length: 0\r\n"
+                       "Connection: keep-alive\r\n"
+                       "\r\n" );
+        ++answered;
+        return;
+    }
+
+    QByteArray body = "oauth_token=" + token + "-access&oauth_token_secret=" + token + "-secret";
+    if ( padding > 0 ) {
+        body += "&padding=" + QByteArray( padding, 'x' );
+    }
+    socket->write( "HTTP/1.1 200 OK\r\n"
+                   "Content-Type: application/x-www-form-urlencoded\r\n"
+                   "Content-Length: " + QByteArray::number( body.size() ) + "\r\n"
+                   "Connection: keep-alive\r\n"
+                   "\r\n" + body );
+    ++answered;
+}
+
+
+class SignerRunnable : public QRunnable
+{
+public:
+    SignerRunnable( const QOAuth::Signer &signer, int iterations, QAtomicInt *failures ) :
+        m_signer( signer ), m_iterations( iterations ), m_failures( failures ) {}
+
+    void run()
+    {
+        for ( int i = 0; i < m_iterations; ++i ) {
+            int error;
+            QByteArray token = "token" + QByteArray::number( i );
+            QByteArray result = m_signer.sign( "http://example.com/resource", QOAuth::GET,
+                                               token, "tokensecret", QOAuth::HMAC_SHA1,
+                                               QOAuth::ParamMap(), QOAuth::ParseForHeaderArguments,
+                                               &error );
+            if ( error != QOAuth::NoError || !result.contains( "oauth_token=\"" + token + "\"" ) ) {
+                m_failures->ref();
+            }
+        }
+    }
+
+private:
+    QOAuth::Signer m_signer;
+    int m_iterations;
+    QAtomicInt *m_failures;
+};
 
 
 void QOAuth::Ut_Interface::init()
@@ -47,6 +212,460 @@ void QOAuth::Ut_Interface::constructor()
     QVERIFY( m->d_ptr );
 }
 
+void QOAuth::Ut_Interface::constructorBenchmark()
+{
+    // QCA is initialized once, not by every interface
+    QBENCHMARK {
+        Interface interface;
+        Signer signer( "135432", "654316" );
+    }
+}
+
+void QOAuth::Ut_Interface::networkAccessManager()
+{
+    // signing doesn't need any network objects
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+    QVERIFY( !m->createParametersString( "http://example.com", GET, "token", "secret", HMAC_SHA1,
+                                         ParamMap(), ParseForHeaderArguments ).isEmpty() );
+    QVERIFY( m->d_ptr->manager.isNull() );
+
+    // the interfaces of a thread share a manager
+    QNetworkAccessManager *manager = m->networkAccessManager();
+    QVERIFY( manager );
+    QCOMPARE( manager, Transport::networkAccessManager() );
+    Interface other;
+    QCOMPARE( other.networkAccessManager(), manager );
+    QVERIFY( manager->parent() != static_cast<QObject *>( m ) );
+    // asking for it doesn't switch the interface to a manager of its own
+    QVERIFY( m->d_ptr->manager.isNull() );
+
+    // a given manager is used right away
+    QNetworkAccessManager *custom = new QNetworkAccessManager;
+    Interface withManager( custom );
+    QCOMPARE( withManager.d_ptr->manager.data(), custom );
+    QCOMPARE( custom->parent(), static_cast<QObject *>( &withManager ) );
+    QCOMPARE( withManager.networkAccessManager(), custom );
+
+    // only the own manager is deleted when replaced
+    withManager.setNetworkAccessManager( 0 );
+    QCOMPARE( withManager.networkAccessManager(), manager );
+    withManager.setNetworkAccessManager( new QNetworkAccessManager );
+    QCOMPARE( Transport::networkAccessManager(), manager );
+}
+
+void QOAuth::Ut_Interface::transportStatistics()
+{
+    QCOMPARE( Transport::hostKey( QUrl( "https://API.example.com/oauth/request_token" ) ),
+              QString( "https://api.example.com:443" ) );
+    QCOMPARE( Transport::hostKey( QUrl( "http://example.com:8080/" ) ), QString( "http://example.com:8080" ) );
+
+    Transport::resetRequestStatistics();
+    QString host = Transport::hostKey( QUrl( "http://127.0.0.1:1" ) );
+    QCOMPARE( Transport::requestStatistics( host ).requests, 0 );
+
+    // nothing listens on the port, so the request fails quickly
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+    Reply *reply = m->requestTokenAsync( "http://127.0.0.1:1/request_token", GET );
+    QVERIFY( Transport::hosts().contains( host ) );
+    QCOMPARE( Transport::requestStatistics( host ).requests, 1 );
+    QCOMPARE( Transport::requestStatistics( host ).activeRequests, 1 );
+
+    if ( !reply->isFinished() ) {
+        QEventLoop loop;
+        QObject::connect( reply, SIGNAL(finished()), &loop, SLOT(quit()) );
+        QTimer::singleShot( 10000, &loop, SLOT(quit()) );
+        loop.exec();
+    }
+    QVERIFY( reply->isFinished() );
+    delete reply;
+
+    HostRequestStatistics statistics = Transport::requestStatistics( host );
+    QCOMPARE( statistics.requests, 1 );
+    QCOMPARE( statistics.activeRequests, 0 );
+    QCOMPARE( statistics.failedRequests, 1 );
+    QCOMPARE( statistics.http2Requests, 0 );
+
+    Transport::resetRequestStatistics();
+    QVERIFY( !Transport::hosts().contains( host ) );
+}
+
+void QOAuth::Ut_Interface::concurrentRequests()
+{
+    // the batches are smaller than the number of connections QNetworkAccessManager
+    // opens to a host, so the server always gets a whole batch
+    TokenServer server( 3 );
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+
+    const int count = 30;
+    QList<Reply *> replies;
+    for ( int i = 0; i < count; ++i ) {
+        replies.append( m->accessTokenAsync( url, GET, "token" + QByteArray::number( i ), "secret" ) );
+    }
+    QCOMPARE( m->pendingRequests(), count );
+
+    QElapsedTimer timer;
+    timer.start();
+    while ( m->pendingRequests() > 0 && timer.elapsed() < 10000 ) {
+        QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents, 100 );
+    }
+    QCOMPARE( m->pendingRequests(), 0 );
+    QCOMPARE( server.answered, count );
+
+    // each reply got the answer to its own request, even though they came in reverse
+    for ( int i = 0; i < count; ++i ) {
+        Reply *reply = replies.at( i );
+        QByteArray token = "token" + QByteArray::number( i );
+        QCOMPARE( reply->error(), (int) NoError );
+        QCOMPARE( reply->result().value( tokenParameterName() ), token + "-access" );
+        QCOMPARE( reply->result().value( tokenSecretParameterName() ), token + "-secret" );
+        delete reply;
+    }
+
+    // the synchronous calls wait for their own replies only
+    TokenServer single( 1 );
+    QVERIFY( single.listen( QHostAddress::LocalHost ) );
+    ParamMap result = m->accessToken( QString( "http://127.0.0.1:%1/access_token" ).arg( single.serverPort() ),
+                                      GET, "sync", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "sync-access" ) );
+}
+
+void QOAuth::Ut_Interface::accessTokens()
+{
+    // whatever arrives within the delay is answered at once,
+    // so the server sees how many requests are sent in parallel
+    const int delay = 100;
+    TokenServer server( 0, delay );
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+
+    const int count = 24;
+    const int maxConcurrent = 3;
+    QList<TokenExchange> exchanges;
+    for ( int i = 0; i < count; ++i ) {
+        QByteArray token = ( i == 7 ? "bad" : "token" ) + QByteArray::number( i );
+        exchanges.append( TokenExchange( token, "secret" ) );
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    QList<TokenExchangeResult> results = m->accessTokens( url, GET, exchanges, HMAC_SHA1, maxConcurrent );
+    qint64 elapsed = timer.elapsed();
+
+    QCOMPARE( results.size(), count );
+    QCOMPARE( server.answered, count );
+    QCOMPARE( m->pendingRequests(), 0 );
+    QVERIFY( server.maxPending > 1 );
+    QVERIFY( server.maxPending <= maxConcurrent );
+
+    // count / maxConcurrent round trips, with a generous margin,
+    // but well below count round trips done one after another
+    QVERIFY( elapsed < count * delay / 2 );
+
+    // the failed exchange doesn't affect the others
+    for ( int i = 0; i < count; ++i ) {
+        const TokenExchangeResult &result = results.at( i );
+        if ( i == 7 ) {
+            QCOMPARE( result.error, (int) Unauthorized );
+            QVERIFY( result.result.isEmpty() );
+            continue;
+        }
+        QByteArray token = "token" + QByteArray::number( i );
+        QCOMPARE( result.error, (int) NoError );
+        QCOMPARE( result.result.value( tokenParameterName() ), token + "-access" );
+        QCOMPARE( result.result.value( tokenSecretParameterName() ), token + "-secret" );
+    }
+    QCOMPARE( m->error(), (int) Unauthorized );
+
+    // requests failing before reaching the network are reported per item as well
+    results = m->accessTokens( url, PUT, exchanges.mid( 0, 4 ), HMAC_SHA1, 2 );
+    QCOMPARE( results.size(), 4 );
+    Q_FOREACH ( const TokenExchangeResult &result, results ) {
+        QCOMPARE( result.error, (int) UnsupportedHttpMethod );
+    }
+    QCOMPARE( m->error(), (int) UnsupportedHttpMethod );
+
+    QVERIFY( m->accessTokens( url, GET, QList<TokenExchange>() ).isEmpty() );
+    QCOMPARE( m->error(), (int) NoError );
+}
+
+void QOAuth::Ut_Interface::retryPolicy()
+{
+    RetryPolicy policy;
+    QCOMPARE( policy.maxAttempts(), 1 );
+    QVERIFY( policy.isRetryable( Timeout ) );
+    QVERIFY( policy.isRetryable( OtherError ) );
+    QVERIFY( !policy.isRetryable( Unauthorized ) );
+    QVERIFY( !policy.isRetryable( NoError ) );
+    QCOMPARE( policy.hedgingPercentile(), qreal( 0.0 ) );
+
+    // the interface starts with a single attempt, and keeps a copy of the policy
+    QCOMPARE( m->retryPolicy().maxAttempts(), 1 );
+    policy.setMaxAttempts( 0 );
+    QCOMPARE( policy.maxAttempts(), 1 );
+    policy.setMaxAttempts( 4 );
+    m->setRetryPolicy( policy );
+    policy.setMaxAttempts( 2 );
+    QCOMPARE( m->retryPolicy().maxAttempts(), 4 );
+
+    // exact delays without jitter, growing up to the limit
+    policy.setJitter( 0.0 );
+    policy.setInitialBackoff( 100 );
+    policy.setBackoffMultiplier( 3.0 );
+    policy.setMaxBackoff( 2000 );
+    QCOMPARE( policy.backoff( 0 ), 0u );
+    QCOMPARE( policy.backoff( 1 ), 100u );
+    QCOMPARE( policy.backoff( 2 ), 300u );
+    QCOMPARE( policy.backoff( 3 ), 900u );
+    QCOMPARE( policy.backoff( 4 ), 2000u );
+    QCOMPARE( policy.backoff( 100 ), 2000u );
+
+    // with jitter the delays are spread below the computed value
+    policy.setJitter( 2.0 );
+    QCOMPARE( policy.jitter(), qreal( 1.0 ) );
+    policy.setJitter( 0.5 );
+    QSet<uint> delays;
+    for ( int i = 0; i < 100; ++i ) {
+        uint delay = policy.backoff( 2 );
+        QVERIFY( delay >= 150 && delay <= 300 );
+        delays.insert( delay );
+    }
+    QVERIFY( delays.size() > 1 );
+
+    policy.setRetryableErrors( QList<int>() << Forbidden );
+    QVERIFY( policy.isRetryable( Forbidden ) );
+    QVERIFY( !policy.isRetryable( Timeout ) );
+
+    LatencyHistory history;
+    QCOMPARE( history.percentile( 0.5 ), Q_INT64_C(-1) );
+    for ( int i = 1; i <= LatencyHistory::Capacity + 100; ++i ) {
+        history.record( i );
+    }
+    // only the latest samples are kept
+    QCOMPARE( history.count(), (int) LatencyHistory::Capacity );
+    QCOMPARE( history.percentile( 0.0 ), Q_INT64_C(101) );
+    QCOMPARE( history.percentile( 1.0 ), qint64( LatencyHistory::Capacity + 100 ) );
+    QCOMPARE( history.percentile( 0.5 ), qint64( 100 + LatencyHistory::Capacity / 2 ) );
+}
+
+void QOAuth::Ut_Interface::retries()
+{
+    TokenServer server( 1 );
+    server.failures = 2;
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+
+    // with no retries the error goes straight to the caller
+    ParamMap result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) OtherError );
+    QCOMPARE( server.answered, 1 );
+
+    RetryPolicy policy( 3 );
+    policy.setInitialBackoff( 50 );
+    m->setRetryPolicy( policy );
+
+    server.answered = 0;
+    QElapsedTimer timer;
+    timer.start();
+    result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "token-access" ) );
+    // one failure left from before, then the answer after the backoff
+    QCOMPARE( server.answered, 2 );
+    QVERIFY( timer.elapsed() >= 25 );
+
+    // every attempt is signed anew
+    QCOMPARE( server.nonces.size(), 3 );
+    QVERIFY( server.nonces.at( 1 ) != server.nonces.at( 2 ) );
+
+    // the retries are signed with the credentials the request was started with
+    server.failures = server.nonces.size() + 1;
+    Reply *reply = m->accessTokenAsync( url, GET, "token", "secret" );
+    m->setConsumerKey( "changed" );
+    timer.start();
+    while ( !reply->isFinished() && timer.elapsed() < 10000 ) {
+        QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents, 100 );
+    }
+    QCOMPARE( reply->error(), (int) NoError );
+    QCOMPARE( server.consumerKeys.size(), 5 );
+    QCOMPARE( server.consumerKeys.at( 3 ), QByteArray( "135432" ) );
+    QCOMPARE( server.consumerKeys.at( 4 ), QByteArray( "135432" ) );
+    delete reply;
+    m->setConsumerKey( "135432" );
+
+    // the error of the last attempt is reported once they run out
+    server.failures = server.nonces.size() + 3;
+    server.answered = 0;
+    reply = m->accessTokenAsync( url, GET, "token", "secret" );
+    QSignalSpy errorSpy( reply, SIGNAL(error(int)) );
+    QSignalSpy finishedSpy( reply, SIGNAL(finished()) );
+    timer.start();
+    while ( !reply->isFinished() && timer.elapsed() < 10000 ) {
+        QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents, 100 );
+    }
+    QCOMPARE( reply->error(), (int) OtherError );
+    QCOMPARE( server.answered, 3 );
+    QCOMPARE( errorSpy.count(), 1 );
+    QCOMPARE( finishedSpy.count(), 1 );
+    delete reply;
+
+    // errors outside of the policy are not retried
+    server.failures = 0;
+    server.answered = 0;
+    result = m->accessToken( url, GET, "bad", "secret" );
+    QCOMPARE( m->error(), (int) Unauthorized );
+    QCOMPARE( server.answered, 1 );
+
+    // neither are the requests failing before reaching the network
+    m->setConsumerKey( QByteArray() );
+    result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) ConsumerKeyEmpty );
+    QCOMPARE( server.answered, 1 );
+}
+
+void QOAuth::Ut_Interface::hedging()
+{
+    // the first request never gets an answer
+    TokenServer server( 1 );
+    server.stalls = 1;
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+    m->setRequestTimeout( 5000 );
+
+    RetryPolicy policy;
+    policy.setHedgingPercentile( 0.9 );
+    m->setRetryPolicy( policy );
+
+    // the recent requests took 20 ms
+    for ( int i = 0; i < LatencyHistory::MinimumSamples; ++i ) {
+        m->d_ptr->latencies.record( 20 );
+    }
+
+    QElapsedTimer timer;
+    timer.start();
+    ParamMap result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "token-access" ) );
+    QVERIFY( timer.elapsed() < 5000 );
+
+    // the hedge was sent with a fresh nonce and signature
+    QCOMPARE( server.nonces.size(), 2 );
+    QVERIFY( server.nonces.at( 0 ) != server.nonces.at( 1 ) );
+    QCOMPARE( server.answered, 1 );
+
+    // and the latency of the attempt, counted from the first copy, joined the history
+    QCOMPARE( m->d_ptr->latencies.count(), (int) LatencyHistory::MinimumSamples + 1 );
+    // (the hedge timer is coarse, so it may fire a little early)
+    QVERIFY( m->d_ptr->latencies.percentile( 0.0 ) >= 15 );
+
+    // a refused copy doesn't end the request while the other one may still succeed
+    TokenServer slowServer( 1, 300 );
+    slowServer.consumeTokens = true;
+    QVERIFY( slowServer.listen( QHostAddress::LocalHost ) );
+    QString slowUrl = QString( "http://127.0.0.1:%1/access_token" ).arg( slowServer.serverPort() );
+    result = m->accessToken( slowUrl, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "token-access" ) );
+    QCOMPARE( slowServer.nonces.size(), 2 );
+    QCOMPARE( slowServer.answered, 2 );
+
+    // no hedges until the latencies are known
+    m->d_ptr->latencies.clear();
+    server.stalls = server.nonces.size() + 1;
+    m->setRequestTimeout( 300 );
+    result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) Timeout );
+    QCOMPARE( server.nonces.size(), server.stalls );
+}
+
+void QOAuth::Ut_Interface::deadline()
+{
+    QVERIFY( Deadline().isForever() );
+    QVERIFY( Deadline::never().isForever() );
+    QVERIFY( !Deadline::never().hasExpired() );
+    QCOMPARE( Deadline::never().remainingTime(), Q_INT64_C(-1) );
+    QVERIFY( Deadline( 0 ).hasExpired() );
+    QCOMPARE( Deadline( -10 ).remainingTime(), Q_INT64_C(0) );
+
+    Deadline budget( 10000 );
+    QVERIFY( !budget.isForever() );
+    QVERIFY( !budget.hasExpired() );
+    QVERIFY( budget.remainingTime() > 0 && budget.remainingTime() <= 10000 );
+
+    // nested calls get the earlier of the deadlines
+    QCOMPARE( budget.earlier( Deadline::never() ), budget );
+    QCOMPARE( Deadline::never().earlier( budget ), budget );
+    QVERIFY( budget.earlier( 100 ).remainingTime() <= 100 );
+    QCOMPARE( budget.earlier( 100000 ), budget );
+
+    // the first request never gets an answer
+    TokenServer server( 1 );
+    server.stalls = 1;
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+
+    // the deadline fails its own request only
+    Deadline deadline( 200 );
+    Reply *stalled = m->accessTokenAsync( url, GET, "stalled", "secret", HMAC_SHA1, ParamMap(), deadline );
+    QCOMPARE( stalled->deadline(), deadline );
+    QElapsedTimer timer;
+    timer.start();
+    while ( server.nonces.isEmpty() && timer.elapsed() < 5000 ) {
+        QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents, 100 );
+    }
+    Reply *other = m->accessTokenAsync( url, GET, "other", "secret" );
+    QVERIFY( other->deadline().isForever() );
+
+    while ( ( !stalled->isFinished() || !other->isFinished() ) && timer.elapsed() < 5000 ) {
+        QCoreApplication::processEvents( QEventLoop::WaitForMoreEvents, 100 );
+    }
+    QCOMPARE( stalled->error(), (int) Timeout );
+    QVERIFY( timer.elapsed() >= 150 );
+    QCOMPARE( other->error(), (int) NoError );
+    QCOMPARE( other->result().value( tokenParameterName() ), QByteArray( "other-access" ) );
+    delete stalled;
+    delete other;
+
+    // nothing is sent once the deadline has passed
+    int sent = server.nonces.size();
+    ParamMap result = m->accessToken( url, GET, "token", "secret", HMAC_SHA1, ParamMap(), Deadline( 0 ) );
+    QCOMPARE( m->error(), (int) Timeout );
+    QVERIFY( result.isEmpty() );
+    QCOMPARE( server.nonces.size(), sent );
+
+    // and the retries stop when the next one wouldn't make it in time
+    server.failures = 100;
+    RetryPolicy policy( 10 );
+    policy.setInitialBackoff( 100 );
+    policy.setBackoffMultiplier( 1.0 );
+    policy.setJitter( 0.0 );
+    m->setRetryPolicy( policy );
+    timer.start();
+    result = m->accessToken( url, GET, "token", "secret", HMAC_SHA1, ParamMap(), Deadline( 250 ) );
+    QCOMPARE( m->error(), (int) OtherError );
+    QVERIFY( timer.elapsed() < 250 );
+    QVERIFY( server.nonces.size() - sent >= 2 );
+    QVERIFY( server.nonces.size() - sent <= 3 );
+}
+
 void QOAuth::Ut_Interface::consumerKey()
 {
     QByteArray consumerKey( "6d65216f4272d0d3932cdcf8951997c2" );
@@ -95,6 +714,70 @@ void QOAuth::Ut_Interface::setRequestTimeout()
     QVERIFY( m->d_ptr->requestTimeout == timeout );
 }
 
+void QOAuth::Ut_Interface::maxReplySize()
+{
+    QCOMPARE( m->maxReplySize(), (qint64) Interface::DefaultMaxReplySize );
+
+    TokenServer server( 1 );
+    server.padding = 100000;
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+
+    ParamMap result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) ReplyTooLarge );
+    QVERIFY( result.isEmpty() );
+
+    m->setMaxReplySize( 0 );
+    result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "token-access" ) );
+    QCOMPARE( result.value( "padding" ).size(), server.padding );
+
+    server.padding = 0;
+    m->setMaxReplySize( 200 );
+    result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenSecretParameterName() ), QByteArray( "token-secret" ) );
+
+    m->setMaxReplySize( -1 );
+    QCOMPARE( m->maxReplySize(), Q_INT64_C(0) );
+}
+
+void QOAuth::Ut_Interface::tokenRoundTrip()
+{
+    TokenServer server( 1 );
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+
+    // the tokens come back in the form they are sent in, so they can be sent again as they are
+    ParamMap result = m->accessToken( url, GET, "a%2Fb", "s%2F1" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "a%2Fb-access" ) );
+    QCOMPARE( result.value( tokenSecretParameterName() ), QByteArray( "a%2Fb-secret" ) );
+
+    result = m->accessToken( url, GET, result.value( tokenParameterName() ),
+                             result.value( tokenSecretParameterName() ) );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "a%2Fb-access-access" ) );
+    QCOMPARE( server.nonces.size(), 2 );
+
+    // the secret is encoded exactly once in the key, as it's given
+    Signer signer( "135432", "654316" );
+    SigningContext context;
+    int error;
+    QVERIFY( signer.d->prepareContext( PLAINTEXT, ParseForHeaderArguments, &context, &error ) );
+    QCOMPARE( signer.d->hmacKey( context, "a%2Fb-secret" ), QByteArray( "654316&a%252Fb-secret" ) );
+    QCOMPARE( signer.d->hmacKey( context, "ab%41c" ), QByteArray( "654316&ab%2541c" ) );
+    QCOMPARE( signer.d->createPlaintextSignature( context, "a%2Fb-secret" ),
+              QByteArray( "654316&a%252Fb-secret" ) );
+}
+
 void QOAuth::Ut_Interface::error()
 {
     m->d_ptr->error = Forbidden;
@@ -265,6 +948,60 @@ void QOAuth::Ut_Interface::accessToken()
     }
 }
 
+void QOAuth::Ut_Interface::requestTokenAsync_data()
+{
+    QTest::addColumn<QByteArray>("key");
+    QTest::addColumn<QByteArray>("secret");
+    QTest::addColumn<int>("httpMethod");
+    QTest::addColumn<int>("error");
+
+    QTest::newRow("key empty") << QByteArray()
+            << QByteArray( "135432" )
+            << (int) GET
+            << (int) ConsumerKeyEmpty;
+
+    QTest::newRow("secret empty") << QByteArray( "135432" )
+            << QByteArray()
+            << (int) GET
+            << (int) ConsumerSecretEmpty;
+
+    QTest::newRow("httpMethod") << QByteArray( "135432" )
+            << QByteArray( "654316" )
+            << (int) PUT
+            << (int) UnsupportedHttpMethod;
+}
+
+void QOAuth::Ut_Interface::requestTokenAsync()
+{
+    QFETCH( QByteArray, key );
+    QFETCH( QByteArray, secret );
+    QFETCH( int, httpMethod );
+    QFETCH( int, error );
+
+    m->setConsumerKey( key );
+    m->setConsumerSecret( secret );
+    Reply *reply = m->requestTokenAsync( "http://wtf&(^%)$&#.com", (HttpMethod) httpMethod );
+
+    QVERIFY( reply );
+    QSignalSpy finishedSpy( reply, SIGNAL(finished()) );
+    QSignalSpy errorSpy( reply, SIGNAL(error(int)) );
+
+    // the request fails before reaching the network...
+    QVERIFY( reply->isFinished() );
+    QCOMPARE( reply->error(), error );
+    QVERIFY( reply->result().isEmpty() );
+    QCOMPARE( m->error(), error );
+
+    // ...but the signals are delivered from the event loop
+    QCOMPARE( finishedSpy.count(), 0 );
+    QCoreApplication::processEvents();
+    QCOMPARE( finishedSpy.count(), 1 );
+    QCOMPARE( errorSpy.count(), 1 );
+    QCOMPARE( errorSpy.at( 0 ).at( 0 ).toInt(), error );
+
+    delete reply;
+}
+
 void QOAuth::Ut_Interface::createParametersString_data()
 {
     QTest::addColumn<uint>("timeout");
@@ -423,6 +1160,1097 @@ void QOAuth::Ut_Interface::inlineParameters()
     QCOMPARE( query, result );
 }
 
+void QOAuth::Ut_Interface::signer_data()
+{
+    QTest::addColumn<QByteArray>("key");
+    QTest::addColumn<QByteArray>("secret");
+    QTest::addColumn<int>("signMethod");
+    QTest::addColumn<int>("error");
+
+    QTest::newRow("key empty")    << QByteArray()           << QByteArray( "135432" )
+                                  << (int) HMAC_SHA1         << (int) ConsumerKeyEmpty;
+    QTest::newRow("secret empty") << QByteArray( "135432" ) << QByteArray()
+                                  << (int) HMAC_SHA1         << (int) ConsumerSecretEmpty;
+    QTest::newRow("no RSA key")   << QByteArray( "135432" ) << QByteArray( "654316" )
+                                  << (int) RSA_SHA1          << (int) RSAPrivateKeyEmpty;
+    QTest::newRow("HMAC-SHA1")    << QByteArray( "135432" ) << QByteArray( "654316" )
+                                  << (int) HMAC_SHA1         << (int) NoError;
+    QTest::newRow("PLAINTEXT")    << QByteArray( "135432" ) << QByteArray( "654316" )
+                                  << (int) PLAINTEXT         << (int) NoError;
+    QTest::newRow("bad method")   << QByteArray( "135432" ) << QByteArray( "654316" )
+                                  << (int) PLAINTEXT + 1     << (int) OtherError;
+}
+
+void QOAuth::Ut_Interface::signer()
+{
+    QFETCH( QByteArray, key );
+    QFETCH( QByteArray, secret );
+    QFETCH( int, signMethod );
+    QFETCH( int, error );
+
+    Signer signer( key, secret );
+    QCOMPARE( signer.consumerKey(), key );
+    QCOMPARE( signer.consumerSecret(), secret );
+
+    ParamMap map;
+    map.insert( "file", "flower_48.jpg" );
+
+    int signError = -1;
+    QByteArray result = signer.sign( "http://example.com/get_photo", GET, "token", "tokensecret",
+                                     (SignatureMethod) signMethod, map, ParseForRequestContent, &signError );
+
+    QCOMPARE( signError, error );
+    QCOMPARE( result.isEmpty(), error != NoError );
+    if ( error == NoError ) {
+        QVERIFY( result.contains( "file=flower_48.jpg" ) );
+        QVERIFY( result.contains( "oauth_consumer_key=" + key ) );
+        QVERIFY( result.contains( "oauth_signature=" ) );
+    }
+
+    // the signer is independent of any interface
+    QCOMPARE( m->error(), (int) NoError );
+}
+
+void QOAuth::Ut_Interface::signerThreaded()
+{
+    Signer signer( "135432", "654316" );
+    QAtomicInt failures;
+
+    QThreadPool pool;
+    pool.setMaxThreadCount( 8 );
+    for ( int i = 0; i < 8; ++i ) {
+        pool.start( new SignerRunnable( signer, 200, &failures ) );
+    }
+    pool.waitForDone();
+
+    QVERIFY( failures.testAndSetRelaxed( 0, 0 ) );
+}
+
+void QOAuth::Ut_Interface::signBatch()
+{
+    QVector<SigningRequest> requests;
+    for ( int i = 0; i < 1000; ++i ) {
+        ParamMap map;
+        map.insert( "index", QByteArray::number( i ) );
+        requests << SigningRequest( "http://example.com/resource", ( i % 2 ) ? GET : POST,
+                                    "token" + QByteArray::number( i ), "tokensecret", map );
+    }
+
+    int error = -1;
+    QVector<QByteArray> results = Signer().signBatch( requests, HMAC_SHA1, ParseForRequestContent, &error );
+    QCOMPARE( error, (int) ConsumerKeyEmpty );
+    QVERIFY( results.isEmpty() );
+
+    Signer signer( "135432", "654316" );
+    results = signer.signBatch( requests, HMAC_SHA1, ParseForRequestContent, &error );
+    QCOMPARE( error, (int) NoError );
+    QCOMPARE( results.size(), requests.size() );
+
+    // results come in the order of requests, and all share one timestamp
+    QByteArray timestamp;
+    for ( int i = 0; i < results.size(); ++i ) {
+        ParamMap map = InterfacePrivate::replyToMap( results.at( i ) );
+        QCOMPARE( map.value( "index" ), QByteArray::number( i ) );
+        QCOMPARE( map.value( "oauth_token" ), "token" + QByteArray::number( i ) );
+        QVERIFY( !map.value( "oauth_signature" ).isEmpty() );
+        if ( i == 0 ) {
+            timestamp = map.value( "oauth_timestamp" );
+        }
+        QCOMPARE( map.value( "oauth_timestamp" ), timestamp );
+
+        // signatures computed together have to verify one by one
+        QByteArray signature = map.take( "oauth_signature" );
+        QByteArray baseString = InterfacePrivate::httpMethodToString( requests.at( i ).httpMethod ) + "&" +
+                                QByteArray( "http://example.com/resource" ).toPercentEncoding() + "&" +
+                                InterfacePrivate::paramsToString( map, ParseForSignatureBaseString ).toPercentEncoding();
+        QCOMPARE( signature, HmacSha1::mac( "654316&tokensecret", baseString ).toBase64().toPercentEncoding() );
+    }
+}
+
+void QOAuth::Ut_Interface::hmacKeyCache()
+{
+    QByteArray key( "654316&tokensecret" );
+    QCA::SecureArray message( QByteArray( "GET&http%3A%2F%2Fexample.com&a%3Db" ) );
+
+    QCA::MessageAuthenticationCode reference( "hmac(sha1)", QCA::SymmetricKey( key ) );
+    reference.update( message );
+    QByteArray expected = reference.final().toByteArray();
+
+    HmacKeyCache cache( 2 );
+    for ( int i = 0; i < 3; ++i ) {
+        HmacSha1 hmac( cache.hmacKey( key ) );
+        hmac.update( message.toByteArray() );
+        QCOMPARE( hmac.final(), expected );
+    }
+    QCOMPARE( cache.misses(), 1 );
+    QCOMPARE( cache.hits(), 2 );
+
+    // the least recently used key makes room for a new one
+    cache.hmacKey( "654316&other" );
+    cache.hmacKey( key );
+    cache.hmacKey( "654316&third" );
+    QCOMPARE( cache.size(), 2 );
+    QCOMPARE( cache.misses(), 3 );
+    cache.hmacKey( key );
+    QCOMPARE( cache.hits(), 4 );
+    cache.hmacKey( "654316&other" );
+    QCOMPARE( cache.misses(), 4 );
+
+    // signatures with the same token secret reuse the key
+    Signer signer( "135432", "654316" );
+    for ( int i = 0; i < 3; ++i ) {
+        signer.sign( "http://example.com", GET, "token", "tokensecret",
+                     HMAC_SHA1, ParamMap(), ParseForHeaderArguments );
+    }
+    signer.sign( "http://example.com", GET, "token", "othersecret",
+                 HMAC_SHA1, ParamMap(), ParseForHeaderArguments );
+    QCOMPARE( signer.hmacCacheMisses(), 2 );
+    QCOMPARE( signer.hmacCacheHits(), 2 );
+
+    signer.setHmacCacheCapacity( 0 );
+    QCOMPARE( signer.hmacCacheCapacity(), 0 );
+    for ( int i = 0; i < 3; ++i ) {
+        signer.sign( "http://example.com", GET, "token", "tokensecret",
+                     HMAC_SHA1, ParamMap(), ParseForHeaderArguments );
+    }
+    QCOMPARE( signer.hmacCacheMisses(), 3 );
+    QCOMPARE( signer.hmacCacheHits(), 0 );
+}
+
+void QOAuth::Ut_Interface::sha1_data()
+{
+    QTest::addColumn<QByteArray>("message");
+    QTest::addColumn<QByteArray>("digest");
+
+    // FIPS 180-2 test vectors
+    QTest::newRow("empty") << QByteArray()
+            << QByteArray( "da39a3ee5e6b4b0d3255bfef95601890afd80709" );
+    QTest::newRow("abc") << QByteArray( "abc" )
+            << QByteArray( "a9993e364706816aba3e25717850c26c9cd0d89d" );
+    QTest::newRow("two blocks")
+            << QByteArray( "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq" )
+            << QByteArray( "84983e441c3bd26ebaae4aa1f95129e5e54670f1" );
+    QTest::newRow("million") << QByteArray( 1000000, 'a' )
+            << QByteArray( "34aa973cd4c4daa4f61eeb2bdbad27316534016f" );
+}
+
+void QOAuth::Ut_Interface::sha1()
+{
+    QFETCH( QByteArray, message );
+    QFETCH( QByteArray, digest );
+
+    QCOMPARE( Sha1::hash( message ).toHex(), digest );
+
+    // feed the data in uneven pieces
+    Sha1 sha1;
+    for ( int i = 0; i < message.size(); i += 37 ) {
+        sha1.update( message.mid( i, 37 ) );
+    }
+    QCOMPARE( sha1.final().toHex(), digest );
+}
+
+void QOAuth::Ut_Interface::hmacSha1_data()
+{
+    QTest::addColumn<QByteArray>("key");
+    QTest::addColumn<QByteArray>("message");
+
+    QTest::newRow("rfc2202 1") << QByteArray( 20, '\x0b' ) << QByteArray( "Hi There" );
+    QTest::newRow("rfc2202 2") << QByteArray( "Jefe" ) << QByteArray( "what do ya want for nothing?" );
+    QTest::newRow("rfc2202 6") << QByteArray( 80, '\xaa' )
+            << QByteArray( "Test Using Larger Than Block-Size Key - Hash Key First" );
+    QTest::newRow("oauth") << QByteArray( "kd94hf93k423kf44&pfkkdhi9sl3r4s00" )
+            << QByteArray( "GET&http%3A%2F%2Fphotos.example.net%2Fphotos&file%3Dvacation.jpg%26"
+                           "oauth_consumer_key%3Ddpf43f3p2l4k3l03%26oauth_nonce%3Dkllo9940pd9333jh%26"
+                           "oauth_signature_method%3DHMAC-SHA1%26oauth_timestamp%3D1191242096%26"
+                           "oauth_token%3Dnnch734d00sl2jdk%26oauth_version%3D1.0%26size%3Doriginal" );
+
+    // all the padding cases around the block boundaries
+    QByteArray pattern;
+    for ( int i = 0; i < 300; ++i ) {
+        pattern.append( char( i * 7 + 3 ) );
+    }
+    for ( int length = 0; length < 300; length += 5 ) {
+        QTest::newRow( QByteArray::number( length ).constData() )
+                << pattern.left( length % 100 ) << pattern.left( length );
+    }
+}
+
+void QOAuth::Ut_Interface::hmacSha1()
+{
+    QFETCH( QByteArray, key );
+    QFETCH( QByteArray, message );
+
+    QCA::MessageAuthenticationCode reference( "hmac(sha1)", QCA::SymmetricKey( key ) );
+    reference.update( QCA::SecureArray( message ) );
+
+    QCOMPARE( HmacSha1::mac( key, message ), reference.final().toByteArray() );
+
+    // the SHA-1 digest has to match QCA's too
+    QCOMPARE( Sha1::hash( message ), QCA::Hash( "sha1" ).hash( message ).toByteArray() );
+}
+
+void QOAuth::Ut_Interface::hmacSha1Benchmark_data()
+{
+    QTest::addColumn<bool>("native");
+
+    QTest::newRow("qca") << false;
+    QTest::newRow("native") << true;
+}
+
+void QOAuth::Ut_Interface::hmacSha1Benchmark()
+{
+    QFETCH( bool, native );
+
+    QByteArray key( "kd94hf93k423kf44&pfkkdhi9sl3r4s00" );
+    // a typical Signature Base String
+    QByteArray message( "GET&http%3A%2F%2Fphotos.example.net%2Fphotos&file%3Dvacation.jpg%26"
+                        "oauth_consumer_key%3Ddpf43f3p2l4k3l03%26oauth_nonce%3Dkllo9940pd9333jh%26"
+                        "oauth_signature_method%3DHMAC-SHA1%26oauth_timestamp%3D1191242096%26"
+                        "oauth_token%3Dnnch734d00sl2jdk%26oauth_version%3D1.0%26size%3Doriginal" );
+
+    QByteArray digest;
+    if ( native ) {
+        QBENCHMARK {
+            digest = HmacSha1::mac( key, message );
+        }
+    } else {
+        QBENCHMARK {
+            QCA::MessageAuthenticationCode hmac( "hmac(sha1)", QCA::SymmetricKey( key ) );
+            hmac.update( QCA::SecureArray( message ) );
+            digest = hmac.final().toByteArray();
+        }
+    }
+    QCOMPARE( digest.toBase64(), QByteArray( "tR3+Ty81lMeYAr/Fid0kMTYa/WM=" ) );
+}
+
+void QOAuth::Ut_Interface::hmacSha1MultiBuffer_data()
+{
+    QTest::addColumn<int>("count");
+
+    QTest::newRow("one") << 1;
+    QTest::newRow("two") << 2;
+    QTest::newRow("lanes") << HmacSha1::lanes();
+    QTest::newRow("lanes + 1") << HmacSha1::lanes() + 1;
+    QTest::newRow("many") << 37;
+}
+
+void QOAuth::Ut_Interface::hmacSha1MultiBuffer()
+{
+    QFETCH( int, count );
+
+    // keys and messages of different lengths, so that the lanes finish at different blocks
+    QVector<HmacSha1Key> keys;
+    QVector<QByteArray> keyData;
+    QVector<QByteArray> messages;
+    for ( int i = 0; i < count; ++i ) {
+        keyData << QByteArray( ( i * 13 ) % 90, char( 'k' + i ) );
+        keys << HmacSha1Key( keyData.last() );
+        messages << QByteArray( ( i * 41 ) % 300, char( 'a' + i % 26 ) );
+    }
+
+    QByteArray digests( count * Sha1::DigestSize, '\0' );
+    HmacSha1::macMany( keys.constData(), messages.constData(),
+                       reinterpret_cast<uchar *>( digests.data() ), count );
+
+    for ( int i = 0; i < count; ++i ) {
+        QCOMPARE( digests.mid( i * Sha1::DigestSize, Sha1::DigestSize ),
+                  HmacSha1::mac( keyData.at( i ), messages.at( i ) ) );
+    }
+}
+
+void QOAuth::Ut_Interface::hmacSha1MultiBufferBenchmark_data()
+{
+    QTest::addColumn<bool>("multiBuffer");
+
+    QTest::newRow("single") << false;
+    QTest::newRow("multi-buffer") << true;
+}
+
+void QOAuth::Ut_Interface::hmacSha1MultiBufferBenchmark()
+{
+    QFETCH( bool, multiBuffer );
+
+    const int count = 256;
+    QVector<HmacSha1Key> keys( count, HmacSha1Key( "kd94hf93k423kf44&pfkkdhi9sl3r4s00" ) );
+    QVector<QByteArray> messages( count, QByteArray( 300, 'x' ) );
+    QByteArray digests( count * Sha1::DigestSize, '\0' );
+    uchar *output = reinterpret_cast<uchar *>( digests.data() );
+
+    if ( multiBuffer ) {
+        QBENCHMARK {
+            HmacSha1::macMany( keys.constData(), messages.constData(), output, count );
+        }
+    } else {
+        QBENCHMARK {
+            for ( int i = 0; i < count; ++i ) {
+                HmacSha1 hmac( keys.at( i ) );
+                hmac.update( messages.at( i ) );
+                hmac.final( output + i * Sha1::DigestSize );
+            }
+        }
+    }
+}
+
+void QOAuth::Ut_Interface::signatureBaseString_data()
+{
+    QTest::addColumn<QString>("url");
+    QTest::addColumn<int>("paramCount");
+
+    QTest::newRow("no parameters") << "http://example.com/resource" << 0;
+    QTest::newRow("spec example") << "http://photos.example.net/photos" << 8;
+    QTest::newRow("repeated and reserved")
+            << QString::fromUtf8( "https://example.com:8443/p\xc3\xa5th?q=1&r=s t" ) << 13;
+}
+
+void QOAuth::Ut_Interface::signatureBaseString()
+{
+    QFETCH( QString, url );
+    QFETCH( int, paramCount );
+
+    QList< QPair<QByteArray,QByteArray> > pairs;
+    pairs << qMakePair( QByteArray( "oauth_consumer_key" ), QByteArray( "dpf43f3p2l4k3l03" ) )
+          << qMakePair( QByteArray( "oauth_nonce" ), QByteArray( "kllo9940pd9333jh" ) )
+          << qMakePair( QByteArray( "oauth_signature_method" ), QByteArray( "HMAC-SHA1" ) )
+          << qMakePair( QByteArray( "oauth_timestamp" ), QByteArray( "1191242096" ) )
+          << qMakePair( QByteArray( "oauth_token" ), QByteArray( "nnch734d00sl2jdk" ) )
+          << qMakePair( QByteArray( "oauth_version" ), QByteArray( "1.0" ) )
+          << qMakePair( QByteArray( "file" ), QByteArray( "vacation.jpg" ) )
+          << qMakePair( QByteArray( "size" ), QByteArray( "original" ) )
+          << qMakePair( QByteArray( "status" ), QByteArray( "caf%C3%A9 & friends = 100% fun~" ) )
+          << qMakePair( QByteArray( "a" ), QByteArray( "3" ) )
+          << qMakePair( QByteArray( "a" ), QByteArray( "1" ) )
+          << qMakePair( QByteArray( "a" ), QByteArray( "2" ) )
+          << qMakePair( QByteArray( "empty" ), QByteArray() );
+
+    ParamMap params;
+    for ( int i = 0; i < paramCount; ++i ) {
+        params.insert( pairs.at( i ).first, pairs.at( i ).second );
+    }
+
+    QByteArray expected = "POST&" + url.toLatin1().toPercentEncoding() + "&" +
+            InterfacePrivate::paramsToString( params, ParseForSignatureBaseString ).toPercentEncoding();
+
+    QByteArray baseString = SignerPrivate::buildSignatureBaseString( "POST", url, params );
+    QCOMPARE( baseString, expected );
+    // the result is written into a buffer allocated once, at its final size
+    QCOMPARE( baseString.capacity(), baseString.size() );
+
+    // the values come in encoded already, and every byte of them is encoded once more
+    ParamMap encoded;
+    encoded.insert( "status", "hello%20world" );
+    encoded.insert( "q", "a%2Fb~c" );
+    expected = "GET&http%3A%2F%2Fexample.com&q%3Da%252Fb~c%26status%3Dhello%2520world";
+    QCOMPARE( InterfacePrivate::paramsToString( encoded, ParseForSignatureBaseString ).toPercentEncoding(),
+              expected.mid( expected.lastIndexOf( '&' ) + 1 ) );
+    QCOMPARE( SignerPrivate::buildSignatureBaseString( "GET", "http://example.com", encoded ), expected );
+}
+
+namespace {
+
+class CollectingSink : public QOAuth::SignatureBaseStringSink
+{
+public:
+    CollectingSink() : calls( 0 ), largestPiece( 0 ) {}
+
+    void update( const char *data, int size )
+    {
+        collected.append( data, size );
+        largestPiece = qMax( largestPiece, size );
+        ++calls;
+    }
+
+    QByteArray collected;
+    int calls;
+    int largestPiece;
+};
+
+class CountingNonceSource : public QOAuth::NonceSource
+{
+public:
+    CountingNonceSource() : counter( 0 ) {}
+
+    QByteArray nonce()
+    {
+        return "nonce " + QByteArray::number( counter.fetchAndAddRelaxed( 1 ) );
+    }
+
+    QAtomicInt counter;
+};
+
+class NonceRunnable : public QRunnable
+{
+public:
+    NonceRunnable( QOAuth::NonceSource *source, int count ) :
+        m_source( source ), m_count( count ) {}
+
+    void run()
+    {
+        for ( int i = 0; i < m_count; ++i ) {
+            nonces.append( m_source->nonce() );
+        }
+    }
+
+    QList<QByteArray> nonces;
+
+private:
+    QOAuth::NonceSource *m_source;
+    int m_count;
+};
+
+class FixedTimestampSource : public QOAuth::TimestampSource
+{
+public:
+    QByteArray timestamp() { return "1191242096"; }
+};
+
+class ConstantNonceSource : public QOAuth::NonceSource
+{
+public:
+    QByteArray nonce() { return "kllo9940pd9333jh"; }
+};
+
+// stops every signing until released
+class BlockingNonceSource : public QOAuth::NonceSource
+{
+public:
+    QByteArray nonce()
+    {
+        entered.release();
+        released.acquire();
+        return "kllo9940pd9333jh";
+    }
+
+    QSemaphore entered;
+    QSemaphore released;
+};
+
+} // namespace
+
+void QOAuth::Ut_Interface::streamSignatureBaseString()
+{
+    // a large form-encoded POST body
+    ParamMap params;
+    params.insert( "text", QByteArray( 1000000, 'a' ) );
+    params.insert( "data", QByteArray( 200000, ' ' ) );
+    params.insert( "note", "a%20b=c" );
+    params.insert( "note", "~" );
+    QString url( "http://example.com/upload?x=1" );
+
+    CollectingSink sink;
+    SignerPrivate::streamSignatureBaseString( "POST", url, params, &sink );
+
+    QCOMPARE( sink.collected, SignerPrivate::buildSignatureBaseString( "POST", url, params ) );
+    // the string is passed in pieces of a bounded size
+    QVERIFY( sink.largestPiece <= SignatureBaseStringSink::ChunkSize );
+    QVERIFY( sink.calls >= sink.collected.size() / SignatureBaseStringSink::ChunkSize );
+
+    // and the signature of a streamed string is still valid
+    Signer signer( "135432", "654316" );
+    QByteArray content = signer.sign( url, POST, "token", "tokensecret", HMAC_SHA1,
+                                      params, ParseForRequestContent );
+    ParamMap map = InterfacePrivate::replyToMap( content );
+    QByteArray signature = map.take( "oauth_signature" );
+    QCOMPARE( signature, PercentEncoding::encode( HmacSha1::mac( "654316&tokensecret",
+              SignerPrivate::buildSignatureBaseString( "POST", url, map ) ).toBase64() ) );
+}
+
+void QOAuth::Ut_Interface::signatureBaseStringBenchmark_data()
+{
+    QTest::addColumn<bool>("singlePass");
+
+    QTest::newRow("appends") << false;
+    QTest::newRow("single pass") << true;
+}
+
+void QOAuth::Ut_Interface::signatureBaseStringBenchmark()
+{
+    QFETCH( bool, singlePass );
+
+    QString url( "http://photos.example.net/photos" );
+    ParamMap params;
+    params.insert( "oauth_consumer_key", "dpf43f3p2l4k3l03" );
+    params.insert( "oauth_nonce", "kllo9940pd9333jh" );
+    params.insert( "oauth_signature_method", "HMAC-SHA1" );
+    params.insert( "oauth_timestamp", "1191242096" );
+    params.insert( "oauth_token", "nnch734d00sl2jdk" );
+    params.insert( "oauth_version", "1.0" );
+    params.insert( "file", "vacation.jpg" );
+    params.insert( "size", "original" );
+
+    QByteArray baseString;
+    if ( singlePass ) {
+        QBENCHMARK {
+            baseString = SignerPrivate::buildSignatureBaseString( "GET", url, params );
+        }
+    } else {
+        // the way the base string used to be built
+        QBENCHMARK {
+            baseString.clear();
+            baseString.append( QByteArray( "GET" ) + "&" );
+            baseString.append( url.toLatin1().toPercentEncoding() + "&" );
+            baseString.append( InterfacePrivate::paramsToString( params, ParseForSignatureBaseString )
+                               .toPercentEncoding() );
+        }
+    }
+    QCOMPARE( baseString, QByteArray( "GET&http%3A%2F%2Fphotos.example.net%2Fphotos&file%3Dvacation.jpg%26"
+                                      "oauth_consumer_key%3Ddpf43f3p2l4k3l03%26oauth_nonce%3Dkllo9940pd9333jh%26"
+                                      "oauth_signature_method%3DHMAC-SHA1%26oauth_timestamp%3D1191242096%26"
+                                      "oauth_token%3Dnnch734d00sl2jdk%26oauth_version%3D1.0%26size%3Doriginal" ) );
+}
+
+void QOAuth::Ut_Interface::replyToMap_data()
+{
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QStringList>("expected");
+
+    QTest::newRow("empty") << QByteArray() << QStringList();
+    QTest::newRow("tokens") << QByteArray( "oauth_token=ab12&oauth_token_secret=cd34" )
+                            << ( QStringList() << "oauth_token" << "ab12" << "oauth_token_secret" << "cd34" );
+    QTest::newRow("encoded") << QByteArray( "oauth_token=a%2Fb&name%3D=c%20d+e" )
+                             << ( QStringList() << "name%3D" << "c%20d+e" << "oauth_token" << "a%2Fb" );
+    QTest::newRow("empty pairs") << QByteArray( "&a=1&&b=2&" )
+                                 << ( QStringList() << "a" << "1" << "b" << "2" );
+    QTest::newRow("no separator") << QByteArray( "a&b=&=c" )
+                                  << ( QStringList() << "" << "c" << "a" << "" << "b" << "" );
+    QTest::newRow("separator in value") << QByteArray( "a=b=c" )
+                                        << ( QStringList() << "a" << "b=c" );
+}
+
+void QOAuth::Ut_Interface::replyToMap()
+{
+    QFETCH( QByteArray, data );
+    QFETCH( QStringList, expected );
+
+    ParamMap map = InterfacePrivate::replyToMap( data );
+
+    QStringList pairs;
+    for ( ParamMap::const_iterator it = map.constBegin(); it != map.constEnd(); ++it ) {
+        pairs << QString::fromLatin1( it.key() ) << QString::fromLatin1( it.value() );
+    }
+    QCOMPARE( pairs, expected );
+}
+
+void QOAuth::Ut_Interface::encoding_data()
+{
+    QTest::addColumn<QByteArray>("data");
+
+    QTest::newRow("empty") << QByteArray();
+    QTest::newRow("unreserved") << QByteArray( "ABCXYZabcxyz0189-._~" );
+    QTest::newRow("reserved") << QByteArray( " !\"#$%&'()*+,/:;<=>?@[\\]^`{|}\x7f\x80\xff" );
+    QTest::newRow("url") << QByteArray( "http://photos.example.net/photos?file=vacation.jpg&size=original" );
+
+    // random data of all the lengths around the vector sizes, more and less
+    // likely to contain long runs of unreserved characters
+    qsrand( 1 );
+    const char letters[] = "abcdefghijklmnopqrstuvwxyz";
+    for ( int length = 1; length < 100; ++length ) {
+        QByteArray binary;
+        QByteArray text;
+        for ( int i = 0; i < length; ++i ) {
+            binary.append( char( qrand() ) );
+            text.append( ( qrand() % 16 ) ? letters[qrand() % 26] : char( qrand() ) );
+        }
+        QTest::newRow( QByteArray( "binary " + QByteArray::number( length ) ).constData() ) << binary;
+        QTest::newRow( QByteArray( "text " + QByteArray::number( length ) ).constData() ) << text;
+    }
+}
+
+void QOAuth::Ut_Interface::encoding()
+{
+    QFETCH( QByteArray, data );
+
+    QByteArray percentEncoded = data.toPercentEncoding();
+    QCOMPARE( PercentEncoding::encodedSize( data ), percentEncoded.size() );
+    QCOMPARE( PercentEncoding::encode( data ), percentEncoded );
+
+    QString string = QString::fromLatin1( data.constData(), data.size() ) + QChar( 0x20ac );
+    QByteArray stringEncoded = string.toLatin1().toPercentEncoding();
+    QByteArray output( PercentEncoding::encodedSize( string ), '\0' );
+    QCOMPARE( output.size(), stringEncoded.size() );
+    PercentEncoding::encode( output.data(), string );
+    QCOMPARE( output, stringEncoded );
+
+    QCOMPARE( Base64::encode( data ), data.toBase64() );
+
+    output = QByteArray( Hex::encodedSize( data.size() ), '\0' );
+    Hex::encode( output.data(), reinterpret_cast<const uchar *>( data.constData() ), data.size() );
+    QCOMPARE( output, data.toHex() );
+}
+
+void QOAuth::Ut_Interface::encodingBenchmark_data()
+{
+    QTest::addColumn<bool>("qt");
+
+    QTest::newRow("qt") << true;
+    QTest::newRow("simd") << false;
+}
+
+void QOAuth::Ut_Interface::encodingBenchmark()
+{
+    QFETCH( bool, qt );
+
+    // a typical percent-encoded parameters string and an HMAC-SHA1 digest
+    QByteArray parameters( "file=vacation.jpg&oauth_consumer_key=dpf43f3p2l4k3l03&oauth_nonce=kllo9940pd9333jh&"
+                           "oauth_signature_method=HMAC-SHA1&oauth_timestamp=1191242096&"
+                           "oauth_token=nnch734d00sl2jdk&oauth_version=1.0&size=original" );
+    QByteArray digest = QByteArray::fromHex( "b51dfe4f2f3594c79802bfc589dd2431361afd63" );
+
+    QByteArray encoded;
+    QByteArray signature;
+    if ( qt ) {
+        QBENCHMARK {
+            encoded = parameters.toPercentEncoding();
+            signature = digest.toBase64().toPercentEncoding();
+        }
+    } else {
+        QBENCHMARK {
+            encoded = PercentEncoding::encode( parameters );
+            signature = PercentEncoding::encode( Base64::encode( digest ) );
+        }
+    }
+    QCOMPARE( encoded, parameters.toPercentEncoding() );
+    QCOMPARE( signature, QByteArray( "tR3%2BTy81lMeYAr%2FFid0kMTYa%2FWM%3D" ) );
+}
+
+void QOAuth::Ut_Interface::paramList()
+{
+    ParamMap map;
+    map.insert( "b", "2" );
+    map.insert( "a", "z" );
+    map.insert( "a", "x" );
+    map.insert( "a", "y" );
+    map.insert( "c", "" );
+
+    // converted from a map, the list is sorted by names and values
+    ParamList list( map );
+    QVERIFY( list.isSorted() );
+    QCOMPARE( list.size(), 5 );
+    QCOMPARE( list.at( 0 ), qMakePair( QByteArray( "a" ), QByteArray( "x" ) ) );
+    QCOMPARE( list.at( 1 ), qMakePair( QByteArray( "a" ), QByteArray( "y" ) ) );
+    QCOMPARE( list.at( 2 ), qMakePair( QByteArray( "a" ), QByteArray( "z" ) ) );
+    QCOMPARE( list.at( 3 ), qMakePair( QByteArray( "b" ), QByteArray( "2" ) ) );
+    QCOMPARE( list.at( 4 ), qMakePair( QByteArray( "c" ), QByteArray() ) );
+    ParamMap converted = list.toParamMap();
+    QCOMPARE( converted.size(), map.size() );
+    QCOMPARE( converted.uniqueKeys(), map.uniqueKeys() );
+    QList<QByteArray> values = converted.values( "a" );
+    qSort( values );
+    QCOMPARE( values, QList<QByteArray>() << "x" << "y" << "z" );
+
+    // appending out of order makes it unsorted, until sorted again
+    list.append( "d", "1" );
+    QVERIFY( list.isSorted() );
+    list.append( "a", "w" );
+    QVERIFY( !list.isSorted() );
+    list.sort();
+    QVERIFY( list.isSorted() );
+    QCOMPARE( list.at( 0 ), qMakePair( QByteArray( "a" ), QByteArray( "w" ) ) );
+
+    list.insertSorted( "b", "1" );
+    QCOMPARE( list.size(), 8 );
+    QCOMPARE( list.at( 4 ), qMakePair( QByteArray( "b" ), QByteArray( "1" ) ) );
+    QCOMPARE( list.at( 5 ), qMakePair( QByteArray( "b" ), QByteArray( "2" ) ) );
+
+    // the same output as with the map, in every mode
+    map.insert( "d", "1" );
+    map.insert( "a", "w" );
+    map.insert( "b", "1" );
+    QCOMPARE( InterfacePrivate::paramsToString( list, ParseForInlineQuery ), QByteArray( "?a=w&a=x&a=y&a=z&b=1&b=2&c=&d=1" ) );
+    QCOMPARE( InterfacePrivate::paramsToString( list, ParseForHeaderArguments ),
+              QByteArray( "OAuth a=\"w\",a=\"x\",a=\"y\",a=\"z\",b=\"1\",b=\"2\",c=\"\",d=\"1\"" ) );
+    QCOMPARE( InterfacePrivate::paramsToString( map, ParseForRequestContent ),
+              InterfacePrivate::paramsToString( list, ParseForRequestContent ) );
+    QCOMPARE( InterfacePrivate::paramsToString( ParamList(), ParseForHeaderArguments ), QByteArray( "OAuth " ) );
+
+    // signing a list gives the same parameters as signing the map
+    Signer signer( "135432", "654316" );
+    ParamMap fromList = InterfacePrivate::replyToMap(
+            signer.sign( "http://example.com", POST, "token", "secret", HMAC_SHA1, list, ParseForRequestContent ) );
+    ParamMap fromMap = InterfacePrivate::replyToMap(
+            signer.sign( "http://example.com", POST, "token", "secret", HMAC_SHA1, map, ParseForRequestContent ) );
+    QCOMPARE( fromList.keys(), fromMap.keys() );
+    QCOMPARE( fromList.values( "a" ), fromMap.values( "a" ) );
+}
+
+void QOAuth::Ut_Interface::oauthFragments()
+{
+    Signer signer( "consumer key", "654316" );
+
+    SigningContext context;
+    int error;
+    QVERIFY( signer.d->prepareContext( HMAC_SHA1, ParseForHeaderArguments, &context, &error ) );
+
+    OAuthParams oauthParams;
+    signer.d->prepareOAuthParams( context, "token/1", &oauthParams );
+    QCOMPARE( oauthParams.count, 6 );
+
+    ParamList params;
+    params.append( "a", "1" );
+    params.append( "oauth_token", "another" );
+    params.append( "z", "~%" );
+
+    // the same as if all the parameters were encoded together
+    ParamList all = params;
+    for ( int i = 0; i < oauthParams.count; ++i ) {
+        all.append( oauthParams.params[i]->name, oauthParams.params[i]->value );
+    }
+    QVERIFY( !all.isSorted() );
+    QCOMPARE( SignerPrivate::buildSignatureBaseString( "GET", "http://example.com", params, &oauthParams ),
+              SignerPrivate::buildSignatureBaseString( "GET", "http://example.com", all ) );
+
+    CollectingSink sink;
+    SignerPrivate::streamSignatureBaseString( "GET", "http://example.com", params, &sink, &oauthParams );
+    QCOMPARE( sink.collected, SignerPrivate::buildSignatureBaseString( "GET", "http://example.com", all ) );
+
+    all.append( "oauth_signature", "sig" );
+    QCOMPARE( SignerPrivate::createParametersString( context, params, oauthParams, "sig" ),
+              InterfacePrivate::paramsToString( all, ParseForHeaderArguments ) );
+
+    // every byte of the fragments is encoded exactly once
+    QCOMPARE( oauthParams.token.encoded, QByteArray( "oauth_token%3Dtoken%2F1" ) );
+    QCOMPARE( signer.d->versionParam.encoded, QByteArray( "oauth_version%3D1.0" ) );
+    QCOMPARE( EncodedParam( "status", "hello%20world" ).encoded, QByteArray( "status%3Dhello%2520world" ) );
+
+    // the fragments follow the credentials
+    QCOMPARE( signer.d->consumerKeyParam.encoded, QByteArray( "oauth_consumer_key%3Dconsumer%20key" ) );
+    QCOMPARE( context.signatureMethodParam->encoded, QByteArray( "oauth_signature_method%3DHMAC-SHA1" ) );
+}
+
+void QOAuth::Ut_Interface::paramListBenchmark_data()
+{
+    QTest::addColumn<int>("count");
+    QTest::addColumn<bool>("list");
+
+    int counts[] = { 5, 50, 500, 5000, 10000 };
+    for ( int i = 0; i < 5; ++i ) {
+        QTest::newRow( QByteArray( "map " + QByteArray::number( counts[i] ) ).constData() ) << counts[i] << false;
+        QTest::newRow( QByteArray( "list " + QByteArray::number( counts[i] ) ).constData() ) << counts[i] << true;
+    }
+}
+
+void QOAuth::Ut_Interface::paramListBenchmark()
+{
+    QFETCH( int, count );
+    QFETCH( bool, list );
+
+    // parameters arrive in no particular order
+    QVector<QByteArray> names;
+    qsrand( count );
+    for ( int i = 0; i < count; ++i ) {
+        names << "param" + QByteArray::number( qrand() % count );
+    }
+    QByteArray value( "value" );
+
+    QByteArray baseString;
+    if ( list ) {
+        QBENCHMARK {
+            ParamList params;
+            params.reserve( count );
+            for ( int i = 0; i < count; ++i ) {
+                params.append( names.at( i ), value );
+            }
+            params.sort();
+            baseString = SignerPrivate::buildSignatureBaseString( "POST", "http://example.com", params );
+        }
+    } else {
+        // the way the parameters were handled with the map
+        QBENCHMARK {
+            ParamMap params;
+            for ( int i = 0; i < count; ++i ) {
+                params.insert( names.at( i ), value );
+            }
+            QByteArray parametersString;
+            Q_FOREACH( QByteArray name, params.uniqueKeys() ) {
+                QList<QByteArray> values = params.values( name );
+                if ( values.size() > 1 ) {
+                    qSort( values.begin(), values.end() );
+                }
+                Q_FOREACH ( QByteArray v, values ) {
+                    parametersString.append( name + "=" + v + "&" );
+                }
+            }
+            parametersString.chop( 1 );
+            baseString = "POST&" + QByteArray( "http://example.com" ).toPercentEncoding() + "&" +
+                         parametersString.toPercentEncoding();
+        }
+    }
+    QVERIFY( !baseString.isEmpty() );
+}
+
+void QOAuth::Ut_Interface::nonceSource()
+{
+    Signer signer( "consumer key", "654316" );
+    QCOMPARE( signer.nonceSource(), NonceSource::defaultSource() );
+
+    QSharedPointer<NonceSource> counting( new CountingNonceSource );
+    signer.setNonceSource( counting );
+    QByteArray header = signer.sign( "http://example.com", GET, "token", "secret", HMAC_SHA1,
+                                     ParamMap(), ParseForHeaderArguments );
+    QVERIFY( header.contains( "oauth_nonce=\"nonce%200\"" ) );
+    header = signer.sign( "http://example.com", GET, "token", "secret", HMAC_SHA1,
+                          ParamList(), ParseForHeaderArguments );
+    QVERIFY( header.contains( "oauth_nonce=\"nonce%201\"" ) );
+
+    // the interface keeps its source when the credentials change
+    m->setNonceSource( counting );
+    m->setConsumerKey( "another key" );
+    QCOMPARE( m->nonceSource(), counting );
+    QCOMPARE( m->signer().nonceSource(), counting );
+
+    signer.setNonceSource( QSharedPointer<NonceSource>() );
+    QCOMPARE( signer.nonceSource(), NonceSource::defaultSource() );
+
+    // the default nonces are 16 random bytes, hex-encoded; enough
+    // of them to go through several blocks of random data
+    QSet<QByteArray> nonces;
+    int count = 4 * NonceBuffer::BlockSize / RandomNonceSource::NonceSize;
+    for ( int i = 0; i < count; ++i ) {
+        QByteArray nonce = NonceSource::defaultSource()->nonce();
+        QCOMPARE( nonce.size(), 32 );
+        QCOMPARE( QByteArray::fromHex( nonce ).toHex(), nonce );
+        nonces.insert( nonce );
+    }
+    QCOMPARE( nonces.size(), count );
+
+    // after fork() the child draws new bytes instead of reusing the parent's
+    RandomNonceSource source;
+    source.nonce();
+    RandomNonceSource::processForked();
+    QByteArray afterFork = source.nonce();
+    QVERIFY( !nonces.contains( afterFork ) );
+}
+
+void QOAuth::Ut_Interface::nonceSourceThreaded()
+{
+    QSharedPointer<NonceSource> source = NonceSource::defaultSource();
+
+    QThreadPool pool;
+    pool.setMaxThreadCount( 8 );
+    QList<NonceRunnable *> runnables;
+    for ( int i = 0; i < 8; ++i ) {
+        NonceRunnable *runnable = new NonceRunnable( source.data(), 1000 );
+        runnable->setAutoDelete( false );
+        runnables.append( runnable );
+        pool.start( runnable );
+    }
+    pool.waitForDone();
+
+    QSet<QByteArray> nonces;
+    Q_FOREACH ( NonceRunnable *runnable, runnables ) {
+        Q_FOREACH ( const QByteArray &nonce, runnable->nonces ) {
+            nonces.insert( nonce );
+        }
+    }
+    qDeleteAll( runnables );
+
+    QCOMPARE( nonces.size(), 8 * 1000 );
+}
+
+void QOAuth::Ut_Interface::nonceSourceBenchmark_data()
+{
+    QTest::addColumn<bool>("qca");
+
+    QTest::newRow("qca") << true;
+    QTest::newRow("buffered") << false;
+}
+
+void QOAuth::Ut_Interface::nonceSourceBenchmark()
+{
+    QFETCH( bool, qca );
+
+    QSharedPointer<NonceSource> source = NonceSource::defaultSource();
+    QByteArray nonce;
+    if ( qca ) {
+        QBENCHMARK {
+            QCA::InitializationVector iv( 16 );
+            nonce = iv.toByteArray().toHex();
+        }
+    } else {
+        QBENCHMARK {
+            nonce = source->nonce();
+        }
+    }
+    QCOMPARE( nonce.size(), 32 );
+}
+
+void QOAuth::Ut_Interface::timestampSource()
+{
+    Signer signer( "consumer key", "654316" );
+    QCOMPARE( signer.timestampSource(), TimestampSource::defaultSource() );
+
+    QSharedPointer<TimestampSource> fixed( new FixedTimestampSource );
+    signer.setTimestampSource( fixed );
+    QByteArray header = signer.sign( "http://example.com", GET, "token", "secret", HMAC_SHA1,
+                                     ParamMap(), ParseForHeaderArguments );
+    QVERIFY( header.contains( "oauth_timestamp=\"1191242096\"" ) );
+
+    // the interface keeps its source when the credentials change
+    m->setTimestampSource( fixed );
+    m->setConsumerSecret( "another secret" );
+    QCOMPARE( m->timestampSource(), fixed );
+    QCOMPARE( m->signer().timestampSource(), fixed );
+
+    signer.setTimestampSource( QSharedPointer<TimestampSource>() );
+    QCOMPARE( signer.timestampSource(), TimestampSource::defaultSource() );
+
+    // the clock follows QDateTime, give or take the second that may pass meanwhile
+    ClockTimestampSource clock;
+    qint64 before = QDateTime::currentDateTime().toTime_t();
+    qint64 time = clock.timestamp().toLongLong();
+    qint64 after = QDateTime::currentDateTime().toTime_t();
+    QVERIFY( time >= before - 1 && time <= after + 1 );
+
+    clock.setOffset( -3600 );
+    QCOMPARE( clock.offset(), -3600 );
+    time = clock.timestamp().toLongLong();
+    QVERIFY( time >= before - 3601 && time <= after - 3599 );
+}
+
+void QOAuth::Ut_Interface::timestampSourceBenchmark_data()
+{
+    QTest::addColumn<bool>("qt");
+
+    QTest::newRow("qt") << true;
+    QTest::newRow("clock") << false;
+}
+
+void QOAuth::Ut_Interface::timestampSourceBenchmark()
+{
+    QFETCH( bool, qt );
+
+    QSharedPointer<TimestampSource> source = TimestampSource::defaultSource();
+    QByteArray timestamp;
+    if ( qt ) {
+        QBENCHMARK {
+            timestamp = QByteArray::number( QDateTime::currentDateTime().toTime_t() );
+        }
+    } else {
+        QBENCHMARK {
+            timestamp = source->timestamp();
+        }
+    }
+    QVERIFY( timestamp.toLongLong() > 0 );
+}
+
+void QOAuth::Ut_Interface::signingPool()
+{
+    QCA::PrivateKey key = QCA::PrivateKey::fromPEMFile( "rsa-clean.pem" );
+    QVERIFY( !key.isNull() );
+
+    // fixed nonces and timestamps make the signatures predictable
+    Signer signer( "135432", "654316", key );
+    signer.setNonceSource( QSharedPointer<NonceSource>( new ConstantNonceSource ) );
+    signer.setTimestampSource( QSharedPointer<TimestampSource>( new FixedTimestampSource ) );
+
+    SigningPool pool( signer, 4, 16 );
+    QCOMPARE( pool.threadCount(), 4 );
+    QCOMPARE( pool.queueCapacity(), 16 );
+
+    // many more requests than the queue holds
+    QList<SigningRequest> requests;
+    QList< QFuture<SigningResult> > futures;
+    for ( int i = 0; i < 200; ++i ) {
+        ParamMap params;
+        params.insert( "i", QByteArray::number( i ) );
+        SigningRequest request( "http://example.com/resource", GET, "token" + QByteArray::number( i ),
+                                "secret", params );
+        requests.append( request );
+        futures.append( pool.submit( request, ( i % 2 ) ? RSA_SHA1 : HMAC_SHA1, ParseForHeaderArguments ) );
+    }
+    pool.waitForDone();
+    QCOMPARE( pool.queuedCount(), 0 );
+
+    for ( int i = 0; i < requests.size(); ++i ) {
+        const SigningRequest &request = requests.at( i );
+        QVERIFY( futures.at( i ).isFinished() );
+        SigningResult result = futures.at( i ).result();
+        QCOMPARE( result.error, (int) NoError );
+        QCOMPARE( result.parameters, signer.sign( request.requestUrl, request.httpMethod, request.token,
+                                                  request.tokenSecret, ( i % 2 ) ? RSA_SHA1 : HMAC_SHA1,
+                                                  request.params, ParseForHeaderArguments ) );
+    }
+
+    // errors are reported in the results
+    SigningPool keyless( Signer( "135432", "654316" ), 1 );
+    SigningResult result = keyless.submit( requests.first(), RSA_SHA1, ParseForHeaderArguments ).result();
+    QCOMPARE( result.error, (int) RSAPrivateKeyEmpty );
+    QVERIFY( result.parameters.isEmpty() );
+}
+
+void QOAuth::Ut_Interface::signingPoolBackpressure()
+{
+    QSharedPointer<BlockingNonceSource> blocking( new BlockingNonceSource );
+    Signer signer( "135432", "654316" );
+    signer.setNonceSource( blocking );
+
+    SigningPool pool( signer, 1, 2 );
+    SigningRequest request( "http://example.com/resource", GET, "token", "secret" );
+
+    QFuture<SigningResult> first = pool.submit( request, HMAC_SHA1, ParseForHeaderArguments );
+    // the only thread is now busy with the first request
+    blocking->entered.acquire();
+
+    QFuture<SigningResult> second = pool.submit( request, HMAC_SHA1, ParseForHeaderArguments );
+    QFuture<SigningResult> third = pool.submit( request, HMAC_SHA1, ParseForHeaderArguments );
+    QCOMPARE( pool.queuedCount(), 2 );
+
+    // the queue is full
+    QVERIFY( pool.submit( request, HMAC_SHA1, ParseForHeaderArguments, 0 ).isCanceled() );
+    QVERIFY( pool.submit( request, HMAC_SHA1, ParseForHeaderArguments, 50 ).isCanceled() );
+    QCOMPARE( pool.queuedCount(), 2 );
+
+    // a cancelled request is skipped
+    third.cancel();
+
+    blocking->released.release( 2 );
+    pool.waitForDone();
+
+    QCOMPARE( first.result().error, (int) NoError );
+    QCOMPARE( second.result().error, (int) NoError );
+    QVERIFY( third.isCanceled() );
+    QCOMPARE( blocking->entered.available(), 1 );
+}
+
+void QOAuth::Ut_Interface::signingPoolBenchmark_data()
+{
+    QTest::addColumn<bool>("pool");
+
+    QTest::newRow("calling thread") << false;
+    QTest::newRow("pool") << true;
+}
+
+void QOAuth::Ut_Interface::signingPoolBenchmark()
+{
+    QFETCH( bool, pool );
+
+    QCA::PrivateKey key = QCA::PrivateKey::fromPEMFile( "rsa-clean.pem" );
+    QVERIFY( !key.isNull() );
+    Signer signer( "135432", "654316", key );
+    SigningRequest request( "http://example.com/resource", GET, "token", "secret" );
+
+    if ( pool ) {
+        SigningPool signingPool( signer );
+        QBENCHMARK {
+            QList< QFuture<SigningResult> > futures;
+            for ( int i = 0; i < 64; ++i ) {
+                futures.append( signingPool.submit( request, RSA_SHA1, ParseForHeaderArguments ) );
+            }
+            Q_FOREACH ( const QFuture<SigningResult> &future, futures ) {
+                QCOMPARE( future.result().error, (int) NoError );
+            }
+        }
+    } else {
+        QBENCHMARK {
+            for ( int i = 0; i < 64; ++i ) {
+                int error;
+                signer.sign( request.requestUrl, request.httpMethod, request.token, request.tokenSecret,
+                             RSA_SHA1, request.params, ParseForHeaderArguments, &error );
+                QCOMPARE( error, (int) NoError );
+            }
+        }
+    }
+}
+
 void QOAuth::Ut_Interface::setRSAPrivateKey_data()
 {
     QTest::addColumn<QString>("key");
@@ -504,6 +2332,9 @@ void QOAuth::Ut_Interface::setRSAPrivateKeyFromFile_data()
     QTest::newRow("correct")      << "rsa-clean.pem" << QByteArray()        << (int) NoError;
     QTest::newRow("also correct") << "test.pem"      << QByteArray()        << (int) NoError;
     QTest::newRow("protected")    << "rsa-pass.pem"  << QByteArray("testpassphrase") << (int) NoError;
+    QTest::newRow("DER")          << "rsa-clean.der" << QByteArray()        << (int) NoError;
+    QTest::newRow("protected DER") << "rsa-pass.der" << QByteArray("testpassphrase") << (int) NoError;
+    QTest::newRow("DER, wrong pass") << "rsa-pass.der" << QByteArray("wrong") << (int) RSADecodingError;
     QTest::newRow("wrong pass")   << "rsa-pass.pem"  << QByteArray() << (int) RSADecodingError;
     QTest::newRow("empty file")   << "empty.file"    << QByteArray()        << (int) RSADecodingError;
     QTest::newRow("no such file") << "nosuch.file"   << QByteArray()        << (int) RSAKeyFileError;
@@ -522,4 +2353,347 @@ void QOAuth::Ut_Interface::setRSAPrivateKeyFromFile()
     QCOMPARE( m->error(), error );
 }
 
+void QOAuth::Ut_Interface::setRSAPrivateKeyFromDER_data()
+{
+    QTest::addColumn<QString>("file");
+    QTest::addColumn<QByteArray>("passphrase");
+    QTest::addColumn<int>("error");
+
+    QTest::newRow("correct")    << "rsa-clean.der" << QByteArray()                 << (int) NoError;
+    QTest::newRow("protected")  << "rsa-pass.der"  << QByteArray("testpassphrase") << (int) NoError;
+    QTest::newRow("wrong pass") << "rsa-pass.der"  << QByteArray()                 << (int) RSADecodingError;
+    QTest::newRow("PEM")        << "rsa-clean.pem" << QByteArray()                 << (int) RSADecodingError;
+    QTest::newRow("empty")      << "empty.file"    << QByteArray()                 << (int) RSADecodingError;
+}
+
+void QOAuth::Ut_Interface::setRSAPrivateKeyFromDER()
+{
+    QFETCH( QString, file );
+    QFETCH( QByteArray, passphrase );
+    QFETCH( int, error );
+
+    QFile keyFile( file );
+    QVERIFY( keyFile.open( QIODevice::ReadOnly ) );
+
+    QCA::SecureArray sa( passphrase );
+
+    // decoded synchronously, without any event loop running
+    QCOMPARE( m->setRSAPrivateKeyFromDER( keyFile.readAll(), sa ), error == NoError );
+    QCOMPARE( m->error(), error );
+    if ( error == NoError ) {
+        QVERIFY( !m->signer().privateKey().isNull() );
+    }
+}
+
+void QOAuth::Ut_Interface::privateKeyCache()
+{
+    PrivateKeyCache cache;
+    QCA::ConvertResult result;
+
+    PrivateKeyCache::Key first = cache.fromFile( "rsa-clean.pem", QCA::SecureArray(), &result );
+    QCOMPARE( (int) result, (int) QCA::ConvertGood );
+    QVERIFY( !first.isNull() );
+    PrivateKeyCache::Key second = cache.fromFile( "rsa-clean.pem", QCA::SecureArray(), &result );
+    QCOMPARE( second.data(), first.data() );
+    QCOMPARE( cache.hits(), 1 );
+    QCOMPARE( cache.misses(), 1 );
+
+    // keys in memory are identified by their contents
+    QFile pemFile( "rsa-clean.pem" );
+    QVERIFY( pemFile.open( QIODevice::ReadOnly ) );
+    QByteArray pem = pemFile.readAll();
+    PrivateKeyCache::Key fromData = cache.fromData( pem, PrivateKeyCache::PEM, QCA::SecureArray(), &result );
+    QVERIFY( !fromData.isNull() );
+    QCOMPARE( cache.fromData( QByteArray( pem ), PrivateKeyCache::PEM, QCA::SecureArray(), &result ).data(),
+              fromData.data() );
+    QVERIFY( cache.fromData( pem, PrivateKeyCache::DER, QCA::SecureArray(), &result ).isNull() );
+    QCOMPARE( (int) result, (int) QCA::ErrorDecode );
+
+    // the passphrase is a part of the identity
+    QVERIFY( cache.fromFile( "rsa-pass.pem", QCA::SecureArray( "wrong" ), &result ).isNull() );
+    QVERIFY( result != QCA::ConvertGood );
+    PrivateKeyCache::Key protectedKey = cache.fromFile( "rsa-pass.pem", QCA::SecureArray( "testpassphrase" ),
+                                                        &result );
+    QVERIFY( !protectedKey.isNull() );
+    QCOMPARE( cache.size(), 3 );
+
+    QVERIFY( cache.fromFile( "nosuch.file", QCA::SecureArray(), &result ).isNull() );
+    QCOMPARE( (int) result, (int) QCA::ErrorFile );
+
+    // the keys stay cached only while in use
+    first.clear();
+    second.clear();
+    protectedKey.clear();
+    QCOMPARE( cache.size(), 1 );
+
+    // a modified file is decoded again
+    QTemporaryFile keyFile;
+    QVERIFY( keyFile.open() );
+    keyFile.write( pem );
+    keyFile.close();
+    PrivateKeyCache::Key original = cache.fromFile( keyFile.fileName(), QCA::SecureArray(), &result );
+    QVERIFY( !original.isNull() );
+
+    QFile otherKey( "test.pem" );
+    QVERIFY( otherKey.open( QIODevice::ReadOnly ) );
+    QFile rewritten( keyFile.fileName() );
+    QVERIFY( rewritten.open( QIODevice::WriteOnly | QIODevice::Truncate ) );
+    rewritten.write( otherKey.readAll() );
+    rewritten.close();
+
+    PrivateKeyCache::Key modified = cache.fromFile( keyFile.fileName(), QCA::SecureArray(), &result );
+    QVERIFY( !modified.isNull() );
+    QVERIFY( modified.data() != original.data() );
+    QVERIFY( !( *modified == *original ) );
+
+    // interfaces share the keys through the process-wide cache
+    Interface other;
+    QVERIFY( m->setRSAPrivateKeyFromFile( "rsa-clean.pem" ) );
+    QVERIFY( other.setRSAPrivateKeyFromFile( "rsa-clean.pem" ) );
+    QCOMPARE( m->d_ptr->sharedPrivateKey.data(), other.d_ptr->sharedPrivateKey.data() );
+}
+
+void QOAuth::Ut_Interface::privateKeyCacheBenchmark_data()
+{
+    QTest::addColumn<bool>("cached");
+
+    QTest::newRow("decode") << false;
+    QTest::newRow("cached") << true;
+}
+
+void QOAuth::Ut_Interface::privateKeyCacheBenchmark()
+{
+    QFETCH( bool, cached );
+
+    PrivateKeyCache cache;
+    PrivateKeyCache::Key key;
+    QCA::ConvertResult result;
+    if ( cached ) {
+        QBENCHMARK {
+            key = cache.fromFile( "rsa-clean.pem", QCA::SecureArray(), &result );
+        }
+    } else {
+        QBENCHMARK {
+            key = cache.fromFile( "rsa-clean.pem", QCA::SecureArray(), &result );
+            key.clear();
+        }
+        key = cache.fromFile( "rsa-clean.pem", QCA::SecureArray(), &result );
+    }
+    QVERIFY( !key.isNull() );
+}
+
+void QOAuth::Ut_Interface::tokenCache()
+{
+    ParamMap token;
+    token.insert( tokenParameterName(), "access" );
+    token.insert( tokenSecretParameterName(), "secret" );
+
+    TokenCache cache;
+    QCOMPARE( cache.maxMemory(), qint64( TokenCache::DefaultMaxMemory ) );
+    QCOMPARE( cache.timeToLive(), TokenCache::DefaultTimeToLive );
+    QVERIFY( cache.value( "consumer", "k1" ).isEmpty() );
+    QCOMPARE( cache.misses(), 1 );
+
+    cache.insert( "consumer", "k1", token );
+    QCOMPARE( cache.value( "consumer", "k1" ), token );
+    QCOMPARE( cache.hits(), 1 );
+    QVERIFY( cache.contains( "consumer", "k1" ) );
+    // the tokens are kept per consumer key
+    QVERIFY( !cache.contains( "consumerk", "1" ) );
+    QVERIFY( !cache.contains( "other", "k1" ) );
+    QCOMPARE( cache.count(), 1 );
+    qint64 size = cache.memoryUsage();
+    QVERIFY( size > 0 );
+
+    // a token replaces the previous one
+    cache.insert( "consumer", "k1", token );
+    QCOMPARE( cache.count(), 1 );
+    QCOMPARE( cache.memoryUsage(), size );
+
+    // the least recently used tokens go first
+    cache.setMaxMemory( 3 * size );
+    cache.insert( "consumer", "k2", token );
+    cache.insert( "consumer", "k3", token );
+    QVERIFY( !cache.value( "consumer", "k1" ).isEmpty() );
+    cache.insert( "consumer", "k4", token );
+    QCOMPARE( cache.count(), 3 );
+    QVERIFY( cache.contains( "consumer", "k1" ) );
+    QVERIFY( !cache.contains( "consumer", "k2" ) );
+    QVERIFY( cache.contains( "consumer", "k3" ) );
+    QVERIFY( cache.contains( "consumer", "k4" ) );
+    QCOMPARE( cache.memoryUsage(), 3 * size );
+
+    cache.setMaxMemory( size );
+    QCOMPARE( cache.count(), 1 );
+    QVERIFY( cache.contains( "consumer", "k4" ) );
+    cache.setMaxMemory( 0 );
+
+    // expired tokens are not returned, and are dropped on the next change
+    cache.insert( "consumer", "short", token, 50 );
+    cache.insert( "consumer", "forever", token, 0 );
+    QVERIFY( cache.contains( "consumer", "short" ) );
+    QTest::qWait( 100 );
+    QVERIFY( cache.value( "consumer", "short" ).isEmpty() );
+    QVERIFY( cache.contains( "consumer", "forever" ) );
+    QCOMPARE( cache.count(), 3 );
+    cache.insert( "other", "k1", token );
+    QCOMPARE( cache.count(), 3 );
+
+    // explicit invalidation
+    QVERIFY( cache.remove( "consumer", "forever" ) );
+    QVERIFY( !cache.remove( "consumer", "forever" ) );
+    cache.insert( "consumer", "k5", token );
+    QCOMPARE( cache.removeAll( "consumer" ), 2 );
+    QCOMPARE( cache.removeAll( "consumer" ), 0 );
+    QVERIFY( cache.contains( "other", "k1" ) );
+    for ( int i = 0; i < 100; ++i ) {
+        cache.insert( "bulk", QByteArray::number( i ), token );
+    }
+    QCOMPARE( cache.count(), 101 );
+    QCOMPARE( cache.removeAll( "bulk" ), 100 );
+    QCOMPARE( cache.count(), 1 );
+    cache.clear();
+    QCOMPARE( cache.count(), 0 );
+    QCOMPARE( cache.memoryUsage(), Q_INT64_C(0) );
+
+    // an interface serves the Access Tokens it has already obtained from the cache
+    TokenServer server( 1 );
+    QVERIFY( server.listen( QHostAddress::LocalHost ) );
+    QString url = QString( "http://127.0.0.1:%1/access_token" ).arg( server.serverPort() );
+
+    m->setConsumerKey( "135432" );
+    m->setConsumerSecret( "654316" );
+    QVERIFY( m->tokenCache().isNull() );
+    QSharedPointer<TokenCache> shared( new TokenCache );
+    m->setTokenCache( shared );
+    QCOMPARE( m->tokenCache(), shared );
+
+    ParamMap result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( shared->value( "135432", "token" ), result );
+    result = m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( m->error(), (int) NoError );
+    QCOMPARE( result.value( tokenParameterName() ), QByteArray( "token-access" ) );
+    QCOMPARE( server.answered, 1 );
+
+    Reply *reply = m->accessTokenAsync( url, GET, "token", "secret" );
+    QSignalSpy finishedSpy( reply, SIGNAL(finished()) );
+    QVERIFY( reply->isFinished() );
+    QCoreApplication::processEvents();
+    QCOMPARE( finishedSpy.count(), 1 );
+    QCOMPARE( reply->result().value( tokenParameterName() ), QByteArray( "token-access" ) );
+    delete reply;
+    QCOMPARE( server.answered, 1 );
+
+    // neither failures nor Request Tokens are cached
+    m->accessToken( url, GET, "bad", "secret" );
+    QCOMPARE( m->error(), (int) Unauthorized );
+    m->requestToken( url, GET );
+    QCOMPARE( shared->count(), 1 );
+
+    // revoked tokens are requested again
+    shared->removeAll( "135432" );
+    m->accessToken( url, GET, "token", "secret" );
+    QCOMPARE( server.answered, 4 );
+    m->setTokenCache( QSharedPointer<TokenCache>() );
+}
+
+class TokenCacheReader : public QRunnable
+{
+public:
+    TokenCacheReader( QOAuth::TokenCache *cache, int count ) :
+        found( 0 ), mismatches( 0 ), m_cache( cache ), m_count( count ) {}
+
+    void run()
+    {
+        for ( int i = 0; i < m_count; ++i ) {
+            QOAuth::ParamMap token = m_cache->value( "consumer", QByteArray::number( i % 100 ) );
+            if ( !token.isEmpty() ) {
+                ++found;
+                // a token is never seen half-written
+                if ( token.value( "oauth_token" ) != QByteArray::number( i % 100 ) ) {
+                    ++mismatches;
+                }
+            }
+        }
+    }
+
+    int found;
+    int mismatches;
+
+private:
+    QOAuth::TokenCache *m_cache;
+    int m_count;
+};
+
+void QOAuth::Ut_Interface::tokenCacheThreaded()
+{
+    TokenCache cache;
+    for ( int i = 0; i < 100; i += 2 ) {
+        ParamMap token;
+        token.insert( "oauth_token", QByteArray::number( i ) );
+        cache.insert( "consumer", QByteArray::number( i ), token );
+    }
+
+    QThreadPool pool;
+    pool.setMaxThreadCount( 4 );
+    QList<TokenCacheReader *> readers;
+    for ( int i = 0; i < 4; ++i ) {
+        TokenCacheReader *reader = new TokenCacheReader( &cache, 20000 );
+        reader->setAutoDelete( false );
+        readers.append( reader );
+        pool.start( reader );
+    }
+
+    // the readers go on while the tokens are replaced and removed
+    for ( int i = 0; i < 500; ++i ) {
+        ParamMap token;
+        token.insert( "oauth_token", QByteArray::number( i % 100 ) );
+        cache.insert( "consumer", QByteArray::number( i % 100 ), token );
+        if ( i % 7 == 0 ) {
+            cache.remove( "consumer", QByteArray::number( ( i * 3 ) % 100 ) );
+        }
+    }
+    pool.waitForDone();
+
+    int found = 0;
+    int mismatches = 0;
+    Q_FOREACH ( TokenCacheReader *reader, readers ) {
+        found += reader->found;
+        mismatches += reader->mismatches;
+    }
+    qDeleteAll( readers );
+    QVERIFY( found > 0 );
+    QCOMPARE( mismatches, 0 );
+    QCOMPARE( cache.hits() + cache.misses(), 4 * 20000 );
+}
+
+void QOAuth::Ut_Interface::tokenCacheBenchmark_data()
+{
+    QTest::addColumn<int>("tokens");
+
+    QTest::newRow("100") << 100;
+    QTest::newRow("10000") << 10000;
+}
+
+void QOAuth::Ut_Interface::tokenCacheBenchmark()
+{
+    QFETCH( int, tokens );
+
+    TokenCache cache( 0 );
+    ParamMap token;
+    token.insert( tokenParameterName(), "access" );
+    token.insert( tokenSecretParameterName(), "secret" );
+    for ( int i = 0; i < tokens; ++i ) {
+        cache.insert( "consumer", QByteArray::number( i ), token );
+    }
+
+    QByteArray key = QByteArray::number( tokens / 2 );
+    ParamMap result;
+    QBENCHMARK {
+        result = cache.value( "consumer", key );
+    }
+    QCOMPARE( result, token );
+}
+
 QTEST_MAIN(QOAuth::Ut_Interface)
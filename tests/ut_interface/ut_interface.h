@@ -22,9 +22,58 @@
 #define UT_INTERFACE_H
 
 #include <QObject>
+#include <QHash>
+#include <QList>
+#include <QSet>
+#include <QTcpServer>
 
 #include <QtCrypto>
 
+class QTcpSocket;
+
+// A stand-in Service Provider. It answers every request with the token the
+// request was signed with, and holds the requests back until batchSize of them
+// arrive, to answer them in the reverse order.
+class TokenServer : public QTcpServer
+{
+    Q_OBJECT
+
+public:
+    // with a non-zero delay, requests are answered in batches delay ms after
+    // the first request of a batch arrives, however many there are by then
+    explicit TokenServer( int batchSize, int delay = 0, QObject *parent = 0 );
+
+    int answered;
+    // the largest number of requests waiting for an answer at once
+    int maxPending;
+    // the size of a parameter added to every answer
+    int padding;
+    // the number of first requests left with no answer, and
+    // the number of the following ones answered with an error
+    int stalls;
+    int failures;
+    // when set, a token that was received before is refused at once,
+    // like a Request Token consumed by an earlier exchange
+    bool consumeTokens;
+    // the oauth_nonce and oauth_consumer_key of every request received
+    QList<QByteArray> nonces;
+    QList<QByteArray> consumerKeys;
+
+private Q_SLOTS:
+    void acceptConnections();
+    void readRequest();
+    void answerPending();
+
+private:
+    void answer( QTcpSocket *socket, const QByteArray &token );
+
+    int batchSize;
+    int delay;
+    QHash<QTcpSocket *, QByteArray> buffers;
+    QList< QPair<QTcpSocket *, QByteArray> > pending;
+    QSet<QByteArray> receivedTokens;
+};
+
 namespace QOAuth {
 
 class Interface;
@@ -37,6 +86,15 @@ private Q_SLOTS:
     void init();
     void cleanup();
     void constructor();
+    void constructorBenchmark();
+    void networkAccessManager();
+    void transportStatistics();
+    void concurrentRequests();
+    void accessTokens();
+    void retryPolicy();
+    void retries();
+    void hedging();
+    void deadline();
 
     void consumerKey();
     void setConsumerKey();
@@ -46,6 +104,8 @@ private Q_SLOTS:
 
     void requestTimeout();
     void setRequestTimeout();
+    void maxReplySize();
+    void tokenRoundTrip();
 
     void error();
 
@@ -55,18 +115,83 @@ private Q_SLOTS:
     void accessToken_data();
     void accessToken();
 
+    void requestTokenAsync_data();
+    void requestTokenAsync();
+
     void createParametersString_data();
     void createParametersString();
 
     void inlineParameters_data();
     void inlineParameters();
 
+    void signer_data();
+    void signer();
+    void signerThreaded();
+    void signBatch();
+    void hmacKeyCache();
+
+    void sha1_data();
+    void sha1();
+    void hmacSha1_data();
+    void hmacSha1();
+    void hmacSha1Benchmark_data();
+    void hmacSha1Benchmark();
+    void hmacSha1MultiBuffer_data();
+    void hmacSha1MultiBuffer();
+    void hmacSha1MultiBufferBenchmark_data();
+    void hmacSha1MultiBufferBenchmark();
+
+    void signatureBaseString_data();
+    void signatureBaseString();
+    void streamSignatureBaseString();
+    void signatureBaseStringBenchmark_data();
+    void signatureBaseStringBenchmark();
+
+    void replyToMap_data();
+    void replyToMap();
+
+    void encoding_data();
+    void encoding();
+    void encodingBenchmark_data();
+    void encodingBenchmark();
+
+    void paramList();
+    void oauthFragments();
+    void paramListBenchmark_data();
+    void paramListBenchmark();
+
+    void nonceSource();
+    void nonceSourceThreaded();
+    void nonceSourceBenchmark_data();
+    void nonceSourceBenchmark();
+
+    void timestampSource();
+    void timestampSourceBenchmark_data();
+    void timestampSourceBenchmark();
+
+    void signingPool();
+    void signingPoolBackpressure();
+    void signingPoolBenchmark_data();
+    void signingPoolBenchmark();
+
     void setRSAPrivateKey_data();
     void setRSAPrivateKey();
 
     void setRSAPrivateKeyFromFile_data();
     void setRSAPrivateKeyFromFile();
 
+    void setRSAPrivateKeyFromDER_data();
+    void setRSAPrivateKeyFromDER();
+
+    void privateKeyCache();
+    void privateKeyCacheBenchmark_data();
+    void privateKeyCacheBenchmark();
+
+    void tokenCache();
+    void tokenCacheThreaded();
+    void tokenCacheBenchmark_data();
+    void tokenCacheBenchmark();
+
 private:
     Interface *m;
     QCA::Initializer initializer;